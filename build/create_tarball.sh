@@ -220,6 +220,8 @@ mkdir $EXT_NAME
 ln -s ../MEGAsync/MEGAShellExtThunar/thunar-megasync.spec $EXT_NAME/thunar-megasync.spec
 ln -s ../../src/MEGAShellExtThunar/mega_ext_client.c $EXT_NAME/mega_ext_client.c
 ln -s ../../src/MEGAShellExtThunar/mega_ext_client.h $EXT_NAME/mega_ext_client.h
+ln -s ../../src/MEGAShellExtThunar/mega_notify_client.h $EXT_NAME/mega_notify_client.h
+ln -s ../../src/MEGAShellExtThunar/mega_notify_client.c $EXT_NAME/mega_notify_client.c
 ln -s ../../src/MEGAShellExtThunar/MEGAShellExt.c $EXT_NAME/MEGAShellExt.c
 ln -s ../../src/MEGAShellExtThunar/MEGAShellExt.h $EXT_NAME/MEGAShellExt.h
 ln -s ../../src/MEGAShellExtThunar/MEGAShellExtThunar.pro $EXT_NAME/MEGAShellExtThunar.pro
@@ -21,6 +21,11 @@ unix:!macx {
         SUBDIRS += MEGAShellExtThunar
         SUBDIRS += MEGAShellExtDolphin
     }
+
+    # qmake "CONFIG+=with_tests" MEGA.pro
+    CONFIG(with_tests) {
+        SUBDIRS += MEGATests
+    }
 }
 
 macx {
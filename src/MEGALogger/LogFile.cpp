@@ -0,0 +1,575 @@
+#include "LogFile.h"
+#include <QDataStream>
+#include <QXmlStreamReader>
+#include <QtCore>
+#include <string.h>
+
+#if QT_VERSION >= 0x050000
+#include <QtConcurrent/QtConcurrent>
+#endif
+
+const int LogFile::BLOCK_LINES = 1024;
+const int LogFile::NUM_TRIGRAMS = 1 << 18;
+
+// Characters are reduced to 6 bits for the search index (letters are case-insensitive),
+// so every trigram has a slot in a table of NUM_TRIGRAMS entries
+static struct TrigramTable
+{
+    unsigned char classes[256];
+
+    TrigramTable()
+    {
+        static const char symbols[] = " .-/:_()=,'\"[]\\@#<>+*&%!?\t";
+        memset(classes, 63, sizeof(classes));
+        for (int i = 0; i < 26; i++)
+        {
+            classes['a' + i] = classes['A' + i] = 1 + i;
+        }
+        for (int i = 0; i < 10; i++)
+        {
+            classes['0' + i] = 27 + i;
+        }
+        for (int i = 0; symbols[i]; i++)
+        {
+            classes[(unsigned char)symbols[i]] = 37 + i;
+        }
+    }
+} trigramTable;
+
+// "timestamp (level): message"
+static void parseLine(const char *line, int length, int *level, int *timeLength, int *contentStart)
+{
+    *level = -1;
+    *timeLength = 0;
+    *contentStart = 0;
+
+    const char *space = (const char *)memchr(line, ' ', length);
+    if (!space || (space - line + 2) >= length || space[1] != '(')
+    {
+        return;
+    }
+
+    int labelStart = space - line + 2;
+    const char *close = (const char *)memchr(line + labelStart, ')', length - labelStart);
+    if (!close || (close - line + 1) >= length || close[1] != ':')
+    {
+        return;
+    }
+
+    int lineLevel = LogFilter::levelFromName(line + labelStart, close - line - labelStart);
+    if (lineLevel < 0)
+    {
+        return;
+    }
+
+    int start = close - line + 2;
+    while (start < length && line[start] == ' ')
+    {
+        start++;
+    }
+
+    *level = lineLevel;
+    *timeLength = space - line;
+    *contentStart = start;
+}
+
+LogFile::LogFile(QString path)
+{
+    file.setFileName(path);
+    mapped = NULL;
+    data = NULL;
+    size = 0;
+}
+
+LogFile::~LogFile()
+{
+    if (mapped)
+    {
+        file.unmap(mapped);
+    }
+}
+
+bool LogFile::buildLineIndex()
+{
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        error = file.errorString();
+        return false;
+    }
+
+    size = file.size();
+    if (size)
+    {
+        mapped = file.map(0, size);
+        if (!mapped)
+        {
+            error = file.errorString();
+            return false;
+        }
+        data = (const char *)mapped;
+
+        // saved sessions are a QByteArray serialized by QDataStream (the size and a zlib stream)
+        if (size > 10 && (unsigned char)data[8] == 0x78
+                && ((((quint32)(unsigned char)data[0] << 24) | ((quint32)(unsigned char)data[1] << 16)
+                     | ((quint32)(unsigned char)data[2] << 8) | (unsigned char)data[3]) == (quint64)size - 4)
+                && !loadSavedSession())
+        {
+            return false;
+        }
+    }
+
+    offsets.reserve(size / 100);
+    levels.reserve(size / 100);
+    times.reserve(size / 100);
+
+    int lastLevel = -1;
+    int lastTime = -1;
+    qint64 position = 0;
+    while (position < size)
+    {
+        if (!(offsets.size() % 65536) && isCancelled())
+        {
+            return false;
+        }
+
+        const char *line = data + position;
+        const char *newLine = (const char *)memchr(line, '\n', size - position);
+        qint64 end = newLine ? (newLine - data + 1) : size;
+        int length = end - position;
+
+        int level, timeLength, contentStart;
+        parseLine(line, length, &level, &timeLength, &contentStart);
+        if (level >= 0)
+        {
+            lastLevel = level;
+            lastTime = LogFilter::timeKey(line, timeLength);
+        }
+
+        offsets.append(position);
+        levels.append(lastLevel);
+        times.append(lastTime);
+        position = end;
+    }
+    offsets.append(size);
+    return true;
+}
+
+bool LogFile::loadSavedSession()
+{
+    QByteArray raw = QByteArray::fromRawData(data, size);
+    QDataStream in(raw);
+    QByteArray compressed;
+    in >> compressed;
+    QByteArray xml = qUncompress(compressed);
+    compressed.clear();
+
+    file.unmap(mapped);
+    file.close();
+    mapped = NULL;
+    data = NULL;
+    size = 0;
+    if (xml.isEmpty())
+    {
+        error = QString::fromUtf8("Invalid log file");
+        return false;
+    }
+
+    // converted to the format of text logs, one line per message
+    int numMessages = 0;
+    buffer.reserve(xml.size());
+    QXmlStreamReader reader(xml);
+    while (!reader.atEnd())
+    {
+        if (reader.readNext() == QXmlStreamReader::StartElement && reader.name() == QLatin1String("log"))
+        {
+            if (!(++numMessages % 65536) && isCancelled())
+            {
+                return false;
+            }
+
+            QXmlStreamAttributes attr = reader.attributes();
+            QByteArray content = attr.value(QLatin1String("content")).toString().toUtf8();
+            content.replace('\n', ' ');
+            content.replace('\r', ' ');
+            buffer.append(attr.value(QLatin1String("timestamp")).toString().toUtf8());
+            buffer.append(" (");
+            buffer.append(attr.value(QLatin1String("type")).toString().toUtf8());
+            buffer.append("): ");
+            buffer.append(content);
+            buffer.append('\n');
+        }
+    }
+
+    data = buffer.constData();
+    size = buffer.size();
+    return true;
+}
+
+void LogFile::buildSearchIndex()
+{
+    QVector<int> lastBlock(NUM_TRIGRAMS, -1);
+    QVector<QVector<int> > blocks(NUM_TRIGRAMS);
+    int *last = lastBlock.data();
+    QVector<int> *posting = blocks.data();
+    const unsigned char *classes = trigramTable.classes;
+
+    int numLines = lineCount();
+    for (int line = 0; line < numLines; line++)
+    {
+        if (!(line % BLOCK_LINES) && isCancelled())
+        {
+            return;
+        }
+
+        int block = line / BLOCK_LINES;
+        const unsigned char *p = (const unsigned char *)data + offsets.at(line);
+        const unsigned char *end = (const unsigned char *)data + offsets.at(line + 1);
+        unsigned int key = 0;
+        for (int n = 1; p < end; p++, n++)
+        {
+            key = ((key << 6) | classes[*p]) & (NUM_TRIGRAMS - 1);
+            if (n >= 3 && last[key] != block)
+            {
+                last[key] = block;
+                posting[key].append(block);
+            }
+        }
+    }
+
+    for (int i = 0; i < NUM_TRIGRAMS; i++)
+    {
+        posting[i].squeeze();
+    }
+    postings = blocks;
+}
+
+// Blocks containing every trigram of the pattern
+QVector<int> LogFile::candidateBlocks(const QByteArray &pattern) const
+{
+    const unsigned char *classes = trigramTable.classes;
+    QList<const QVector<int> *> lists;
+    unsigned int key = 0;
+    for (int i = 0; i < pattern.size(); i++)
+    {
+        key = ((key << 6) | classes[(unsigned char)pattern.at(i)]) & (NUM_TRIGRAMS - 1);
+        if (i >= 2)
+        {
+            const QVector<int> *list = &postings.at(key);
+            if (list->isEmpty())
+            {
+                return QVector<int>();
+            }
+
+            // the shortest list first
+            if (lists.size() && list->size() < lists.first()->size())
+            {
+                lists.prepend(list);
+            }
+            else
+            {
+                lists.append(list);
+            }
+        }
+    }
+
+    QVector<int> result = *lists.first();
+    for (int i = 1; i < lists.size() && result.size(); i++)
+    {
+        const QVector<int> &list = *lists.at(i);
+        QVector<int> intersection;
+        int j = 0;
+        int k = 0;
+        while (j < result.size() && k < list.size())
+        {
+            if (result.at(j) < list.at(k))
+            {
+                j++;
+            }
+            else if (result.at(j) > list.at(k))
+            {
+                k++;
+            }
+            else
+            {
+                intersection.append(result.at(j));
+                j++;
+                k++;
+            }
+        }
+        result = intersection;
+    }
+    return result;
+}
+
+QVector<int> LogFile::filter(LogFilter filter, bool useSearchIndex, QAtomicInt *generation, int expectedGeneration) const
+{
+    QVector<int> result;
+    QVector<int> blocks;
+    bool restricted = false;
+    QRegExp regExp = filter.createRegExp();
+
+    if (useSearchIndex && filter.hasPattern() && filter.isLiteral()
+            && filter.column == LogModel::COLUMN_CONTENT)
+    {
+        // messages are in the middle of the lines, so every trigram of the pattern is in the line
+        QByteArray pattern = filter.pattern.toUtf8();
+        if (pattern.size() >= 3)
+        {
+            restricted = true;
+            blocks = candidateBlocks(pattern);
+        }
+    }
+
+    int numLines = lineCount();
+    int numBlocks = restricted ? blocks.size() : (numLines + BLOCK_LINES - 1) / BLOCK_LINES;
+    for (int i = 0; i < numBlocks; i++)
+    {
+        if (generation->fetchAndAddOrdered(0) != expectedGeneration)
+        {
+            return QVector<int>();
+        }
+
+        int block = restricted ? blocks.at(i) : i;
+        int last = qMin((block + 1) * BLOCK_LINES, numLines);
+        for (int line = block * BLOCK_LINES; line < last; line++)
+        {
+            int level = levels.at(line);
+            int time = times.at(line);
+            if (!filter.matchesLevelAndTime(level, time))
+            {
+                continue;
+            }
+
+            // only lines that pass the conditions answered by the index are decoded
+            if (!filter.hasPattern() || filter.matches(row(line), level, time, regExp))
+            {
+                result.append(line);
+            }
+        }
+    }
+    return result;
+}
+
+void LogFile::cancel()
+{
+    cancelled.fetchAndStoreOrdered(1);
+}
+
+bool LogFile::isCancelled() const
+{
+    return cancelled.fetchAndAddOrdered(0);
+}
+
+QString LogFile::errorString() const
+{
+    return error;
+}
+
+int LogFile::lineCount() const
+{
+    return levels.size();
+}
+
+DebugRow LogFile::row(int line) const
+{
+    DebugRow dr;
+    const char *text = data + offsets.at(line);
+    int length = offsets.at(line + 1) - offsets.at(line);
+    while (length && (text[length - 1] == '\n' || text[length - 1] == '\r'))
+    {
+        length--;
+    }
+
+    int level, timeLength, contentStart;
+    parseLine(text, length, &level, &timeLength, &contentStart);
+    if (level >= 0)
+    {
+        dr.timeStamp = QString::fromUtf8(text, timeLength);
+        dr.messageType = LogFilter::levelName(level);
+    }
+    dr.content = QString::fromUtf8(text + contentStart, length - contentStart);
+    return dr;
+}
+
+LogFileModel::LogFileModel(QString path, QObject *parent) :
+    QAbstractTableModel(parent)
+{
+    file = new LogFile(path);
+    loaded = false;
+    searchIndexReady = false;
+    filtered = false;
+    filterWatcher = NULL;
+    cachedLine = -1;
+
+    connect(&loadWatcher, SIGNAL(finished()), this, SLOT(onLineIndexBuilt()));
+    connect(&searchWatcher, SIGNAL(finished()), this, SLOT(onSearchIndexBuilt()));
+}
+
+LogFileModel::~LogFileModel()
+{
+    generation.fetchAndAddOrdered(1);
+    file->cancel();
+    loadWatcher.waitForFinished();
+    searchWatcher.waitForFinished();
+    for (int i = 0; i < filterJobs.size(); i++)
+    {
+        filterJobs[i].waitForFinished();
+    }
+    delete file;
+}
+
+void LogFileModel::load()
+{
+    emit statusChanged(tr("Loading..."));
+    loadWatcher.setFuture(QtConcurrent::run(file, &LogFile::buildLineIndex));
+}
+
+void LogFileModel::onLineIndexBuilt()
+{
+    if (!loadWatcher.result())
+    {
+        emit statusChanged(tr("Unable to open file: %1").arg(file->errorString()));
+        return;
+    }
+
+    // the search index is built while the log is already available
+    loaded = true;
+    searchWatcher.setFuture(QtConcurrent::run(file, &LogFile::buildSearchIndex));
+    emit statusChanged(tr("%1 lines, indexing...").arg(file->lineCount()));
+    startFilter();
+}
+
+void LogFileModel::onSearchIndexBuilt()
+{
+    searchIndexReady = true;
+    emit statusChanged(tr("%1 lines").arg(file->lineCount()));
+    if (filter.hasPattern())
+    {
+        startFilter();
+    }
+}
+
+void LogFileModel::setFilter(const LogFilter &filter)
+{
+    this->filter = filter;
+    startFilter();
+}
+
+void LogFileModel::startFilter()
+{
+    int currentGeneration = generation.fetchAndAddOrdered(1) + 1;
+    if (!loaded)
+    {
+        return;
+    }
+
+    if (filter.isEmpty())
+    {
+        filterWatcher = NULL;
+        beginResetModel();
+        filtered = false;
+        visibleLines.clear();
+        cachedLine = -1;
+        endResetModel();
+        return;
+    }
+
+    // earlier jobs notice the new generation and stop
+    for (int i = filterJobs.size() - 1; i >= 0; i--)
+    {
+        if (filterJobs.at(i).isFinished())
+        {
+            filterJobs.removeAt(i);
+        }
+    }
+
+    QFuture<QVector<int> > job = QtConcurrent::run(file, &LogFile::filter, filter, searchIndexReady,
+                                                   &generation, currentGeneration);
+    filterJobs.append(job);
+    filterWatcher = new QFutureWatcher<QVector<int> >(this);
+    connect(filterWatcher, SIGNAL(finished()), this, SLOT(onFilterFinished()));
+    filterWatcher->setFuture(job);
+}
+
+void LogFileModel::onFilterFinished()
+{
+    QFutureWatcher<QVector<int> > *watcher = (QFutureWatcher<QVector<int> > *)sender();
+    watcher->deleteLater();
+    if (watcher != filterWatcher || filter.isEmpty())
+    {
+        // outdated
+        return;
+    }
+
+    filterWatcher = NULL;
+    beginResetModel();
+    filtered = true;
+    visibleLines = watcher->result();
+    cachedLine = -1;
+    endResetModel();
+}
+
+int LogFileModel::lineCount() const
+{
+    return loaded ? file->lineCount() : 0;
+}
+
+DebugRow LogFileModel::sourceRow(int line) const
+{
+    return file->row(line);
+}
+
+int LogFileModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || !loaded)
+    {
+        return 0;
+    }
+    return filtered ? visibleLines.size() : file->lineCount();
+}
+
+int LogFileModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+    return LogModel::NUM_COLUMNS;
+}
+
+QVariant LogFileModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || role != Qt::DisplayRole || index.row() >= rowCount())
+    {
+        return QVariant();
+    }
+
+    // only the rows requested by the view are decoded
+    int line = filtered ? visibleLines.at(index.row()) : index.row();
+    if (line != cachedLine)
+    {
+        cachedRow = file->row(line);
+        cachedLine = line;
+    }
+
+    switch (index.column())
+    {
+        case LogModel::COLUMN_TIMESTAMP:
+            return cachedRow.timeStamp;
+        case LogModel::COLUMN_TYPE:
+            return cachedRow.messageType;
+        case LogModel::COLUMN_CONTENT:
+            return cachedRow.content;
+        default:
+            return QVariant();
+    }
+}
+
+QVariant LogFileModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+    return LogModel::columnName(section);
+}
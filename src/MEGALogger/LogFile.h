@@ -0,0 +1,107 @@
+#ifndef LOGFILE_H
+#define LOGFILE_H
+
+#include <QAbstractTableModel>
+#include <QFile>
+#include <QVector>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+
+#include "LogModel.h"
+
+// Log file indexed for filtering without parsing all of it.
+// Text logs (MEGAsync.log) are memory-mapped, saved sessions (.dat) are decompressed to the same format.
+class LogFile
+{
+public:
+    static const int BLOCK_LINES;   ///< Lines per block of the search index
+    static const int NUM_TRIGRAMS;
+
+    LogFile(QString path);
+    ~LogFile();
+
+    // Background steps, in this order.
+    // The line index is enough to show the log and to filter it by level and time,
+    // the search index (blocks containing each trigram) speeds up substring searches.
+    bool buildLineIndex();
+    void buildSearchIndex();
+    void cancel();
+    QString errorString() const;
+
+    // Available once the line index is built
+    int lineCount() const;
+    DebugRow row(int line) const;
+
+    // Lines matching the filter. Returns early if generation stops being expectedGeneration
+    QVector<int> filter(LogFilter filter, bool useSearchIndex, QAtomicInt *generation, int expectedGeneration) const;
+
+protected:
+    bool isCancelled() const;
+    bool loadSavedSession();
+    QVector<int> candidateBlocks(const QByteArray &pattern) const;
+
+    QFile file;
+    uchar *mapped;
+    QByteArray buffer;          ///< Decompressed saved session
+    const char *data;
+    qint64 size;
+
+    QVector<qint64> offsets;        ///< Start of each line (plus the end of the file)
+    QVector<signed char> levels;    ///< Lines without a level inherit the previous one
+    QVector<int> times;             ///< Same for timestamps
+    QVector<QVector<int> > postings;
+
+    mutable QAtomicInt cancelled;
+    QString error;
+};
+
+class LogFileModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit LogFileModel(QString path, QObject *parent = 0);
+    ~LogFileModel();
+
+    void load();
+    void setFilter(const LogFilter &filter);
+
+    // All the lines of the file, not only the visible ones
+    int lineCount() const;
+    DebugRow sourceRow(int line) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+signals:
+    void statusChanged(QString message);
+
+protected slots:
+    void onLineIndexBuilt();
+    void onSearchIndexBuilt();
+    void onFilterFinished();
+
+protected:
+    void startFilter();
+
+    LogFile *file;
+    bool loaded;
+    bool searchIndexReady;
+    LogFilter filter;
+    bool filtered;
+    QVector<int> visibleLines;
+
+    QAtomicInt generation;
+    QFutureWatcher<bool> loadWatcher;
+    QFutureWatcher<void> searchWatcher;
+    QFutureWatcher<QVector<int> > *filterWatcher;
+    QList<QFuture<QVector<int> > > filterJobs;
+
+    // the view asks for every column of a row in a row
+    mutable int cachedLine;
+    mutable DebugRow cachedRow;
+};
+
+#endif // LOGFILE_H
@@ -0,0 +1,325 @@
+#include "LogModel.h"
+#include <QStringList>
+#include <string.h>
+
+LogModel::LogModel(int capacity, QObject *parent) :
+    QAbstractTableModel(parent)
+{
+    this->capacity = capacity;
+    first = 0;
+    count = 0;
+    rows.resize(capacity);
+}
+
+int LogModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+    return count;
+}
+
+int LogModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+    return NUM_COLUMNS;
+}
+
+QVariant LogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= count || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+
+    const DebugRow &dr = row(index.row());
+    switch (index.column())
+    {
+        case COLUMN_TIMESTAMP:
+            return dr.timeStamp;
+        case COLUMN_TYPE:
+            return dr.messageType;
+        case COLUMN_CONTENT:
+            return dr.content;
+        default:
+            return QVariant();
+    }
+}
+
+QVariant LogModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+    return columnName(section);
+}
+
+QVariant LogModel::columnName(int column)
+{
+    switch (column)
+    {
+        case COLUMN_TIMESTAMP:
+            return QString::fromUtf8("Timestamp");
+        case COLUMN_TYPE:
+            return QString::fromUtf8("Message Type");
+        case COLUMN_CONTENT:
+            return QString::fromUtf8("Message");
+        default:
+            return QVariant();
+    }
+}
+
+void LogModel::appendRows(const QList<DebugRow> &newRows)
+{
+    int start = 0;
+    int numRows = newRows.size();
+    if (!numRows)
+    {
+        return;
+    }
+
+    if (numRows >= capacity)
+    {
+        // only the last messages of the batch fit
+        start = numRows - capacity;
+        numRows = capacity;
+        clear();
+    }
+
+    int overflow = count + numRows - capacity;
+    if (overflow > 0)
+    {
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        first = (first + overflow) % capacity;
+        count -= overflow;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), count, count + numRows - 1);
+    for (int i = 0; i < numRows; i++)
+    {
+        rows[(first + count + i) % capacity] = newRows.at(start + i);
+    }
+    count += numRows;
+    endInsertRows();
+}
+
+const DebugRow &LogModel::row(int row) const
+{
+    return rows.at((first + row) % capacity);
+}
+
+void LogModel::clear()
+{
+    if (!count)
+    {
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), 0, count - 1);
+    for (int i = 0; i < count; i++)
+    {
+        rows[(first + i) % capacity] = DebugRow();
+    }
+    first = 0;
+    count = 0;
+    endRemoveRows();
+}
+
+LogFilter::LogFilter()
+{
+    syntax = QRegExp::FixedString;
+    caseSensitivity = Qt::CaseInsensitive;
+    column = LogModel::COLUMN_CONTENT;
+    maxLevel = -1;
+    fromTime = -1;
+    toTime = -1;
+}
+
+bool LogFilter::isEmpty() const
+{
+    return !hasPattern() && maxLevel < 0 && fromTime < 0 && toTime < 0;
+}
+
+bool LogFilter::hasPattern() const
+{
+    return !pattern.isEmpty();
+}
+
+bool LogFilter::isLiteral() const
+{
+    if (syntax == QRegExp::FixedString)
+    {
+        return true;
+    }
+
+    const char *specialCharacters = (syntax == QRegExp::Wildcard) ? "*?[]\\" : "\\^$.|?*+()[]{}";
+    for (int i = 0; i < pattern.size(); i++)
+    {
+        ushort c = pattern.at(i).unicode();
+        if (c < 128 && strchr(specialCharacters, c))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LogFilter::matchesLevelAndTime(int level, int time) const
+{
+    // messages without a known level or timestamp are never hidden by these conditions
+    if (maxLevel >= 0 && level >= 0 && level > maxLevel)
+    {
+        return false;
+    }
+
+    if (time >= 0 && ((fromTime >= 0 && time < fromTime) || (toTime >= 0 && time > toTime)))
+    {
+        return false;
+    }
+    return true;
+}
+
+bool LogFilter::matches(const DebugRow &row, int level, int time, const QRegExp &regExp) const
+{
+    if (!matchesLevelAndTime(level, time))
+    {
+        return false;
+    }
+
+    if (!hasPattern())
+    {
+        return true;
+    }
+
+    const QString &text = (column == LogModel::COLUMN_TIMESTAMP) ? row.timeStamp
+                        : (column == LogModel::COLUMN_TYPE) ? row.messageType : row.content;
+    if (isLiteral())
+    {
+        return text.contains(pattern, caseSensitivity);
+    }
+    return regExp.indexIn(text) != -1;
+}
+
+QRegExp LogFilter::createRegExp() const
+{
+    return QRegExp(pattern, caseSensitivity, syntax);
+}
+
+int LogFilter::levelFromName(const char *name, int length)
+{
+    static const char *names[] = {"fatal", "error", "warn", "info", "debug", "verb"};
+    static const char *longNames[] = {"fatal", "error", "warning", "info", "debug", "verbose"};
+    for (int i = 0; i < 6; i++)
+    {
+        if ((length == (int)strlen(names[i]) && !strncmp(name, names[i], length))
+                || (length == (int)strlen(longNames[i]) && !strncmp(name, longNames[i], length)))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int LogFilter::levelFromName(const QString &name)
+{
+    QByteArray utf8 = name.toUtf8();
+    return levelFromName(utf8.constData(), utf8.size());
+}
+
+QString LogFilter::levelName(int level)
+{
+    // shared to avoid a copy of the name per message
+    static const QString names[] = {QString::fromUtf8("fatal"), QString::fromUtf8("error"),
+                                    QString::fromUtf8("warning"), QString::fromUtf8("info"),
+                                    QString::fromUtf8("debug"), QString::fromUtf8("verbose")};
+    static const QString unknown = QString::fromUtf8("unknown");
+    return (level >= 0 && level < 6) ? names[level] : unknown;
+}
+
+int LogFilter::timeKey(const char *timestamp, int length)
+{
+    // MM/dd-hh:mm:ss
+    if (length < 14)
+    {
+        return -1;
+    }
+
+    int fields[5];
+    for (int i = 0; i < 5; i++)
+    {
+        char high = timestamp[i * 3];
+        char low = timestamp[i * 3 + 1];
+        if (high < '0' || high > '9' || low < '0' || low > '9')
+        {
+            return -1;
+        }
+        fields[i] = (high - '0') * 10 + (low - '0');
+    }
+    return (((fields[0] * 32 + fields[1]) * 24 + fields[2]) * 60 + fields[3]) * 60 + fields[4];
+}
+
+int LogFilter::timeKey(const QString &timestamp, bool upperBound)
+{
+    QString text = timestamp.trimmed();
+    if (text.isEmpty())
+    {
+        return -1;
+    }
+
+    static const int limits[] = {12, 31, 23, 59, 59};
+    int fields[5];
+    QStringList parts = text.split(QRegExp(QString::fromUtf8("[/\\-: ]")), QString::SkipEmptyParts);
+    if (parts.size() > 5)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        if (i < parts.size())
+        {
+            bool ok;
+            fields[i] = parts.at(i).toInt(&ok);
+            if (!ok)
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            fields[i] = upperBound ? limits[i] : 0;
+        }
+    }
+    return (((fields[0] * 32 + fields[1]) * 24 + fields[2]) * 60 + fields[3]) * 60 + fields[4];
+}
+
+LogFilterProxyModel::LogFilterProxyModel(QObject *parent) :
+    QSortFilterProxyModel(parent)
+{
+}
+
+void LogFilterProxyModel::setFilter(const LogFilter &filter)
+{
+    this->filter = filter;
+    regExp = filter.createRegExp();
+    invalidateFilter();
+}
+
+bool LogFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &) const
+{
+    if (filter.isEmpty())
+    {
+        return true;
+    }
+
+    const DebugRow &row = ((LogModel *)sourceModel())->row(sourceRow);
+    QByteArray timestamp = row.timeStamp.toUtf8();
+    return filter.matches(row, LogFilter::levelFromName(row.messageType),
+                          LogFilter::timeKey(timestamp.constData(), timestamp.size()), regExp);
+}
@@ -0,0 +1,103 @@
+#ifndef LOGMODEL_H
+#define LOGMODEL_H
+
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QRegExp>
+#include <QVector>
+#include <QList>
+
+struct DebugRow
+{
+    QString timeStamp;
+    QString messageType;
+    QString content;
+
+};
+
+// Table of log messages stored in a fixed-size ring buffer.
+// When it's full, the oldest messages are discarded to make room for new ones.
+class LogModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum
+    {
+        COLUMN_TIMESTAMP = 0,
+        COLUMN_TYPE = 1,
+        COLUMN_CONTENT = 2,
+        NUM_COLUMNS = 3
+    };
+
+    explicit LogModel(int capacity, QObject *parent = 0);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    static QVariant columnName(int column);
+
+    // Appends a batch of messages with a single insertion (and at most one removal)
+    void appendRows(const QList<DebugRow> &newRows);
+    const DebugRow &row(int row) const;
+    void clear();
+
+protected:
+    QVector<DebugRow> rows;
+    int capacity;
+    int first;
+    int count;
+};
+
+// Conditions to show a log message, shared by live sessions and log files
+class LogFilter
+{
+public:
+    LogFilter();
+
+    bool isEmpty() const;
+    bool hasPattern() const;
+    // The pattern has no special characters (it can be searched as a fixed string)
+    bool isLiteral() const;
+    bool matchesLevelAndTime(int level, int time) const;
+    bool matches(const DebugRow &row, int level, int time, const QRegExp &regExp) const;
+
+    // QRegExp objects can't be shared between threads, each user creates its own
+    QRegExp createRegExp() const;
+
+    // Levels have the values of MegaApi::LOG_LEVEL_* (-1 if unknown)
+    static int levelFromName(const char *name, int length);
+    static int levelFromName(const QString &name);
+    static QString levelName(int level);
+
+    // Timestamps (MM/dd-hh:mm:ss) as seconds since the beginning of the year (-1 if invalid)
+    static int timeKey(const char *timestamp, int length);
+    // Accepts incomplete timestamps (missing fields are the lowest or highest value)
+    static int timeKey(const QString &timestamp, bool upperBound);
+
+    QString pattern;
+    QRegExp::PatternSyntax syntax;
+    Qt::CaseSensitivity caseSensitivity;
+    int column;
+    int maxLevel;   ///< -1 to show all levels
+    int fromTime;   ///< -1 if unbounded
+    int toTime;     ///< -1 if unbounded
+};
+
+class LogFilterProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit LogFilterProxyModel(QObject *parent = 0);
+    void setFilter(const LogFilter &filter);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
+
+    LogFilter filter;
+    QRegExp regExp;
+};
+
+#endif // LOGMODEL_H
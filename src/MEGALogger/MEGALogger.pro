@@ -6,17 +6,21 @@
 
 QT       += core gui network
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TARGET = MEGAlogger
 TEMPLATE = app
 
 
 SOURCES += main.cpp \
-    MegaDebugServer.cpp
+    MegaDebugServer.cpp \
+    LogModel.cpp \
+    LogFile.cpp
 
 HEADERS  += \
-    MegaDebugServer.h
+    MegaDebugServer.h \
+    LogModel.h \
+    LogFile.h
 
 FORMS    += \
     MegaDebugServer.ui
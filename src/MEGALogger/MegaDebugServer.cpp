@@ -6,6 +6,12 @@
 #define ENABLE_MEGASYNC_LOGS "MEGA_ENABLE_LOGS"
 #define MAX_LOG_MESSAGES 16384
 
+// Binary transport from MEGAsync: the stream starts with LOG_PROTOCOL_MAGIC, then one frame per message:
+// [payload length: 4 bytes, big endian][log level: 1 byte][timestamp length: 1 byte][timestamp][UTF-8 message]
+#define LOG_PROTOCOL_MAGIC "MEGALOG1"
+#define LOG_PROTOCOL_MAGIC_SIZE 8
+#define MAX_FRAME_SIZE 1048576
+
 using namespace std;
 
 MegaDebugServer::MegaDebugServer(QWidget *parent) :
@@ -20,7 +26,8 @@ MegaDebugServer::MegaDebugServer(QWidget *parent) :
     megaServer = NULL;
     debugDataModel = NULL;
     debugProxyModel = NULL;
-    reader = NULL;
+    fileModel = NULL;
+    headerReceived = false;
 
     ui->filterTypeComboBox->addItem("Regular Expression", QRegExp::RegExp);
     ui->filterTypeComboBox->addItem("Wildcard", QRegExp::Wildcard);
@@ -29,11 +36,23 @@ MegaDebugServer::MegaDebugServer(QWidget *parent) :
     ui->columnComboBox->addItem("Timestamp");
     ui->columnComboBox->addItem("Message Type");
     ui->columnComboBox->addItem("Message");
-
-    connect(ui->filterPatternLineEdit, SIGNAL(textChanged(QString)), this, SLOT(filterTextRegExp()));
-    connect(ui->filterTypeComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(filterTextRegExp()));
-    connect(ui->columnComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(filterColumn()));
-    connect(ui->caseSensitivecheckBox, SIGNAL(toggled(bool)), this, SLOT(filterCaseSensitive()));
+    ui->columnComboBox->setCurrentIndex(LogModel::COLUMN_CONTENT);
+
+    // highest level shown (values of MegaApi::LOG_LEVEL_*)
+    ui->levelComboBox->addItem("All", -1);
+    ui->levelComboBox->addItem("Fatal", 0);
+    ui->levelComboBox->addItem("Error", 1);
+    ui->levelComboBox->addItem("Warning", 2);
+    ui->levelComboBox->addItem("Info", 3);
+    ui->levelComboBox->addItem("Debug", 4);
+
+    connect(ui->filterPatternLineEdit, SIGNAL(textChanged(QString)), this, SLOT(applyFilter()));
+    connect(ui->filterTypeComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(applyFilter()));
+    connect(ui->columnComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(applyFilter()));
+    connect(ui->caseSensitivecheckBox, SIGNAL(toggled(bool)), this, SLOT(applyFilter()));
+    connect(ui->levelComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(applyFilter()));
+    connect(ui->fromLineEdit, SIGNAL(textChanged(QString)), this, SLOT(applyFilter()));
+    connect(ui->toLineEdit, SIGNAL(textChanged(QString)), this, SLOT(applyFilter()));
     connect(&timer, SIGNAL(timeout()), this, SLOT(tryConnect()));
 
     connect(ui->actionSave, SIGNAL(triggered()), this, SLOT(saveToFile()));
@@ -41,14 +60,12 @@ MegaDebugServer::MegaDebugServer(QWidget *parent) :
     connect(ui->actionClear, SIGNAL(triggered()), this, SLOT(clearDebugWindow()));
     connect(ui->actionStop, SIGNAL(triggered()), this, SLOT(startstop()));
 
-    debugDataModel = new QStandardItemModel(0, 3, this);
-    debugDataModel->setHeaderData(0, Qt::Horizontal,QString::fromUtf8("Timestamp"), Qt::DisplayRole);
-    debugDataModel->setHeaderData(1, Qt::Horizontal,QString::fromUtf8("Message Type"), Qt::DisplayRole);
-    debugDataModel->setHeaderData(2, Qt::Horizontal,QString::fromUtf8("Message"), Qt::DisplayRole);
+    debugDataModel = new LogModel(MAX_LOG_MESSAGES);
 
-    debugProxyModel = new QSortFilterProxyModel;
+    debugProxyModel = new LogFilterProxyModel;
     debugProxyModel->setSourceModel(debugDataModel);
     ui->messagesTreeView->setModel(debugProxyModel);
+    ui->messagesTreeView->setUniformRowHeights(true);
 
     ui->messagesTreeView->sortByColumn(1, Qt::AscendingOrder);
     ui->messagesTreeView->resizeColumnToContents(0);
@@ -78,57 +95,99 @@ void MegaDebugServer::clientConnected()
         megaSyncClient->disconnectFromServer();
         megaSyncClient->deleteLater();
     }
-    reader = new QXmlStreamReader(megaSyncClient);
+    buffer.clear();
+    headerReceived = false;
 
     connect(megaSyncClient, SIGNAL(readyRead()), this, SLOT(readDebugMsg()));
     connect(megaSyncClient, SIGNAL(disconnected()), this, SLOT(disconnected()));
     connect(megaSyncClient, SIGNAL(error(QLocalSocket::LocalSocketError)), SLOT(disconnected()));
 }
 
-void MegaDebugServer::parseReader(QXmlStreamReader *reader)
-{    
-    do
+bool MegaDebugServer::parseFrames(QList<DebugRow> *rows)
+{
+    // Same values as MegaApi::LOG_LEVEL_*, shared to avoid a copy of the name per message
+    static const QString levels[] = {QString::fromUtf8("fatal"), QString::fromUtf8("error"),
+                                     QString::fromUtf8("warning"), QString::fromUtf8("info"),
+                                     QString::fromUtf8("debug"), QString::fromUtf8("verbose")};
+    static const QString unknownLevel = QString::fromUtf8("unknown");
+
+    int offset = 0;
+    if (!headerReceived)
     {
-        QXmlStreamReader::TokenType token = reader->readNext();
-        if (token == QXmlStreamReader::StartElement && reader->name() == "log")
+        if (buffer.size() < LOG_PROTOCOL_MAGIC_SIZE)
+        {
+            return true;
+        }
+
+        if (!buffer.startsWith(LOG_PROTOCOL_MAGIC))
+        {
+            return false;
+        }
+        offset = LOG_PROTOCOL_MAGIC_SIZE;
+        headerReceived = true;
+    }
+
+    while ((buffer.size() - offset) >= 4)
+    {
+        const unsigned char *data = (const unsigned char *)buffer.constData() + offset;
+        quint32 length = ((quint32)data[0] << 24) | ((quint32)data[1] << 16) | ((quint32)data[2] << 8) | data[3];
+        if (length < 2 || length > MAX_FRAME_SIZE)
+        {
+            return false;
+        }
+
+        if ((quint32)(buffer.size() - offset - 4) < length)
+        {
+            // incomplete frame
+            break;
+        }
+
+        int level = data[4];
+        quint32 timeLength = data[5];
+        if (timeLength > length - 2)
         {
-            QXmlStreamAttributes attr = reader->attributes();
-            DebugRow dr;
-            dr.timeStamp = attr.value(QString::fromUtf8("timestamp")).toString();
-            dr.messageType = attr.value(QString::fromUtf8("type")).toString();
-            dr.content = attr.value(QString::fromUtf8("content")).toString();
-            appendDebugRow(&dr);
+            return false;
         }
-    } while (!reader->error());
+
+        DebugRow dr;
+        dr.timeStamp = QString::fromUtf8((const char *)data + 6, timeLength);
+        dr.messageType = (level < 6) ? levels[level] : unknownLevel;
+        dr.content = QString::fromUtf8((const char *)data + 6 + timeLength, length - 2 - timeLength);
+        rows->append(dr);
+        offset += 4 + length;
+    }
+
+    buffer.remove(0, offset);
+    return true;
 }
 
 void MegaDebugServer::readDebugMsg()
 {
-    parseReader(reader);
+    if (!megaSyncClient)
+    {
+        return;
+    }
+
+    // all the messages available are added in a single batch
+    QList<DebugRow> rows;
+    buffer.append(megaSyncClient->readAll());
+    bool ok = parseFrames(&rows);
+    appendDebugRows(rows);
+    if (!ok)
+    {
+        disconnected();
+        ui->statusBar->showMessage(tr("Unsupported log protocol"));
+    }
 }
 
-void MegaDebugServer::appendDebugRow(DebugRow *dr)
+void MegaDebugServer::appendDebugRows(const QList<DebugRow> &rows)
 {
-    int index = debugDataModel->rowCount();
-
-    if (index >= MAX_LOG_MESSAGES)
+    if (rows.isEmpty())
     {
-        QList<QStandardItem*> items = debugDataModel->takeRow(0);
-        for (int i = 0; i < items.size(); i++)
-        {
-            delete items[i];
-        }
-        index--;
+        return;
     }
 
-    QStandardItem *ts = new QStandardItem(dr->timeStamp);
-    QStandardItem *mt = new QStandardItem(dr->messageType);
-    QStandardItem *c = new QStandardItem(dr->content);
-
-    debugDataModel->setItem(index, 0, ts);
-    debugDataModel->setItem(index, 1, mt);
-    debugDataModel->setItem(index, 2, c);
-
+    debugDataModel->appendRows(rows);
     ui->messagesTreeView->scrollToBottom();
 }
 
@@ -136,6 +195,7 @@ void MegaDebugServer::startstop()
 {
     if (!megaServer)
     {
+        showLiveSession();
         QLocalServer::removeServer(MEGA_LOGGER);
         megaServer = new QLocalServer();
         if (!megaServer->listen(MEGA_LOGGER))
@@ -167,9 +227,9 @@ void MegaDebugServer::disconnected()
 {
     if (megaServer)
     {
-        delete reader;
         megaServer->deleteLater();
-        reader = NULL;
+        buffer.clear();
+        headerReceived = false;
         megaServer = NULL;
         megaSyncClient = NULL;
         ui->actionSave->setEnabled(true);
@@ -185,24 +245,49 @@ void MegaDebugServer::tryConnect()
     client.connectToServer(ENABLE_MEGASYNC_LOGS);
 }
 
-void MegaDebugServer::filterTextRegExp()
+LogFilter MegaDebugServer::currentFilter()
 {
-    qDebug() << ui->filterTypeComboBox->itemData(ui->filterTypeComboBox->currentIndex()).toInt();
-    QRegExp::PatternSyntax syntax = QRegExp::PatternSyntax(ui->filterTypeComboBox->itemData(ui->filterTypeComboBox->currentIndex()).toInt());
-    Qt::CaseSensitivity caseSensitivity = ui->caseSensitivecheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive;
-    QRegExp regExp(ui->filterPatternLineEdit->text(), caseSensitivity, syntax);
-    qDebug() << regExp;
-    debugProxyModel->setFilterRegExp(regExp);
+    LogFilter filter;
+    filter.pattern = ui->filterPatternLineEdit->text();
+    filter.syntax = QRegExp::PatternSyntax(ui->filterTypeComboBox->itemData(ui->filterTypeComboBox->currentIndex()).toInt());
+    filter.caseSensitivity = ui->caseSensitivecheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    filter.column = ui->columnComboBox->currentIndex();
+    filter.maxLevel = ui->levelComboBox->itemData(ui->levelComboBox->currentIndex()).toInt();
+    filter.fromTime = LogFilter::timeKey(ui->fromLineEdit->text(), false);
+    filter.toTime = LogFilter::timeKey(ui->toLineEdit->text(), true);
+    return filter;
 }
 
-void MegaDebugServer::filterColumn()
+void MegaDebugServer::applyFilter()
 {
-    debugProxyModel->setFilterKeyColumn(ui->columnComboBox->currentIndex());
+    if (!debugProxyModel)
+    {
+        return;
+    }
+
+    // log files are filtered in the background
+    LogFilter filter = currentFilter();
+    if (fileModel)
+    {
+        fileModel->setFilter(filter);
+    }
+    else
+    {
+        debugProxyModel->setFilter(filter);
+    }
 }
 
-void MegaDebugServer::filterCaseSensitive()
+void MegaDebugServer::showLiveSession()
 {
-    debugProxyModel->setSortCaseSensitivity(ui->caseSensitivecheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive);
+    if (!fileModel)
+    {
+        return;
+    }
+
+    ui->messagesTreeView->setModel(debugProxyModel);
+    delete fileModel;
+    fileModel = NULL;
+    applyFilter();
 }
 
 void MegaDebugServer::saveToFile()
@@ -227,7 +312,7 @@ void MegaDebugServer::saveToFile()
     QXmlStreamWriter xmlWriterLog(&ba);
     QDataStream out(&file);
     out.setVersion(QDataStream::Qt_4_8);
-    qint32 n(debugDataModel->rowCount());
+    qint32 n(fileModel ? fileModel->lineCount() : debugDataModel->rowCount());
 
     /* Writes a document start with the XML version number. */
     xmlWriterLog.writeStartDocument();
@@ -235,12 +320,13 @@ void MegaDebugServer::saveToFile()
     for (int i = 0; i < n; i++)
     {
         xmlWriterLog.writeStartElement("log");
+        DebugRow dr = fileModel ? fileModel->sourceRow(i) : debugDataModel->row(i);
         //Add timestamp and value
-        xmlWriterLog.writeAttribute("timestamp", debugDataModel->item(i,0)->text());
+        xmlWriterLog.writeAttribute("timestamp", dr.timeStamp);
         //Add type and value
-        xmlWriterLog.writeAttribute("type", debugDataModel->item(i,1)->text());
+        xmlWriterLog.writeAttribute("type", dr.messageType);
         //Add content and value
-        xmlWriterLog.writeAttribute("content", debugDataModel->item(i,2)->text());
+        xmlWriterLog.writeAttribute("content", dr.content);
         xmlWriterLog.writeEndElement();
     }
 
@@ -256,38 +342,33 @@ void MegaDebugServer::loadFromFile()
 {
     QString fileName = QFileDialog::getOpenFileName(this,
              tr("Open Log File"), "",
-             tr("Log File (*.dat);;All Files (*)"));
+             tr("Log File (*.dat *.log);;All Files (*)"));
 
     if (fileName.isEmpty())
     {
         return;
     }
 
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly))
-    {
-        QMessageBox::information(this, tr("Unable to open file"), file.errorString());
-        return;
-    }
-
-    clearDebugWindow();
-
-    QDataStream in(&file);
-    QByteArray ba;
-    in >> ba;
-
-    QXmlStreamReader xmlLoad(qUncompress(ba));
-    parseReader(&xmlLoad);
-    file.close();
+    // Saved sessions and MEGAsync.log files are indexed in the background,
+    // only the rows shown in the view are read from the file
+    LogFileModel *model = new LogFileModel(fileName, this);
+    connect(model, SIGNAL(statusChanged(QString)), ui->statusBar, SLOT(showMessage(QString)));
+    ui->messagesTreeView->setModel(model);
+    delete fileModel;
+    fileModel = model;
+    fileModel->setFilter(currentFilter());
+    fileModel->load();
 }
 
 void MegaDebugServer::clearDebugWindow()
 {
-    debugDataModel->removeRows(0,debugDataModel->rowCount());
+    showLiveSession();
+    debugDataModel->clear();
 }
 MegaDebugServer::~MegaDebugServer()
 {
     disconnected();
+    delete fileModel;
     delete debugDataModel;
     delete debugProxyModel;
     delete ui;
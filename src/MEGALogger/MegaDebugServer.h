@@ -6,19 +6,13 @@
 #include <QLocalSocket>
 #include <QObject>
 #include <QSortFilterProxyModel>
-#include <QStandardItemModel>
 #include <QXmlStreamReader>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QTimer>
 
-struct DebugRow
-{
-    QString timeStamp;
-    QString messageType;
-    QString content;
-
-};
+#include "LogModel.h"
+#include "LogFile.h"
 
 namespace Ui {
 class MegaDebugServer;
@@ -37,11 +31,13 @@ private:
     Ui::MegaDebugServer *ui;
     QLocalServer *megaServer;
     QLocalSocket *megaSyncClient;
-    QXmlStreamReader *reader;
+    QByteArray buffer;          ///< Received bytes not parsed yet
+    bool headerReceived;
     QLocalSocket client;
 
-    QSortFilterProxyModel *debugProxyModel;
-    QStandardItemModel *debugDataModel;
+    LogFilterProxyModel *debugProxyModel;
+    LogModel *debugDataModel;
+    LogFileModel *fileModel;    ///< Log file being shown instead of the live session
     QTimer timer;
 
 private slots:
@@ -51,18 +47,18 @@ private slots:
     void disconnected();
     void tryConnect();
 
-    void filterTextRegExp();
-    void filterColumn();
-    void filterCaseSensitive();
+    void applyFilter();
 
-    void appendDebugRow(DebugRow *);
+    void appendDebugRows(const QList<DebugRow> &rows);
 
     void saveToFile();
     void loadFromFile();
     void clearDebugWindow();
 
 public:
-    void parseReader(QXmlStreamReader *);
+    bool parseFrames(QList<DebugRow> *rows);
+    LogFilter currentFilter();
+    void showLiveSession();
 
 };
 
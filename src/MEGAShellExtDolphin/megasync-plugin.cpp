@@ -268,7 +268,7 @@ QString MEGASyncPlugin::sendRequest(char type, QString command)
             return QString();
     }
 
-    req.sprintf("%c:%s", type, command.toUtf8().constData());
+    req.sprintf("%c:%s\n", type, command.toUtf8().constData());
 
     sock.write(req.toUtf8());
     sock.flush();
@@ -7,6 +7,9 @@
 #include "mega_notify_client.h"
 #include <string.h>
 
+// max number of cached states, the cache is cleared when it's exceeded
+#define MAX_CACHED_STATES 200000
+
 static GObjectClass *parent_class;
 
 static void mega_ext_class_init(MEGAExtClass *class)
@@ -21,6 +24,9 @@ static void mega_ext_instance_init(MEGAExt *mega_ext)
     mega_ext->chan = NULL;
     mega_ext->num_retries = 2;
     mega_ext->h_syncs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    mega_ext->h_states = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    mega_ext->h_prefetched_dirs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    mega_ext->states_pushed = FALSE;
     mega_ext->string_getlink = NULL;
     mega_ext->string_viewonmega = NULL;
     mega_ext->string_viewprevious = NULL;
@@ -53,6 +59,9 @@ static const gchar *file_state_to_str(FileState state)
 void mega_ext_on_item_changed(MEGAExt *mega_ext, const gchar *path)
 {
     GFile *f;
+
+    g_hash_table_remove(mega_ext->h_states, path);
+
     f = g_file_new_for_path(path);
     if (!f) {
         g_debug("No file found for %s!", path);
@@ -68,6 +77,40 @@ void mega_ext_on_item_changed(MEGAExt *mega_ext, const gchar *path)
     nautilus_info_provider_update_file_info((NautilusInfoProvider*)mega_ext, file, (void*)1, (void*)1);
 }
 
+// received the new state of a changed item from notify server
+// only the states of items being displayed are kept in the cache
+void mega_ext_on_item_state(MEGAExt *mega_ext, const gchar *path, FileState state)
+{
+    GFile *f;
+
+    g_hash_table_remove(mega_ext->h_states, path);
+
+    f = g_file_new_for_path(path);
+    if (!f) {
+        g_debug("No file found for %s!", path);
+        return;
+    }
+
+    NautilusFileInfo *file = nautilus_file_info_lookup(f);
+    if (!file) {
+        return;
+    }
+    g_debug("Item state changed: %s  State: %s", path, file_state_to_str(state));
+    // FILE_NOTFOUND isn't cached, the state is asked again when needed
+    if (mega_ext->states_pushed && state != FILE_NOTFOUND)
+        g_hash_table_insert(mega_ext->h_states, g_strdup(path), GINT_TO_POINTER(state));
+    nautilus_info_provider_update_file_info((NautilusInfoProvider*)mega_ext, file, (void*)1, (void*)1);
+}
+
+// cached states are no longer valid
+// pushed: TRUE if notify server will push the new states of changed items
+void mega_ext_on_states_reset(MEGAExt *mega_ext, gboolean pushed)
+{
+    g_debug("States reset, pushed: %d", pushed);
+    mega_ext_clear_cache(mega_ext);
+    mega_ext->states_pushed = pushed;
+}
+
 // user clicked on "Upload to MEGA" menu item
 static void mega_ext_on_upload_selected(NautilusMenuItem *item, gpointer user_data)
 {
@@ -111,12 +154,14 @@ void mega_ext_on_sync_add(MEGAExt *mega_ext, const gchar *path)
         return;
     g_debug("New sync path: %s", path);
     g_hash_table_insert(mega_ext->h_syncs, g_strdup(path), GINT_TO_POINTER(1));
+    mega_ext_clear_cache(mega_ext);
 }
 
 void mega_ext_on_sync_del(MEGAExt *mega_ext, const gchar *path)
 {
     g_debug("Deleted sync path: %s", path);
     g_hash_table_remove(mega_ext->h_syncs, path);
+    mega_ext_clear_cache(mega_ext);
 }
 
 
@@ -169,6 +214,87 @@ static gboolean mega_ext_path_in_sync(MEGAExt *mega_ext, const gchar *path)
     return found;
 }
 
+void mega_ext_clear_cache(MEGAExt *mega_ext)
+{
+    g_hash_table_remove_all(mega_ext->h_states);
+    g_hash_table_remove_all(mega_ext->h_prefetched_dirs);
+}
+
+// request the state of all the items of a folder in a single batch
+static void mega_ext_prefetch_dir(MEGAExt *mega_ext, const gchar *dirname)
+{
+    GDir *dir;
+    const gchar *name;
+    GPtrArray *paths;
+    FileState *states;
+    guint i;
+
+    if (g_hash_table_size(mega_ext->h_states) > MAX_CACHED_STATES)
+        mega_ext_clear_cache(mega_ext);
+
+    // don't try again even if the request fails
+    g_hash_table_insert(mega_ext->h_prefetched_dirs, g_strdup(dirname), GINT_TO_POINTER(1));
+
+    dir = g_dir_open(dirname, 0, NULL);
+    if (!dir)
+        return;
+
+    paths = g_ptr_array_new();
+    while ((name = g_dir_read_name(dir)))
+        g_ptr_array_add(paths, g_build_filename(dirname, name, NULL));
+    g_dir_close(dir);
+
+    states = g_new(FileState, paths->len);
+    if (mega_ext_client_get_path_states(mega_ext, (gchar **)paths->pdata, paths->len, 0, states)) {
+        for (i = 0; i < paths->len; i++) {
+            // the hash table takes the ownership of the path
+            g_hash_table_insert(mega_ext->h_states, g_ptr_array_index(paths, i), GINT_TO_POINTER(states[i]));
+        }
+    } else {
+        for (i = 0; i < paths->len; i++)
+            g_free(g_ptr_array_index(paths, i));
+    }
+    g_free(states);
+    g_ptr_array_free(paths, TRUE);
+}
+
+// get the state of an item located in a sync folder
+// States are answered from the local cache, that the notify server keeps
+// up to date pushing the new state of changed items. On a cache miss
+// the states of the item and all its siblings are requested in a batch,
+// so a folder listing costs O(1) round trips instead of one per item
+static FileState mega_ext_get_path_state(MEGAExt *mega_ext, const gchar *path)
+{
+    FileState state;
+    gpointer value;
+    gchar *dirname;
+
+    if (mega_ext->states_pushed) {
+        if (g_hash_table_lookup_extended(mega_ext->h_states, path, NULL, &value))
+            return GPOINTER_TO_INT(value);
+
+        dirname = g_path_get_dirname(path);
+        if (!g_hash_table_lookup(mega_ext->h_prefetched_dirs, dirname))
+            mega_ext_prefetch_dir(mega_ext, dirname);
+        g_free(dirname);
+
+        if (g_hash_table_lookup_extended(mega_ext->h_states, path, NULL, &value))
+            return GPOINTER_TO_INT(value);
+    }
+
+    state = mega_ext_client_get_path_state(mega_ext, path, 0);
+    if (state == FILE_NOTFOUND)
+    {
+        char canonical[PATH_MAX];
+        expanselocalpath(path,canonical);
+        state = mega_ext_client_get_path_state(mega_ext, canonical, 0);
+    }
+
+    if (mega_ext->states_pushed && state != FILE_ERROR)
+        g_hash_table_insert(mega_ext->h_states, g_strdup(path), GINT_TO_POINTER(state));
+    return state;
+}
+
 // user clicked on "Get MEGA link" menu item
 static void mega_ext_on_get_link_selected(NautilusMenuItem *item, gpointer user_data)
 {
@@ -295,13 +421,21 @@ static GList *mega_ext_get_file_items(NautilusMenuProvider *provider, G_GNUC_UNU
 
     syncedFiles = syncedFolders = unsyncedFiles = unsyncedFolders = 0;
 
-    // get list of selected objects
-    for (l = files; l != NULL; l = l->next)
+    // get the paths of the selected objects located in synced folders
+    // to request their states in a single batch
+    guint num_files = g_list_length(files);
+    gchar **paths = g_new0(gchar *, num_files);
+    guint *path_files = g_new(guint, num_files);
+    FileState *states = g_new(FileState, num_files);
+    guint num_paths = 0;
+    guint i;
+    for (l = files, i = 0; l != NULL; l = l->next, i++)
     {
         NautilusFileInfo *file = NAUTILUS_FILE_INFO(l->data);
         gchar *path;
         GFile *fp;
-        FileState state;
+
+        states[i] = FILE_ERROR;
 
         fp = nautilus_file_info_get_location(file);
         if (!fp)
@@ -319,19 +453,31 @@ static GList *mega_ext_get_file_items(NautilusMenuProvider *provider, G_GNUC_UNU
         // but make sure we received the list of synced folders first
         if (mega_ext->syncs_received && !mega_ext_path_in_sync(mega_ext, path))
         {
-            state = FILE_NOTFOUND;
-        }
-        else
-        {
-            state = mega_ext_client_get_path_state(mega_ext, path, 1);
-            if (state == FILE_NOTFOUND)
-            {
-                char canonical[PATH_MAX];
-                expanselocalpath(path,canonical);
-                state = mega_ext_client_get_path_state(mega_ext, canonical, 1);
-            }
+            states[i] = FILE_NOTFOUND;
+            g_free(path);
+            continue;
         }
-        g_free(path);
+
+        path_files[num_paths] = i;
+        paths[num_paths++] = path;
+    }
+
+    FileState *path_states = g_new(FileState, num_paths);
+    gboolean batched = num_paths && mega_ext_client_get_path_states(mega_ext, paths, num_paths, 1, path_states);
+    for (i = 0; i < num_paths; i++)
+    {
+        states[path_files[i]] = batched ? path_states[i] : mega_ext_client_get_path_state(mega_ext, paths[i], 1);
+        g_free(paths[i]);
+    }
+    g_free(path_states);
+    g_free(path_files);
+    g_free(paths);
+
+    // get list of selected objects
+    for (l = files, i = 0; l != NULL; l = l->next, i++)
+    {
+        NautilusFileInfo *file = NAUTILUS_FILE_INFO(l->data);
+        FileState state = states[i];
 
         if (state == FILE_ERROR)
         {
@@ -366,6 +512,7 @@ static GList *mega_ext_get_file_items(NautilusMenuProvider *provider, G_GNUC_UNU
             }
         }
     }
+    g_free(states);
 
 
     NautilusMenuItem *root_menu_item = nautilus_menu_item_new("NautilusObj::root_menu_item",
@@ -482,13 +629,7 @@ static NautilusOperationResult mega_ext_update_file_info(NautilusInfoProvider *p
     }
     g_debug("mega_ext_update_file_info %s", path);
 
-    state = mega_ext_client_get_path_state(mega_ext, path, 0);
-    if (state == FILE_NOTFOUND)
-    {
-        char canonical[PATH_MAX];
-        expanselocalpath(path,canonical);
-        state = mega_ext_client_get_path_state(mega_ext, canonical, 0);
-    }
+    state = mega_ext_get_path_state(mega_ext, path);
 
     g_debug("mega_ext_update_file_info. File: %s  State: %s", path, file_state_to_str(state));
     g_free(path);
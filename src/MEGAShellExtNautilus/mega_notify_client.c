@@ -69,6 +69,13 @@ static gboolean mega_notify_client_try_connect(MEGAExt *mega_ext)
         return FALSE;
     }
 
+    // ask for the new states of changed items to keep the cache up to date
+    if (write(mega_ext->notify_sock, "S\n", 2) != 2) {
+        g_warning("write() failed: %s", strerror(errno));
+        mega_notify_client_destroy(mega_ext);
+        return FALSE;
+    }
+
     return TRUE;
 }
 
@@ -83,6 +90,9 @@ void mega_notify_client_destroy(MEGAExt *mega_ext)
         close(mega_ext->notify_sock);
     mega_ext->notify_sock = -1;
     mega_ext->syncs_received = FALSE;
+
+    // changes won't be notified anymore
+    mega_ext_on_states_reset(mega_ext, FALSE);
 }
 
 static gboolean mega_notify_client_read(GIOChannel *notify_chan, GIOCondition condition, gpointer data)
@@ -133,6 +143,12 @@ static gboolean mega_notify_client_read(GIOChannel *notify_chan, GIOCondition co
         case 'P': // item state changed
             mega_ext_on_item_changed(mega_ext, p);
             break;
+        case 'S': // item state changed, the new state is included
+            mega_ext_on_item_state(mega_ext, p + 1, p[0] - '0');
+            break;
+        case 'C': // cached states must be discarded
+            mega_ext_on_states_reset(mega_ext, p[0] == '1');
+            break;
         case 'A': // sync folder added
             mega_ext_on_sync_add(mega_ext, p);
             mega_ext->syncs_received = TRUE;
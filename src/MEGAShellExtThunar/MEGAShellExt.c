@@ -1,6 +1,7 @@
 
 #include "MEGAShellExt.h"
 #include "mega_ext_client.h"
+#include "mega_notify_client.h"
 #include <string.h>
 
 G_MODULE_EXPORT void thunar_extension_initialize(ThunarxProviderPlugin *plugin);
@@ -63,7 +64,11 @@ static void mega_ext_init(MEGAExt *mega_ext)
     mega_ext->srv_sock = -1;
     mega_ext->chan = NULL;
     mega_ext->num_retries = 2;
+    mega_ext->notify_sock = -1;
+    mega_ext->notify_chan = NULL;
     mega_ext->h_syncs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    mega_ext->h_states = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    mega_ext->states_pushed = FALSE;
     mega_ext->string_getlink = NULL;
     mega_ext->string_viewonmega = NULL;
     mega_ext->string_viewprevious = NULL;
@@ -72,6 +77,9 @@ static void mega_ext_init(MEGAExt *mega_ext)
 
     // ignore SIGPIPE as we most likely will write to a closed socket in mega_notify_client_read()
     signal(SIGPIPE, SIG_IGN);
+
+    // start notification client
+    mega_notify_client_timer_start(mega_ext);
 }
 
 static void mega_ext_menu_provider_init(ThunarxMenuProviderIface *iface)
@@ -95,6 +103,53 @@ static const gchar *file_state_to_str(FileState state)
     }
 }
 
+// received path from notify server with the path to item which state was changed
+void mega_ext_on_item_changed(MEGAExt *mega_ext, const gchar *path)
+{
+    g_hash_table_remove(mega_ext->h_states, path);
+}
+
+// received the new state of a changed item from notify server
+// only the states of items already in the cache are updated
+void mega_ext_on_item_state(MEGAExt *mega_ext, const gchar *path, FileState state)
+{
+    if (mega_ext->states_pushed && g_hash_table_lookup_extended(mega_ext->h_states, path, NULL, NULL))
+    {
+        g_debug("Item state changed: %s  State: %s", path, file_state_to_str(state));
+        // FILE_NOTFOUND isn't cached, the state is asked again when needed
+        if (state == FILE_NOTFOUND)
+            g_hash_table_remove(mega_ext->h_states, path);
+        else
+            g_hash_table_insert(mega_ext->h_states, g_strdup(path), GINT_TO_POINTER(state));
+    }
+}
+
+// cached states are no longer valid
+// pushed: TRUE if notify server will push the new states of changed items
+void mega_ext_on_states_reset(MEGAExt *mega_ext, gboolean pushed)
+{
+    g_debug("States reset, pushed: %d", pushed);
+    g_hash_table_remove_all(mega_ext->h_states);
+    mega_ext->states_pushed = pushed;
+}
+
+void mega_ext_on_sync_add(MEGAExt *mega_ext, const gchar *path)
+{
+    // ignore empty sync
+    if (!strcmp(path, "."))
+        return;
+    g_debug("New sync path: %s", path);
+    g_hash_table_insert(mega_ext->h_syncs, g_strdup(path), GINT_TO_POINTER(1));
+    g_hash_table_remove_all(mega_ext->h_states);
+}
+
+void mega_ext_on_sync_del(MEGAExt *mega_ext, const gchar *path)
+{
+    g_debug("Deleted sync path: %s", path);
+    g_hash_table_remove(mega_ext->h_syncs, path);
+    g_hash_table_remove_all(mega_ext->h_states);
+}
+
 // user clicked on "Upload to MEGA" menu item
 static void mega_ext_on_upload_selected(GtkAction *action, gpointer user_data)
 {
@@ -146,6 +201,30 @@ void expanselocalpath(char *path, char *absolutepath)
     }
 }
 
+// get the state of an item located in a sync folder
+// States are answered from the local cache, that the notify server keeps
+// up to date pushing the new state of changed items
+static FileState mega_ext_get_path_state(MEGAExt *mega_ext, const gchar *path, int forceGetState)
+{
+    FileState state;
+    gpointer value;
+
+    if (mega_ext->states_pushed && g_hash_table_lookup_extended(mega_ext->h_states, path, NULL, &value))
+        return GPOINTER_TO_INT(value);
+
+    state = mega_ext_client_get_path_state(mega_ext, path, forceGetState);
+    if (state == FILE_NOTFOUND)
+    {
+        char canonical[PATH_MAX];
+        expanselocalpath(path,canonical);
+        state = mega_ext_client_get_path_state(mega_ext, canonical, forceGetState);
+    }
+
+    if (mega_ext->states_pushed && state != FILE_ERROR)
+        g_hash_table_insert(mega_ext->h_states, g_strdup(path), GINT_TO_POINTER(state));
+    return state;
+}
+
 // user clicked on "Get MEGA link" menu item
 static void mega_ext_on_get_link_selected(GtkAction *action, gpointer user_data)
 {
@@ -269,13 +348,22 @@ static GList* mega_ext_get_file_actions(ThunarxMenuProvider *provider, G_GNUC_UN
 
     syncedFiles = syncedFolders = unsyncedFiles = unsyncedFolders = 0;
 
-    // get list of selected objects
-    for (l = files; l != NULL; l = l->next)
+    // get the paths of the selected objects located in synced folders
+    // whose states aren't cached, to request them in a single batch
+    guint num_files = g_list_length(files);
+    gchar **paths = g_new0(gchar *, num_files);
+    guint *path_files = g_new(guint, num_files);
+    FileState *states = g_new(FileState, num_files);
+    guint num_paths = 0;
+    guint i;
+    gpointer value;
+    for (l = files, i = 0; l != NULL; l = l->next, i++)
     {
         ThunarxFileInfo *file = THUNARX_FILE_INFO(l->data);
         gchar *path;
         GFile *fp;
-        FileState state;
+
+        states[i] = FILE_ERROR;
 
         fp = thunarx_file_info_get_location(file);
         if (!fp)
@@ -293,19 +381,51 @@ static GList* mega_ext_get_file_actions(ThunarxMenuProvider *provider, G_GNUC_UN
         // but make sure we received the list of synced folders first
         if (mega_ext->syncs_received && !mega_ext_path_in_sync(mega_ext, path))
         {
-            state = FILE_NOTFOUND;
+            states[i] = FILE_NOTFOUND;
+            g_free(path);
+            continue;
         }
-        else
+
+        if (mega_ext->states_pushed && g_hash_table_lookup_extended(mega_ext->h_states, path, NULL, &value))
         {
-            state = mega_ext_client_get_path_state(mega_ext, path, 1);
-            if (state == FILE_NOTFOUND)
+            states[i] = GPOINTER_TO_INT(value);
+            g_free(path);
+            continue;
+        }
+
+        path_files[num_paths] = i;
+        paths[num_paths++] = path;
+    }
+
+    FileState *path_states = g_new(FileState, num_paths);
+    gboolean batched = num_paths && mega_ext_client_get_path_states(mega_ext, paths, num_paths, 1, path_states);
+    for (i = 0; i < num_paths; i++)
+    {
+        if (batched)
+        {
+            states[path_files[i]] = path_states[i];
+            if (mega_ext->states_pushed && path_states[i] != FILE_ERROR)
             {
-                char canonical[PATH_MAX];
-                expanselocalpath(path,canonical);
-                state = mega_ext_client_get_path_state(mega_ext, canonical, 1);
+                // the hash table takes the ownership of the path
+                g_hash_table_insert(mega_ext->h_states, paths[i], GINT_TO_POINTER(path_states[i]));
+                continue;
             }
         }
-        g_free(path);
+        else
+        {
+            states[path_files[i]] = mega_ext_get_path_state(mega_ext, paths[i], 1);
+        }
+        g_free(paths[i]);
+    }
+    g_free(path_states);
+    g_free(path_files);
+    g_free(paths);
+
+    // get list of selected objects
+    for (l = files, i = 0; l != NULL; l = l->next, i++)
+    {
+        ThunarxFileInfo *file = THUNARX_FILE_INFO(l->data);
+        FileState state = states[i];
 
         if (state == FILE_ERROR)
         {
@@ -340,6 +460,8 @@ static GList* mega_ext_get_file_actions(ThunarxMenuProvider *provider, G_GNUC_UN
             }
         }
     }
+    g_free(states);
+
     // if there any unsynced files / folders selected
     if (unsyncedFiles || unsyncedFolders)
     {
@@ -448,13 +570,7 @@ static GList* mega_ext_get_folder_actions(ThunarxMenuProvider *provider, G_GNUC_
     } 
     else
     {
-        state = mega_ext_client_get_path_state(mega_ext, path, 0);
-        if (state == FILE_NOTFOUND)
-        {
-            char canonical[PATH_MAX];
-            expanselocalpath(path,canonical);
-            state = mega_ext_client_get_path_state(mega_ext, canonical, 0);
-        }
+        state = mega_ext_get_path_state(mega_ext, path, 0);
     }
     g_free(path);
 
@@ -33,6 +33,8 @@ struct _MEGAExt
     gboolean syncs_received; // TRUE if the list with sync folders is received
 
     GHashTable *h_syncs; // table of paths of shared folders
+    GHashTable *h_states; // cache of states of items located in sync folders
+    gboolean states_pushed; // TRUE if the notify server pushes the new states of changed items
     gchar *string_upload; // cached string
     gchar *string_getlink; // cached string
     gchar *string_viewonmega; // cached string
@@ -63,4 +65,10 @@ void  mega_ext_register_type(ThunarxProviderPlugin *plugin);
 
 G_END_DECLS;
 
+void mega_ext_on_item_changed(MEGAExt *mega_ext, const gchar *path);
+void mega_ext_on_item_state(MEGAExt *mega_ext, const gchar *path, FileState state);
+void mega_ext_on_states_reset(MEGAExt *mega_ext, gboolean pushed);
+void mega_ext_on_sync_add(MEGAExt *mega_ext, const gchar *path);
+void mega_ext_on_sync_del(MEGAExt *mega_ext, const gchar *path);
+
 #endif
@@ -4,10 +4,12 @@ TARGET = MEGAShellExtThunar
 TEMPLATE = lib
 
 SOURCES += MEGAShellExt.c \
-    mega_ext_client.c
+    mega_ext_client.c \
+    mega_notify_client.c
 
 HEADERS += MEGAShellExt.h \
-    mega_ext_client.h
+    mega_ext_client.h \
+    mega_notify_client.h
 
 CONFIG += link_pkgconfig
 PKGCONFIG+=thunarx-2 glib-2.0
@@ -5,6 +5,7 @@
 #include <string.h>
 
 const gchar OP_PATH_STATE  = 'P'; //Path state
+const gchar OP_PATH_STATE_BATCH = 'Q'; //Path state of several objects
 const gchar OP_INIT        = 'I'; //Init operation
 const gchar OP_END         = 'E'; //End operation
 const gchar OP_UPLOAD      = 'F'; //File-Folder upload
@@ -15,6 +16,14 @@ const gchar OP_STRING      = 'T'; //Get Translated String
 const gchar OP_VIEW        = 'V'; //View on MEGA
 const gchar OP_PREVIOUS    = 'R'; //View previous versions
 
+// max number of paths sent in a single batch request
+#define MAX_PATHS_PER_BATCH 256
+// max number of batch requests sent before waiting for the first response
+#define MAX_REQUESTS_IN_FLIGHT 8
+
+// bytes that delimit requests and the paths of a batch
+#define FRAME_SEPARATORS "\n\x1C\x1E"
+
 static void mega_ext_client_disconnect(MEGAExt *mega_ext);
 
 // try to connect to the server
@@ -90,6 +99,12 @@ static gchar *mega_ext_client_send_request(MEGAExt *mega_ext, gchar type, const
     GIOStatus status;
     gint num_retries;
 
+    // a line break would split the request
+    if (strchr(in, '\n')) {
+        g_debug("Invalid request");
+        return NULL;
+    }
+
     g_debug("Sending request: %s ", in);
 
     // try to send request several times
@@ -102,7 +117,7 @@ static gchar *mega_ext_client_send_request(MEGAExt *mega_ext, gchar type, const
         }
 
         // format request string
-        tmp = g_strdup_printf("%c:%s", type, in);
+        tmp = g_strdup_printf("%c:%s\n", type, in);
 
         error = NULL;
         // try to send request
@@ -144,6 +159,146 @@ static gchar *mega_ext_client_send_request(MEGAExt *mega_ext, gchar type, const
     return out;
 }
 
+// send a '\n'-terminated request without waiting for the response
+static gboolean mega_ext_client_write_request(MEGAExt *mega_ext, gchar type, const gchar *in, gsize len)
+{
+    gsize bytes_written;
+    GError *error = NULL;
+    GIOStatus status;
+    gchar header[2] = { type, ':' };
+
+    status = g_io_channel_write_chars(mega_ext->chan, header, sizeof(header), &bytes_written, &error);
+    if (status == G_IO_STATUS_NORMAL && !error)
+        status = g_io_channel_write_chars(mega_ext->chan, in, len, &bytes_written, &error);
+    if (status == G_IO_STATUS_NORMAL && !error)
+        status = g_io_channel_write_chars(mega_ext->chan, "\n", 1, &bytes_written, &error);
+    if (status != G_IO_STATUS_NORMAL || error) {
+        g_warning("Failed to write data!");
+        if (error)
+            g_error_free(error);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// read the response to the oldest request in flight
+// Return newly-allocated response string without the line terminator
+static gchar *mega_ext_client_read_response(MEGAExt *mega_ext)
+{
+    gchar *out = NULL;
+    gsize term_pos = 0;
+    GError *error = NULL;
+    GIOStatus status;
+
+    status = g_io_channel_flush(mega_ext->chan, &error);
+    if (status != G_IO_STATUS_NORMAL || error) {
+        g_debug("Failed to flush data!");
+        if (error)
+            g_error_free(error);
+        return NULL;
+    }
+
+    status = g_io_channel_read_line(mega_ext->chan, &out, NULL, &term_pos, &error);
+    if (status != G_IO_STATUS_NORMAL || error) {
+        g_warning("Failed to read data!");
+        if (error)
+            g_error_free(error);
+        g_free(out);
+        return NULL;
+    }
+
+    if (term_pos)
+        out[term_pos] = '\0';
+    return out;
+}
+
+// get the state of num_paths objects using batch requests
+// Requests are pipelined: up to MAX_REQUESTS_IN_FLIGHT batches are sent
+// before reading the first response
+// states: output array with num_paths elements
+// Return FALSE if the server didn't answer or doesn't support batch requests
+gboolean mega_ext_client_get_path_states(MEGAExt *mega_ext, gchar **paths, guint num_paths, int forceGetState, FileState *states)
+{
+    guint sent, received, i, first, count;
+    gint num_retries;
+    GString *frame;
+    gchar *out;
+    gchar canonical[PATH_MAX];
+
+    g_debug("Sending batch request: %u paths", num_paths);
+
+    for (i = 0; i < num_paths; i++)
+        states[i] = FILE_ERROR;
+
+    // try to send requests several times
+    for (num_retries = 0; num_retries < mega_ext->num_retries; num_retries++) {
+        if (mega_ext->srv_sock < 0) {
+            if (!mega_ext_client_reconnect(mega_ext)) {
+                g_debug("Failed to reconnect!");
+                continue;
+            }
+        }
+
+        frame = g_string_new(NULL);
+        sent = received = 0;
+        while (received < num_paths) {
+            // keep the pipeline full
+            while (sent < num_paths && (sent - received) < MAX_PATHS_PER_BATCH * MAX_REQUESTS_IN_FLIGHT) {
+                g_string_truncate(frame, 0);
+                for (i = sent; i < num_paths && (i - sent) < MAX_PATHS_PER_BATCH; i++) {
+                    if (i != sent)
+                        g_string_append_c(frame, (gchar)0x1E);
+                    // paths with separators can't be sent, their state is FILE_ERROR
+                    if (strpbrk(paths[i], FRAME_SEPARATORS))
+                        continue;
+                    canonical[0] = '\0';
+                    expanselocalpath(paths[i], canonical);
+                    g_string_append(frame, canonical);
+                }
+                g_string_append_printf(frame, "%c%c", (gchar)0x1C, forceGetState ? '1' : '0');
+
+                if (!mega_ext_client_write_request(mega_ext, OP_PATH_STATE_BATCH, frame->str, frame->len))
+                    break;
+                sent = i;
+            }
+
+            first = received;
+            count = MIN(MAX_PATHS_PER_BATCH, num_paths - first);
+            out = (sent > received) ? mega_ext_client_read_response(mega_ext) : NULL;
+            if (!out)
+                break;
+
+            if (strlen(out) != count) {
+                // the server doesn't support batch requests,
+                // drop the connection to discard the rest of its answers
+                g_debug("Unexpected batch response: %s ", out);
+                for (i = 0; i < num_paths; i++)
+                    states[i] = FILE_ERROR;
+                g_free(out);
+                g_string_free(frame, TRUE);
+                mega_ext_client_disconnect(mega_ext);
+                return FALSE;
+            }
+
+            for (i = 0; i < count; i++)
+                states[first + i] = strpbrk(paths[first + i], FRAME_SEPARATORS) ? FILE_ERROR : out[i] - '0';
+            g_free(out);
+            received += count;
+        }
+        g_string_free(frame, TRUE);
+
+        if (received == num_paths) {
+            g_debug("Batch request responded: %u paths", num_paths);
+            return TRUE;
+        }
+
+        // responses to the requests in flight are lost, start again
+        mega_ext_client_disconnect(mega_ext);
+    }
+
+    return FALSE;
+}
+
 // return a newly-allocated string
 gchar *mega_ext_client_get_string(MEGAExt *mega_ext, int stringID, int numFiles, int numFolders)
 {
@@ -18,6 +18,9 @@
 
 #ifdef Q_OS_LINUX
     #include <QSvgRenderer>
+    #include <stdio.h>
+    #include <string.h>
+    #include "platform/linux/NetworkMonitor.h"
 #endif
 
 #if QT_VERSION >= 0x050000
@@ -404,7 +407,7 @@ int main(int argc, char *argv[])
 }
 
 MegaApplication::MegaApplication(int &argc, char **argv) :
-    QApplication(argc, argv)
+    QApplication(argc, argv), finishedTransfers(Preferences::MAX_COMPLETED_ITEMS)
 {
     appfinished = false;
     logger = new MegaSyncLogger(this);
@@ -498,6 +501,12 @@ MegaApplication::MegaApplication(int &argc, char **argv) :
     delegateListener = NULL;
     httpServer = NULL;
     httpsServer = NULL;
+    uploader = NULL;
+    downloader = NULL;
+    networkChangeTimer = NULL;
+#ifdef Q_OS_LINUX
+    networkMonitor = NULL;
+#endif
     numTransfers[MegaTransfer::TYPE_DOWNLOAD] = 0;
     numTransfers[MegaTransfer::TYPE_UPLOAD] = 0;
     exportOps = 0;
@@ -728,6 +737,9 @@ void MegaApplication::initialize()
     megaApi->addListener(delegateListener);
     uploader = new MegaUploader(megaApi);
     downloader = new MegaDownloader(megaApi);
+    finishedTransfers.setCapacity(preferences->maxCompletedTransfers());
+    connect(downloader, SIGNAL(progress(int, int, bool)), this, SLOT(onDownloadPlanningProgress(int, int, bool)));
+    connect(uploader, SIGNAL(progress(int, int, int, bool)), this, SLOT(onUploadPlanningProgress(int, int, int, bool)));
 
     connectivityTimer = new QTimer(this);
     connectivityTimer->setSingleShot(true);
@@ -794,6 +806,18 @@ void MegaApplication::initialize()
     periodicTasksTimer->start(Preferences::STATE_REFRESH_INTERVAL_MS);
     connect(periodicTasksTimer, SIGNAL(timeout()), this, SLOT(periodicTasks()));
 
+    // notifications usually come in bursts, the interfaces are checked once after them
+    networkChangeTimer = new QTimer(this);
+    networkChangeTimer->setSingleShot(true);
+    networkChangeTimer->setInterval(Preferences::NETWORK_CHANGE_DELAY_MS);
+    connect(networkChangeTimer, SIGNAL(timeout()), this, SLOT(checkNetworkInterfaces()));
+
+#ifdef Q_OS_LINUX
+    networkMonitor = new NetworkMonitor();
+    connect(networkMonitor, SIGNAL(networkChanged()), this, SLOT(onNetworkChanged()), Qt::QueuedConnection);
+    networkMonitor->start();
+#endif
+
     infoDialogTimer = new QTimer(this);
     infoDialogTimer->setSingleShot(true);
     connect(infoDialogTimer, SIGNAL(timeout()), this, SLOT(showInfoDialog()));
@@ -1817,35 +1841,36 @@ void MegaApplication::checkNetworkInterfaces()
             for (int i = 0; i < addresses.size(); i++)
             {
                 QHostAddress ip = addresses.at(i).ip();
+                QString address = ip.toString();
                 switch (ip.protocol())
                 {
                 case QAbstractSocket::IPv4Protocol:
-                    if (!ip.toString().startsWith(QString::fromUtf8("127."), Qt::CaseInsensitive)
-                            && !ip.toString().startsWith(QString::fromUtf8("169.254."), Qt::CaseInsensitive))
+                    if (!address.startsWith(QString::fromUtf8("127."), Qt::CaseInsensitive)
+                            && !address.startsWith(QString::fromUtf8("169.254."), Qt::CaseInsensitive))
                     {
-                        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("IPv4: %1").arg(ip.toString()).toUtf8().constData());
+                        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("IPv4: %1").arg(address).toUtf8().constData());
                         numActiveIPs++;
                     }
                     else
                     {
-                        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Ignored IPv4: %1").arg(ip.toString()).toUtf8().constData());
+                        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Ignored IPv4: %1").arg(address).toUtf8().constData());
                     }
                     break;
                 case QAbstractSocket::IPv6Protocol:
-                    if (!ip.toString().startsWith(QString::fromUtf8("FE80:"), Qt::CaseInsensitive)
-                            && !ip.toString().startsWith(QString::fromUtf8("FD00:"), Qt::CaseInsensitive)
-                            && !(ip.toString() == QString::fromUtf8("::1")))
+                    if (!address.startsWith(QString::fromUtf8("FE80:"), Qt::CaseInsensitive)
+                            && !address.startsWith(QString::fromUtf8("FD00:"), Qt::CaseInsensitive)
+                            && !(address == QString::fromUtf8("::1")))
                     {
-                        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("IPv6: %1").arg(ip.toString()).toUtf8().constData());
+                        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("IPv6: %1").arg(address).toUtf8().constData());
                         numActiveIPs++;
                     }
                     else
                     {
-                        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Ignored IPv6: %1").arg(ip.toString()).toUtf8().constData());
+                        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Ignored IPv6: %1").arg(address).toUtf8().constData());
                     }
                     break;
                 default:
-                    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Ignored IP: %1").arg(ip.toString()).toUtf8().constData());
+                    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Ignored IP: %1").arg(address).toUtf8().constData());
                     break;
                 }
             }
@@ -1968,6 +1993,44 @@ void MegaApplication::checkNetworkInterfaces()
     }
 }
 
+void MegaApplication::onNetworkChanged()
+{
+    if (appfinished)
+    {
+        return;
+    }
+
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Network change notified");
+    networkChangeTimer->start();
+}
+
+#ifdef Q_OS_LINUX
+// Read a "Field:   <value> kB" line from a /proc file (in bytes, -1 if not available)
+static long long readProcMemoryField(const char *path, const char *field)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        return -1;
+    }
+
+    long long value = -1;
+    size_t fieldLength = strlen(field);
+    char line[256];
+    while (fgets(line, sizeof(line), fp))
+    {
+        long long kb;
+        if (!strncmp(line, field, fieldLength) && sscanf(line + fieldLength, "%lld", &kb) == 1)
+        {
+            value = kb * 1024;
+            break;
+        }
+    }
+    fclose(fp);
+    return value;
+}
+#endif
+
 void MegaApplication::checkMemoryUsage()
 {
     long long numNodes = megaApi->getNumNodes();
@@ -2003,6 +2066,33 @@ void MegaApplication::checkMemoryUsage()
         {
             return;
         }
+    #elif defined(Q_OS_LINUX)
+        long long pageSize = sysconf(_SC_PAGESIZE);
+        long long residentPages = 0;
+        long long sharedPages = 0;
+        FILE *fp = fopen("/proc/self/statm", "r");
+        if (!fp)
+        {
+            return;
+        }
+        int fields = fscanf(fp, "%*s %lld %lld", &residentPages, &sharedPages);
+        fclose(fp);
+        if (fields != 2)
+        {
+            return;
+        }
+
+        // Proportional set size (available since Linux 4.14) doesn't count the
+        // whole size of shared libraries, fall back to the resident set size
+        long long rss = residentPages * pageSize;
+        long long pss = readProcMemoryField("/proc/self/smaps_rollup", "Pss:");
+        long long anonymous = (residentPages - sharedPages) * pageSize;
+        long long swap = readProcMemoryField("/proc/self/status", "VmSwap:");
+        procesUsage = (pss > 0) ? pss : rss;
+
+        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG,
+                     QString::fromUtf8("Process memory: RSS %1 KB / PSS %2 KB / Anonymous %3 KB / Swap %4 KB")
+                     .arg(rss / 1024).arg(pss / 1024).arg(anonymous / 1024).arg(swap / 1024).toUtf8().constData());
     #endif
 #endif
 
@@ -2013,6 +2103,19 @@ void MegaApplication::checkMemoryUsage()
                  .arg((float)procesUsage / totalNodes)
                  .arg(totalTransfers).toUtf8().constData());
 
+    // Items held by each subsystem, to relate the memory usage to its origin
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG,
+                 QString::fromUtf8("Memory breakdown: %1 Nodes / %2 LocalNodes / %3 uploads / %4 downloads / "
+                                   "%5 finished transfers / %6 queued uploads / %7 queued downloads / %8 pending links / %9 webclient requests")
+                 .arg(numNodes).arg(numLocalNodes)
+                 .arg(megaApi->getNumPendingUploads())
+                 .arg(megaApi->getNumPendingDownloads())
+                 .arg(finishedTransfers.size())
+                 .arg(uploadQueue.size())
+                 .arg(downloadQueue.size())
+                 .arg(pendingLinks.size())
+                 .arg(HTTPServer::getNumRequests()).toUtf8().constData());
+
     if (procesUsage > maxMemoryUsage)
     {
         maxMemoryUsage = procesUsage;
@@ -2056,7 +2159,16 @@ void MegaApplication::periodicTasks()
         updateUserStats(true);
     }
 
-    checkNetworkInterfaces();
+    // with a network monitor, polling is only a fallback
+    static int networkCounter = 0;
+    bool monitored = false;
+#ifdef Q_OS_LINUX
+    monitored = networkMonitor && networkMonitor->isActive();
+#endif
+    if (!monitored || !(++networkCounter % 6))
+    {
+        checkNetworkInterfaces();
+    }
     initLocalServer();
 
     static int counter = 0;
@@ -2118,6 +2230,16 @@ void MegaApplication::cleanAll()
     periodicTasksTimer->stop();
     stopUpdateTask();
     Platform::stopShellDispatcher();
+#ifdef Q_OS_LINUX
+    Platform::stopProcessScanner();
+    if (networkMonitor)
+    {
+        networkMonitor->stop();
+        networkMonitor->wait();
+        delete networkMonitor;
+        networkMonitor = NULL;
+    }
+#endif
     for (int i = 0; i < preferences->getNumSyncedFolders(); i++)
     {
         notifyItemChange(preferences->getLocalFolder(i), MegaApi::STATE_NONE);
@@ -2491,13 +2613,13 @@ void MegaApplication::startHttpsServer()
 
 void MegaApplication::initLocalServer()
 {
-    // Run both servers for now, until we receive the confirmation of the criteria to start them dynamically
-    if (!httpServer) // && Platform::shouldRunHttpServer())
+    // Servers are started once a web browser that needs them is running
+    if (!httpServer && Platform::shouldRunHttpServer())
     {
         startHttpServer();
     }
 
-    if (!updatingSSLcert) // && (httpsServer || Platform::shouldRunHttpsServer()))
+    if (!updatingSSLcert && (httpsServer || Platform::shouldRunHttpsServer()))
     {
         long long currentTime = QDateTime::currentMSecsSinceEpoch() / 1000;
         if ((currentTime - lastSSLcertUpdate) > Preferences::LOCAL_HTTPS_CERT_RENEW_INTERVAL_SECS)
@@ -3157,6 +3279,22 @@ void MegaApplication::onCompletedTransfersTabActive(bool active)
     completedTabActive = active;
 }
 
+void MegaApplication::onDownloadPlanningProgress(int folders, int files, bool finished)
+{
+    if (transferManager)
+    {
+        transferManager->updateDownloadPlanning(folders, files, finished);
+    }
+}
+
+void MegaApplication::onUploadPlanningProgress(int folders, int files, int uploads, bool finished)
+{
+    if (transferManager)
+    {
+        transferManager->updateUploadPlanning(folders, files, uploads, finished);
+    }
+}
+
 void MegaApplication::checkFirstTransfer()
 {
     if (appfinished || !megaApi)
@@ -3398,32 +3536,35 @@ void MegaApplication::toggleLogging()
 
 void MegaApplication::removeFinishedTransfer(int transferTag)
 {
-    QMap<int, MegaTransfer*>::iterator it = finishedTransfers.find(transferTag);
-    if (it != finishedTransfers.end())
-    {     
-        for (QList<MegaTransfer*>::iterator it2 = finishedTransferOrder.begin(); it2 != finishedTransferOrder.end(); it2++)
-        {
-            if ((*it2)->getTag() == transferTag)
-            {
-                finishedTransferOrder.erase(it2);
-                break;
-            }
-        }
-        delete it.value();
-        finishedTransfers.erase(it);
+    finishedTransfers.remove(transferTag);
+}
+
+//Drop the uploads that are still being scanned
+void MegaApplication::cancelPendingUploads()
+{
+    if (uploader)
+    {
+        uploader->cancel();
+    }
+}
+
+//Drop the downloads that are still being planned
+void MegaApplication::cancelPendingDownloads()
+{
+    if (downloader)
+    {
+        downloader->cancel();
     }
 }
 
 void MegaApplication::removeAllFinishedTransfers()
 {
-    qDeleteAll(finishedTransfers);
-    finishedTransferOrder.clear();
     finishedTransfers.clear();
 }
 
-QList<MegaTransfer*> MegaApplication::getFinishedTransfers()
+FinishedTransferStore *MegaApplication::getFinishedTransfers()
 {
-    return finishedTransferOrder;
+    return &finishedTransfers;
 }
 
 int MegaApplication::getNumUnviewedTransfers()
@@ -3431,15 +3572,6 @@ int MegaApplication::getNumUnviewedTransfers()
     return nUnviewedTransfers;
 }
 
-MegaTransfer* MegaApplication::getFinishedTransferByTag(int tag)
-{
-    if (!finishedTransfers.contains(tag))
-    {
-        return NULL;
-    }
-    return finishedTransfers.value(tag);
-}
-
 void MegaApplication::pauseTransfers()
 {
     pauseTransfers(!preferences->getGlobalPaused());
@@ -5414,6 +5546,7 @@ void MegaApplication::onRequestFinish(MegaApi*, MegaRequest *request, MegaError*
             settingsDialog = NULL;
         }
 
+        cancelPendingUploads();
         megaApi->cancelTransfers(MegaTransfer::TYPE_UPLOAD);
         onGlobalSyncStateChanged(megaApi);
     }
@@ -6225,16 +6358,15 @@ void MegaApplication::onTransferFinish(MegaApi* , MegaTransfer *transfer, MegaEr
 
     if (transfer->getState() == MegaTransfer::STATE_COMPLETED || transfer->getState() == MegaTransfer::STATE_FAILED)
     {
-        MegaTransfer *t = transfer->copy();
-        if (finishedTransfers.count(transfer->getTag()))
+        if (finishedTransfers.get(transfer->getTag()))
         {
             assert(false);
             megaApi->sendEvent(99512, QString::fromUtf8("Duplicated finished transfer: %1").arg(QString::number(transfer->getTag())).toUtf8().constData());
             removeFinishedTransfer(transfer->getTag());
         }
 
-        finishedTransfers.insert(transfer->getTag(), t);
-        finishedTransferOrder.push_back(t);
+        // a full store drops the oldest transfer
+        finishedTransfers.add(FinishedTransfer(transfer, e->getErrorCode()));
 
         if (!transferManager)
         {
@@ -6257,11 +6389,6 @@ void MegaApplication::onTransferFinish(MegaApi* , MegaTransfer *transfer, MegaEr
         transferManager->onTransferFinish(megaApi, transfer, e);
     }
 
-    if (finishedTransferOrder.size() > Preferences::MAX_COMPLETED_ITEMS)
-    {
-        removeFinishedTransfer(finishedTransferOrder.first()->getTag());
-    }
-
     //Show the transfer in the "recently updated" list
     if (e->getErrorCode() == MegaError::API_OK && transfer->getNodeHandle() != INVALID_HANDLE)
     {
@@ -6321,6 +6448,7 @@ void MegaApplication::onTransferFinish(MegaApi* , MegaTransfer *transfer, MegaEr
             settingsDialog = NULL;
         }
 
+        cancelPendingUploads();
         megaApi->cancelTransfers(MegaTransfer::TYPE_UPLOAD);
         onGlobalSyncStateChanged(megaApi);
     }
@@ -6618,45 +6746,37 @@ void MegaApplication::onNodesUpdate(MegaApi* , MegaNodeList *nodes)
         localPath.clear();
         MegaNode *node = nodes->get(i);
 
-        for (int i = 0; i < preferences->getNumSyncedFolders(); i++)
+        int syncIndex = (node->getType() == MegaNode::TYPE_FOLDER) ? preferences->getSyncIndexByHandle(node->getHandle()) : -1;
+        if (syncIndex >= 0)
         {
-            if (!preferences->isFolderActive(i))
-            {
-                continue;
-            }
+            MegaNode *nodeByHandle = megaApi->getNodeByHandle(preferences->getMegaFolderHandle(syncIndex));
+            const char *nodePath = megaApi->getNodePath(nodeByHandle);
 
-            if (node->getType() == MegaNode::TYPE_FOLDER
-                    && (node->getHandle() == preferences->getMegaFolderHandle(i)))
+            if (!nodePath || preferences->getMegaFolder(syncIndex).compare(QString::fromUtf8(nodePath)))
             {
-                MegaNode *nodeByHandle = megaApi->getNodeByHandle(preferences->getMegaFolderHandle(i));
-                const char *nodePath = megaApi->getNodePath(nodeByHandle);
-
-                if (!nodePath || preferences->getMegaFolder(i).compare(QString::fromUtf8(nodePath)))
+                if (nodePath && QString::fromUtf8(nodePath).startsWith(QString::fromUtf8("//bin")))
                 {
-                    if (nodePath && QString::fromUtf8(nodePath).startsWith(QString::fromUtf8("//bin")))
-                    {
-                        showErrorMessage(tr("Your sync \"%1\" has been disabled because the remote folder is in the rubbish bin")
-                                         .arg(preferences->getSyncName(i)));
-                    }
-                    else
-                    {
-                        showErrorMessage(tr("Your sync \"%1\" has been disabled because the remote folder doesn't exist")
-                                         .arg(preferences->getSyncName(i)));
-                    }
-                    Platform::syncFolderRemoved(preferences->getLocalFolder(i),
-                                                preferences->getSyncName(i),
-                                                preferences->getSyncID(i));
-                    notifyItemChange(preferences->getLocalFolder(i), MegaApi::STATE_NONE);
-                    MegaNode *node = megaApi->getNodeByHandle(preferences->getMegaFolderHandle(i));
-                    megaApi->removeSync(node);
-                    delete node;
-                    preferences->setSyncState(i, false);
-                    openSettings(SettingsDialog::SYNCS_TAB);
+                    showErrorMessage(tr("Your sync \"%1\" has been disabled because the remote folder is in the rubbish bin")
+                                     .arg(preferences->getSyncName(syncIndex)));
                 }
-
-                delete nodeByHandle;
-                delete [] nodePath;
+                else
+                {
+                    showErrorMessage(tr("Your sync \"%1\" has been disabled because the remote folder doesn't exist")
+                                     .arg(preferences->getSyncName(syncIndex)));
+                }
+                Platform::syncFolderRemoved(preferences->getLocalFolder(syncIndex),
+                                            preferences->getSyncName(syncIndex),
+                                            preferences->getSyncID(syncIndex));
+                notifyItemChange(preferences->getLocalFolder(syncIndex), MegaApi::STATE_NONE);
+                MegaNode *node = megaApi->getNodeByHandle(preferences->getMegaFolderHandle(syncIndex));
+                megaApi->removeSync(node);
+                delete node;
+                preferences->setSyncState(syncIndex, false);
+                openSettings(SettingsDialog::SYNCS_TAB);
             }
+
+            delete nodeByHandle;
+            delete [] nodePath;
         }
 
         if (!node->getTag() && !node->isRemoved()
@@ -32,6 +32,7 @@
 #include "control/HTTPServer.h"
 #include "control/MegaUploader.h"
 #include "control/MegaDownloader.h"
+#include "control/FinishedTransfers.h"
 #include "control/UpdateTask.h"
 #include "control/MegaSyncLogger.h"
 #include "megaapi.h"
@@ -48,6 +49,9 @@ Q_DECLARE_METATYPE(QQueue<QString>)
 
 class Notificator;
 class MEGASyncDelegateListener;
+#ifdef Q_OS_LINUX
+class NetworkMonitor;
+#endif
 
 class MegaApplication : public QApplication, public mega::MegaListener
 {
@@ -108,11 +112,12 @@ public:
     void checkForUpdates();
     void showTrayMenu(QPoint *point = NULL);
     void toggleLogging();
-    QList<mega::MegaTransfer* > getFinishedTransfers();
+    FinishedTransferStore *getFinishedTransfers();
     int getNumUnviewedTransfers();
     void removeFinishedTransfer(int transferTag);
     void removeAllFinishedTransfers();
-    mega::MegaTransfer* getFinishedTransferByTag(int tag);
+    void cancelPendingUploads();
+    void cancelPendingDownloads();
 
 signals:
     void startUpdaterThread();
@@ -164,6 +169,7 @@ public slots:
     void exitApplication();
     void pauseTransfers(bool pause);
     void checkNetworkInterfaces();
+    void onNetworkChanged();
     void checkMemoryUsage();
     void periodicTasks();
     void cleanAll();
@@ -186,6 +192,8 @@ public slots:
     void clearUserAttributes();
     void clearViewedTransfers();
     void onCompletedTransfersTabActive(bool active);
+    void onDownloadPlanningProgress(int folders, int files, bool finished);
+    void onUploadPlanningProgress(int folders, int files, int uploads, bool finished);
     void checkFirstTransfer();
     void checkOperatingSystem();
     void notifyItemChange(QString path, int newState);
@@ -330,11 +338,14 @@ protected:
     long long lastActiveTime;
     QNetworkConfigurationManager networkConfigurationManager;
     QList<QNetworkInterface> activeNetworkInterfaces;
+    QTimer *networkChangeTimer;
+#ifdef Q_OS_LINUX
+    NetworkMonitor *networkMonitor;
+#endif
     QMap<QString, QString> pendingLinks;
     MegaSyncLogger *logger;
     QPointer<TransferManager> transferManager;
-    QMap<int, mega::MegaTransfer*> finishedTransfers;
-    QList<mega::MegaTransfer*> finishedTransferOrder;
+    FinishedTransferStore finishedTransfers;
 
     bool reboot;
     bool syncActive;
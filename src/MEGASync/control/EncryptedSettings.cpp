@@ -1,79 +1,379 @@
 #include "EncryptedSettings.h"
 #include "platform/Platform.h"
 
+#include <QSettings>
+#include <QFile>
+#include <QDir>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const qint64 EncryptedSettings::MAX_JOURNAL_SIZE = 262144;
+
+// Replaces destination with source in a single step, so a crash leaves one of them complete
+static bool replaceFile(const QString &source, const QString &destination)
+{
+#ifdef WIN32
+    return MoveFileExW((LPCWSTR)QDir::toNativeSeparators(source).utf16(),
+                       (LPCWSTR)QDir::toNativeSeparators(destination).utf16(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    return !rename(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData());
+#endif
+}
+
+// Makes sure the content of the file is on disk before it replaces another one
+static bool flushFile(const QString &path)
+{
+#ifdef WIN32
+    HANDLE handle = CreateFileW((LPCWSTR)QDir::toNativeSeparators(path).utf16(), GENERIC_WRITE, 0, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    bool flushed = FlushFileBuffers(handle);
+    CloseHandle(handle);
+    return flushed;
+#else
+    int fd = open(QFile::encodeName(path).constData(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool flushed = !fsync(fd);
+    close(fd);
+    return flushed;
+#endif
+}
+
 EncryptedSettings::EncryptedSettings(QString file) :
-    QSettings(file, QSettings::IniFormat)
+    QObject()
 {
     QByteArray fixedSeed("$JY/X?o=h·&%v/M(");
     QByteArray localKey = Platform::getLocalStorageKey();
     QByteArray xLocalKey = XOR(fixedSeed, localKey);
     QByteArray hLocalKey = QCryptographicHash::hash(xLocalKey, QCryptographicHash::Sha1);
     encryptionKey = hLocalKey;
+
+    this->file = file;
+    journalFile = file + QString::fromAscii(".journal");
+    load();
+}
+
+void EncryptedSettings::removeJournal(const QString &file)
+{
+    QFile::remove(file + QString::fromAscii(".journal"));
+}
+
+EncryptedSettings::~EncryptedSettings()
+{
+    sync();
 }
 
 void EncryptedSettings::setValue(const QString &key, const QVariant &value)
 {
-    QSettings::setValue(hash(key), encrypt(key, value.toString()));
+    CachedValue cached;
+    cached.exists = true;
+    cached.value = value.toString();
+    values.insert(cacheKey(key), cached);
+
+    QString entryPath = path(hash(key));
+    QString encrypted = encrypt(key, cached.value);
+    entries.insert(entryPath, encrypted);
+    appendToJournal('S', entryPath, encrypted);
 }
 
 QVariant EncryptedSettings::value(const QString &key, const QVariant &defaultValue)
 {
-    return QVariant(decrypt(key, QSettings::value(hash(key), encrypt(key, defaultValue.toString())).toString()));
+    QString id = cacheKey(key);
+    QHash<QString, CachedValue>::const_iterator it = values.constFind(id);
+    if (it == values.constEnd())
+    {
+        CachedValue cached;
+        QMap<QString, QString>::const_iterator entry = entries.constFind(path(hash(key)));
+        cached.exists = (entry != entries.constEnd());
+        if (cached.exists)
+        {
+            cached.value = decrypt(key, entry.value());
+        }
+        it = values.insert(id, cached);
+    }
+
+    if (!it.value().exists)
+    {
+        return QVariant(defaultValue.toString());
+    }
+    return QVariant(it.value().value);
 }
 
 void EncryptedSettings::beginGroup(const QString &prefix)
 {
-    QSettings::beginGroup(hash(prefix));
+    groups.append(hash(prefix));
 }
 
 void EncryptedSettings::beginGroup(int numGroup)
 {
-     QSettings::beginGroup(QSettings::childGroups().at(numGroup));
+     groups.append(childGroups().at(numGroup));
 }
 
 void EncryptedSettings::endGroup()
 {
-    QSettings::endGroup();
+    if (!groups.isEmpty())
+    {
+        groups.removeLast();
+    }
 }
 
 int EncryptedSettings::numChildGroups()
 {
-    return QSettings::childGroups().size();
+    return childGroups().size();
 }
 
 bool EncryptedSettings::containsGroup(QString groupName)
 {
-    return QSettings::childGroups().contains(hash(groupName));
+    return childGroups().contains(hash(groupName));
 }
 
 bool EncryptedSettings::isGroupEmpty()
 {
-    return QSettings::group().isEmpty();
+    return groups.isEmpty();
 }
 
 void EncryptedSettings::remove(const QString &key)
 {
     if (!key.length())
     {
-        QSettings::remove(QString::fromAscii(""));
+        removeCachedGroup(group());
+        removeEntries(group());
+        appendToJournal('R', group());
     }
     else
     {
-        QSettings::remove(hash(key));
+        // the key can also be a child group
+        QString entryPath = path(hash(key));
+        values.remove(cacheKey(key));
+        removeCachedGroup(entryPath);
+        removeEntries(entryPath);
+        appendToJournal('R', entryPath);
     }
 }
 
 void EncryptedSettings::clear()
 {
-    QSettings::clear();
+    values.clear();
+    entries.clear();
+    pendingJournal.clear();
+    appendToJournal('C', QString());
 }
 
 void EncryptedSettings::sync()
 {
-    QSettings::sync();
+    if (pendingJournal.isEmpty())
+    {
+        return;
+    }
+
+    QFile journal(journalFile);
+    bool written = journal.open(QIODevice::WriteOnly | QIODevice::Append)
+            && journal.write(pendingJournal) == pendingJournal.size()
+            && journal.flush();
+    qint64 journalSize = journal.size();
+    journal.close();
+    pendingJournal.clear();
+
+    // a failed append can leave a partial line, the new snapshot makes the journal unnecessary
+    if (!written || journalSize > MAX_JOURNAL_SIZE)
+    {
+        compact();
+    }
+}
+
+bool EncryptedSettings::compact()
+{
+    QString tmpFile = file + QString::fromAscii(".tmp");
+    QFile::remove(tmpFile);
+    {
+        QSettings snapshot(tmpFile, QSettings::IniFormat);
+        for (QMap<QString, QString>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it)
+        {
+            snapshot.setValue(it.key(), it.value());
+        }
+        snapshot.sync();
+        if (snapshot.status() != QSettings::NoError)
+        {
+            QFile::remove(tmpFile);
+            return false;
+        }
+    }
+
+    if (!flushFile(tmpFile) || !replaceFile(tmpFile, file))
+    {
+        QFile::remove(tmpFile);
+        return false;
+    }
+
+    // The journal is already in the snapshot (replaying it again is harmless).
+    // The backup is only refreshed here, not on every change
+    pendingJournal.clear();
+    QFile::remove(journalFile);
+
+    QString bakFile = file + QString::fromAscii(".bak");
+    QString bakTmpFile = bakFile + QString::fromAscii(".tmp");
+    QFile::remove(bakTmpFile);
+    if (QFile::copy(file, bakTmpFile) && (!flushFile(bakTmpFile) || !replaceFile(bakTmpFile, bakFile)))
+    {
+        QFile::remove(bakTmpFile);
+    }
+    return true;
+}
+
+void EncryptedSettings::load()
+{
+    QSettings snapshot(file, QSettings::IniFormat);
+    QStringList keys = snapshot.allKeys();
+    for (int i = 0; i < keys.size(); i++)
+    {
+        entries.insert(keys.at(i), snapshot.value(keys.at(i)).toString());
+    }
+
+    if (replayJournal())
+    {
+        compact();
+    }
+}
+
+int EncryptedSettings::replayJournal()
+{
+    QFile journal(journalFile);
+    if (!journal.open(QIODevice::ReadOnly))
+    {
+        return 0;
+    }
+    QByteArray data = journal.readAll();
+    journal.close();
+
+    int numChanges = 0;
+    int start = 0;
+    while (true)
+    {
+        // an unfinished line is a write interrupted by a crash
+        int end = data.indexOf('\n', start);
+        if (end < 0)
+        {
+            break;
+        }
+
+        QByteArray line = data.mid(start, end - start);
+        start = end + 1;
+        if (line.isEmpty())
+        {
+            continue;
+        }
+
+        QString content = QString::fromAscii(line.constData() + 1, line.size() - 1);
+        int separator = content.indexOf(QChar::fromAscii('\t'));
+        switch (line.at(0))
+        {
+            case 'S':
+                if (separator < 0 || content.indexOf(QChar::fromAscii('\t'), separator + 1) >= 0)
+                {
+                    continue;
+                }
+                entries.insert(content.left(separator), content.mid(separator + 1));
+                break;
+            case 'R':
+                if (separator >= 0)
+                {
+                    continue;
+                }
+                removeEntries(content);
+                break;
+            case 'C':
+                if (!content.isEmpty())
+                {
+                    continue;
+                }
+                entries.clear();
+                break;
+            default:
+                continue;
+        }
+        numChanges++;
+    }
+    return numChanges;
+}
+
+void EncryptedSettings::appendToJournal(char operation, const QString &path, const QString &value)
+{
+    // hashed paths and base64 values never contain tabs or line breaks
+    pendingJournal.append(operation);
+    pendingJournal.append(path.toAscii());
+    if (operation == 'S')
+    {
+        pendingJournal.append('\t');
+        pendingJournal.append(value.toAscii());
+    }
+    pendingJournal.append('\n');
+}
+
+QString EncryptedSettings::group() const
+{
+    return groups.join(QString::fromAscii("/"));
+}
 
-    QFile::remove(this->fileName().append(QString::fromUtf8(".bak")));
-    QFile::copy(this->fileName(),this->fileName().append(QString::fromUtf8(".bak")));
+QString EncryptedSettings::path(const QString &hashedKey) const
+{
+    if (groups.isEmpty())
+    {
+        return hashedKey;
+    }
+    return group() + QString::fromAscii("/") + hashedKey;
+}
+
+QStringList EncryptedSettings::childGroups() const
+{
+    // entries are sorted, so the keys of each child group are consecutive
+    QString prefix = groups.isEmpty() ? QString() : group() + QString::fromAscii("/");
+    QStringList result;
+    QMap<QString, QString>::const_iterator it = prefix.isEmpty() ? entries.constBegin() : entries.lowerBound(prefix);
+    for (; it != entries.constEnd() && it.key().startsWith(prefix); ++it)
+    {
+        int separator = it.key().indexOf(QChar::fromAscii('/'), prefix.size());
+        if (separator < 0)
+        {
+            continue;
+        }
+
+        QString child = it.key().mid(prefix.size(), separator - prefix.size());
+        if (result.isEmpty() || result.last() != child)
+        {
+            result.append(child);
+        }
+    }
+    return result;
+}
+
+void EncryptedSettings::removeEntries(const QString &prefix)
+{
+    if (prefix.isEmpty())
+    {
+        entries.clear();
+        return;
+    }
+
+    entries.remove(prefix);
+    QString groupPrefix = prefix + QString::fromAscii("/");
+    QMap<QString, QString>::iterator it = entries.lowerBound(groupPrefix);
+    while (it != entries.end() && it.key().startsWith(groupPrefix))
+    {
+        it = entries.erase(it);
+    }
 }
 
 //Simplified XOR fun
@@ -129,8 +429,46 @@ QString EncryptedSettings::decrypt(const QString key, const QString value) const
 
 QString EncryptedSettings::hash(const QString key) const
 {
+    QString id = cacheKey(key);
+    QHash<QString, QString>::const_iterator it = hashes.constFind(id);
+    if (it != hashes.constEnd())
+    {
+        return it.value();
+    }
+
     QByteArray xPath = XOR(encryptionKey, (key+group()).toUtf8());
     QByteArray keyHash = QCryptographicHash::hash(xPath, QCryptographicHash::Sha1);
     QByteArray xKeyHash = XOR(key.toUtf8(), keyHash);
-    return QString::fromAscii(xKeyHash.toHex());
+    QString result = QString::fromAscii(xKeyHash.toHex());
+    hashes.insert(id, result);
+    return result;
+}
+
+QString EncryptedSettings::cacheKey(const QString &key) const
+{
+    // group() contains hashed names only, so '/' can't be ambiguous
+    return group() + QString::fromAscii("/") + key;
+}
+
+void EncryptedSettings::removeCachedGroup(const QString &prefix)
+{
+    if (prefix.isEmpty())
+    {
+        values.clear();
+        return;
+    }
+
+    QString groupPrefix = prefix + QString::fromAscii("/");
+    QHash<QString, CachedValue>::iterator it = values.begin();
+    while (it != values.end())
+    {
+        if (it.key().startsWith(groupPrefix))
+        {
+            it = values.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
 }
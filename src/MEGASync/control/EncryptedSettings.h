@@ -1,17 +1,25 @@
 #ifndef ENCRYPTEDSETTINGS_H
 #define ENCRYPTEDSETTINGS_H
 
-#include <QSettings>
+#include <QObject>
 #include <QVariant>
 #include <QStringList>
 #include <QCryptographicHash>
+#include <QHash>
+#include <QMap>
 
-class EncryptedSettings : protected QSettings
+// Encrypted settings stored as a snapshot (INI file) plus a journal of the changes made after it.
+// Changes are appended to the journal on sync() and the journal is folded into a new snapshot
+// (written to a temporary file and renamed) when it grows too much.
+class EncryptedSettings : public QObject
 {
     Q_OBJECT
 
 public:
+    static const qint64 MAX_JOURNAL_SIZE;
+
     explicit EncryptedSettings(QString file);
+    ~EncryptedSettings();
 
     void setValue(const QString & key, const QVariant & value);
     QVariant value(const QString & key, const QVariant & defaultValue = QVariant());
@@ -23,14 +31,51 @@ public:
     bool isGroupEmpty();
     void remove(const QString & key);
     void clear();
+
+    // Appends the pending changes to the journal
     void sync();
 
+    // Writes a new snapshot and empties the journal
+    bool compact();
+
+    // Discards the changes made after the last snapshot of file, if it isn't in use
+    static void removeJournal(const QString &file);
+
 protected:
+    class CachedValue
+    {
+    public:
+        CachedValue() : exists(false) {}
+        bool exists;
+        QString value;
+    };
+
+    QString group() const;
+    QString path(const QString &hashedKey) const;
+    QStringList childGroups() const;
+    QString cacheKey(const QString &key) const;
+    void removeCachedGroup(const QString &prefix);
+    void removeEntries(const QString &prefix);
+
+    void load();
+    int replayJournal();
+    void appendToJournal(char operation, const QString &path, const QString &value = QString());
+
     QByteArray XOR(const QByteArray &key, const QByteArray& data) const;
     QString encrypt(const QString key, const QString value) const;
     QString decrypt(const QString key, const QString value) const;
     QString hash(const QString key) const;
     QByteArray encryptionKey;
+
+    QString file;
+    QString journalFile;
+    QStringList groups;                 ///< Hashed names of the current group
+    QMap<QString, QString> entries;     ///< Encrypted values by hashed path
+    QByteArray pendingJournal;
+
+    // Decrypted values and hashed names, by group and plain key
+    QHash<QString, CachedValue> values;
+    mutable QHash<QString, QString> hashes;
 };
 
 #endif // ENCRYPTEDSETTINGS_H
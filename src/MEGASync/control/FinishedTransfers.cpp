@@ -0,0 +1,277 @@
+#include "FinishedTransfers.h"
+
+using namespace mega;
+
+FinishedTransfer::FinishedTransfer()
+{
+    tag = -1;
+    type = 0;
+    state = 0;
+    errorCode = MegaError::API_OK;
+    syncTransfer = false;
+    nodeHandle = INVALID_HANDLE;
+    totalBytes = 0;
+    transferredBytes = 0;
+    speed = 0;
+    meanSpeed = 0;
+    updateTime = 0;
+    priority = 0;
+}
+
+FinishedTransfer::FinishedTransfer(MegaTransfer *transfer, int errorCode)
+{
+    tag = transfer->getTag();
+    type = transfer->getType();
+    state = transfer->getState();
+    this->errorCode = errorCode;
+    syncTransfer = transfer->isSyncTransfer();
+    fileName = QString::fromUtf8(transfer->getFileName());
+    if (transfer->getPath())
+    {
+        path = QString::fromUtf8(transfer->getPath());
+    }
+    nodeHandle = transfer->getNodeHandle();
+    totalBytes = transfer->getTotalBytes();
+    transferredBytes = transfer->getTransferredBytes();
+    speed = transfer->getSpeed();
+    meanSpeed = transfer->getMeanSpeed();
+    updateTime = transfer->getUpdateTime();
+    priority = transfer->getPriority();
+
+    MegaNode *node = transfer->getPublicMegaNode();
+    if (node && node->isPublic())
+    {
+        char *handle = node->getBase64Handle();
+        char *key = node->getBase64Key();
+        if (handle && key)
+        {
+            publicLink = QString::fromUtf8("https://mega.nz/#!%1!%2")
+                    .arg(QString::fromUtf8(handle)).arg(QString::fromUtf8(key));
+        }
+        delete [] handle;
+        delete [] key;
+    }
+    delete node;
+}
+
+FinishedTransferStore::FinishedTransferStore(int capacity)
+{
+    maxItems = 0;
+    numItems = 0;
+    numAdded = 0;
+    listener = NULL;
+    setCapacity(capacity);
+}
+
+void FinishedTransferStore::setCapacity(int capacity)
+{
+    clear();
+    maxItems = qMax(capacity, 1);
+    records.clear();
+    used.fill(false, maxItems);
+    usedTree.fill(0, maxItems + 1);
+}
+
+int FinishedTransferStore::capacity() const
+{
+    return maxItems;
+}
+
+void FinishedTransferStore::setListener(FinishedTransferListener *listener)
+{
+    this->listener = listener;
+}
+
+void FinishedTransferStore::removeListener(FinishedTransferListener *listener)
+{
+    if (this->listener == listener)
+    {
+        this->listener = NULL;
+    }
+}
+
+void FinishedTransferStore::add(const FinishedTransfer &transfer)
+{
+    remove(transfer.tag);
+
+    // the slot of the oldest transfer once the ring is full
+    int slot = numAdded % maxItems;
+    if (used.at(slot))
+    {
+        if (listener)
+        {
+            listener->onFinishedTransfersAboutToBeRemoved(numItems - 1, numItems - 1);
+        }
+        int tag = records.at(slot).tag;
+        removeSlot(slot);
+        if (listener)
+        {
+            listener->onFinishedTransfersRemoved(tag);
+        }
+    }
+
+    if (listener)
+    {
+        listener->onFinishedTransferAboutToBeAdded();
+    }
+    if (slot == records.size())
+    {
+        records.append(transfer);
+    }
+    else
+    {
+        records[slot] = transfer;
+    }
+    used[slot] = true;
+    updateUsedSlots(slot, 1);
+    slotByTag.insert(transfer.tag, slot);
+    numItems++;
+    numAdded++;
+    if (listener)
+    {
+        listener->onFinishedTransferAdded();
+    }
+}
+
+void FinishedTransferStore::remove(int tag)
+{
+    int row = rowOf(tag);
+    if (row < 0)
+    {
+        return;
+    }
+
+    if (listener)
+    {
+        listener->onFinishedTransfersAboutToBeRemoved(row, row);
+    }
+    removeSlot(slotByTag.value(tag));
+    if (listener)
+    {
+        listener->onFinishedTransfersRemoved(tag);
+    }
+}
+
+void FinishedTransferStore::clear()
+{
+    if (numItems && listener)
+    {
+        listener->onFinishedTransfersAboutToBeRemoved(0, numItems - 1);
+    }
+
+    bool removed = (numItems != 0);
+    records.clear();
+    used.fill(false);
+    usedTree.fill(0);
+    slotByTag.clear();
+    numItems = 0;
+    numAdded = 0;
+
+    if (removed && listener)
+    {
+        listener->onFinishedTransfersRemoved(-1);
+    }
+}
+
+int FinishedTransferStore::size() const
+{
+    return numItems;
+}
+
+const FinishedTransfer *FinishedTransferStore::get(int tag) const
+{
+    QHash<int, int>::const_iterator it = slotByTag.constFind(tag);
+    if (it == slotByTag.constEnd())
+    {
+        return NULL;
+    }
+    return &records.at(it.value());
+}
+
+int FinishedTransferStore::rowOf(int tag) const
+{
+    QHash<int, int>::const_iterator it = slotByTag.constFind(tag);
+    if (it == slotByTag.constEnd())
+    {
+        return -1;
+    }
+
+    // transfers older than this one, the ring starts at the oldest slot
+    int slot = it.value();
+    int start = oldestSlot();
+    int older = usedSlotsBefore(slot) - usedSlotsBefore(start);
+    if (slot < start)
+    {
+        older += numItems;
+    }
+    return numItems - 1 - older;
+}
+
+int FinishedTransferStore::tagAt(int row) const
+{
+    if (row < 0 || row >= numItems)
+    {
+        return -1;
+    }
+
+    int index = numItems - 1 - row;
+    int start = oldestSlot();
+    int beforeStart = usedSlotsBefore(start);
+    int fromStart = numItems - beforeStart;
+    int slot = (index < fromStart) ? findUsedSlot(beforeStart + index) : findUsedSlot(index - fromStart);
+    return records.at(slot).tag;
+}
+
+int FinishedTransferStore::oldestSlot() const
+{
+    return (numAdded < maxItems) ? 0 : (numAdded % maxItems);
+}
+
+void FinishedTransferStore::removeSlot(int slot)
+{
+    slotByTag.remove(records.at(slot).tag);
+    records[slot] = FinishedTransfer();
+    used[slot] = false;
+    updateUsedSlots(slot, -1);
+    numItems--;
+}
+
+void FinishedTransferStore::updateUsedSlots(int slot, int delta)
+{
+    for (int i = slot + 1; i <= maxItems; i += (i & -i))
+    {
+        usedTree[i] += delta;
+    }
+}
+
+int FinishedTransferStore::usedSlotsBefore(int slot) const
+{
+    int count = 0;
+    for (int i = slot; i > 0; i -= (i & -i))
+    {
+        count += usedTree.at(i);
+    }
+    return count;
+}
+
+// Slot of the used slot number index (from 0)
+int FinishedTransferStore::findUsedSlot(int index) const
+{
+    int step = 1;
+    while ((step << 1) <= maxItems)
+    {
+        step <<= 1;
+    }
+
+    int position = 0;
+    int remaining = index + 1;
+    for (; step; step >>= 1)
+    {
+        if (position + step <= maxItems && usedTree.at(position + step) < remaining)
+        {
+            position += step;
+            remaining -= usedTree.at(position);
+        }
+    }
+    return position;
+}
@@ -0,0 +1,85 @@
+#ifndef FINISHEDTRANSFERS_H
+#define FINISHEDTRANSFERS_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include "megaapi.h"
+
+// What is kept of a finished transfer to show it in the list
+class FinishedTransfer
+{
+public:
+    FinishedTransfer();
+    FinishedTransfer(mega::MegaTransfer *transfer, int errorCode);
+
+    int tag;
+    int type;
+    int state;
+    int errorCode;
+    bool syncTransfer;
+    QString fileName;
+    QString path;
+    QString publicLink;     ///< Link of the downloaded node if it was public
+    mega::MegaHandle nodeHandle;
+    long long totalBytes;
+    long long transferredBytes;
+    long long speed;
+    long long meanSpeed;
+    long long updateTime;
+    unsigned long long priority;
+};
+
+// Receives the changes of a FinishedTransferStore, in the order of QAbstractItemModel
+class FinishedTransferListener
+{
+public:
+    virtual ~FinishedTransferListener() {}
+    virtual void onFinishedTransferAboutToBeAdded() = 0;
+    virtual void onFinishedTransferAdded() = 0;
+    virtual void onFinishedTransfersAboutToBeRemoved(int firstRow, int lastRow) = 0;
+    virtual void onFinishedTransfersRemoved(int tag) = 0;   ///< tag is -1 if all of them were removed
+};
+
+// Last finished transfers, newest first, in a ring of fixed capacity.
+// Adding a transfer to a full ring drops the oldest one
+class FinishedTransferStore
+{
+public:
+    explicit FinishedTransferStore(int capacity);
+
+    // Removes every transfer
+    void setCapacity(int capacity);
+    int capacity() const;
+    void setListener(FinishedTransferListener *listener);
+    void removeListener(FinishedTransferListener *listener);
+
+    void add(const FinishedTransfer &transfer);
+    void remove(int tag);
+    void clear();
+
+    int size() const;
+    const FinishedTransfer *get(int tag) const;
+    int rowOf(int tag) const;
+    int tagAt(int row) const;
+
+protected:
+    int oldestSlot() const;
+    void removeSlot(int slot);
+
+    // Fenwick tree of the used slots, to convert between rows and slots in O(log n)
+    void updateUsedSlots(int slot, int delta);
+    int usedSlotsBefore(int slot) const;
+    int findUsedSlot(int index) const;
+
+    QVector<FinishedTransfer> records;
+    QVector<bool> used;
+    QVector<int> usedTree;
+    QHash<int, int> slotByTag;
+    int maxItems;
+    int numItems;
+    long long numAdded;
+    FinishedTransferListener *listener;
+};
+
+#endif // FINISHEDTRANSFERS_H
@@ -9,6 +9,8 @@
 using namespace mega;
 
 const unsigned int HTTPServer::MAX_REQUEST_TIME_SECS = 1800;
+const unsigned int HTTPServer::KEEP_ALIVE_TIMEOUT_SECS = 30;
+const unsigned int HTTPServer::STREAM_UPDATE_INTERVAL_MS = 250;
 
 bool ts_comparator(RequestData* i, RequestData *j)
 {
@@ -34,21 +36,80 @@ RequestTransferData::RequestTransferData()
     tsEnd = -1;
 }
 
+void HTTPRequest::reset()
+{
+    data.clear();
+    contentLength = 0;
+    origin = QString::fromUtf8("*");
+    keepAlive = false;
+    state = STATE_HEADERS;
+    scanned = 0;
+}
+
 bool HTTPServer::isFirstWebDownloadDone = false;
-QMultiMap<QString, RequestData*> HTTPServer::webDataRequests;
-QMap<mega::MegaHandle, RequestTransferData*> HTTPServer::webTransferStateRequests;
+QMultiHash<QString, RequestData*> HTTPServer::webDataRequests;
+QHash<mega::MegaHandle, RequestTransferData*> HTTPServer::webTransferStateRequests;
+QList<QPair<QString, RequestData*> > HTTPServer::openWebDataRequests;
+QQueue<QPair<QString, RequestData*> > HTTPServer::finishedWebDataRequests;
+QQueue<FinishedTransferData> HTTPServer::finishedTransferStateRequests;
+QHash<QString, HTTPServer::CommandHandler> HTTPServer::commandHandlers;
+QList<HTTPServer*> HTTPServer::servers;
 
 HTTPServer::HTTPServer(MegaApi *megaApi, quint16 port, bool sslEnabled)
     : QTcpServer(), disabled(false)
 {
     this->megaApi = megaApi;
     this->sslEnabled = sslEnabled;
+
+    if (commandHandlers.isEmpty())
+    {
+        // handlers of webclient commands, by the value of "a"
+        commandHandlers.insert(QString::fromUtf8("v"), &HTTPServer::getVersion);
+        commandHandlers.insert(QString::fromUtf8("l"), &HTTPServer::openLink);
+        commandHandlers.insert(QString::fromUtf8("d"), &HTTPServer::externalDownload);
+        commandHandlers.insert(QString::fromUtf8("ufi"), &HTTPServer::externalFileUpload);
+        commandHandlers.insert(QString::fromUtf8("ufo"), &HTTPServer::externalFolderUpload);
+        commandHandlers.insert(QString::fromUtf8("uss"), &HTTPServer::uploadSelectionStatus);
+        commandHandlers.insert(QString::fromUtf8("s"), &HTTPServer::externalFolderSync);
+        commandHandlers.insert(QString::fromUtf8("sp"), &HTTPServer::externalFolderSyncCheck);
+        commandHandlers.insert(QString::fromUtf8("tm"), &HTTPServer::externalOpenTransferManager);
+        commandHandlers.insert(QString::fromUtf8("t"), &HTTPServer::transferQueryProgress);
+        commandHandlers.insert(QString::fromUtf8("ts"), &HTTPServer::transferSubscribe);
+    }
+
+    Preferences::instance();
+    for (int i = 0; i < Preferences::HTTPS_ALLOWED_ORIGINS.size(); i++)
+    {
+        allowedOrigins.append(QRegExp(Preferences::HTTPS_ALLOWED_ORIGINS.at(i), Qt::CaseSensitive, QRegExp::Wildcard));
+    }
+
+    if (sslEnabled)
+    {
+        // The certificate is parsed only once, the server is recreated when it's renewed
+        Preferences *preferences = Preferences::instance();
+        sslKey = QSslKey(preferences->getHttpsKey().toUtf8(), QSsl::Rsa, QSsl::Pem, QSsl::PrivateKey);
+        sslCertificates.append(QSslCertificate(preferences->getHttpsCert().toUtf8(), QSsl::Pem));
+        QStringList intermediates = preferences->getHttpsCertIntermediate().split(QString::fromUtf8(";"), QString::SkipEmptyParts);
+        for (int i = 0; i < intermediates.size(); i++)
+        {
+            sslCertificates.append(QSslCertificate(intermediates.at(i).toUtf8(), QSsl::Pem));
+        }
+    }
+
+    connect(&idleTimer, SIGNAL(timeout()), this, SLOT(checkIdleClients()));
+    idleTimer.start(KEEP_ALIVE_TIMEOUT_SECS * 1000 / 3);
+
+    streamTimer.setSingleShot(true);
+    connect(&streamTimer, SIGNAL(timeout()), this, SLOT(flushStreams()));
+    servers.append(this);
+
     listen(QHostAddress::LocalHost, port);
 }
 
 HTTPServer::~HTTPServer()
 {
-
+    servers.removeAll(this);
+    qDeleteAll(streams);
 }
 
 #if QT_VERSION >= 0x050000
@@ -63,7 +124,6 @@ void HTTPServer::incomingConnection(int socket)
     }
 
     MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Incoming webclient connection");
-    Preferences *preferences = Preferences::instance();
     QTcpSocket* s = NULL;
     QSslSocket *sslSocket = NULL;
 
@@ -84,32 +144,26 @@ void HTTPServer::incomingConnection(int socket)
     connect(s, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(error(QAbstractSocket::SocketError)));
 
     s->setSocketDescriptor(socket);
-    requests.insert(s, new HTTPRequest());
+    HTTPRequest *request = new HTTPRequest();
+    request->lastActivity = QDateTime::currentMSecsSinceEpoch() / 1000;
+    requests.insert(s, request);
 
     if (sslSocket)
     {
         sslSocket->setPeerVerifyMode(QSslSocket::VerifyNone);
 
-        QSslKey key(preferences->getHttpsKey().toUtf8(), QSsl::Rsa, QSsl::Pem, QSsl::PrivateKey);
-        if (key.isNull())
+        if (sslKey.isNull())
         {
             s->disconnectFromHost();
             return;
         }
 
 #if QT_VERSION >= 0x050100
-        QList<QSslCertificate> certificates;
-        certificates.append(QSslCertificate(preferences->getHttpsCert().toUtf8(), QSsl::Pem));
-        QStringList intermediates = preferences->getHttpsCertIntermediate().split(QString::fromUtf8(";"), QString::SkipEmptyParts);
-        for (int i = 0; i < intermediates.size(); i++)
-        {
-            certificates.append(QSslCertificate(intermediates.at(i).toUtf8(), QSsl::Pem));
-        }
-        sslSocket->setLocalCertificateChain(certificates);
+        sslSocket->setLocalCertificateChain(sslCertificates);
 #else
-        sslSocket->setLocalCertificate(QSslCertificate(preferences->getHttpsCert().toUtf8(), QSsl::Pem));
+        sslSocket->setLocalCertificate(sslCertificates.first());
 #endif
-        sslSocket->setPrivateKey(key);
+        sslSocket->setPrivateKey(sslKey);
         sslSocket->startServerEncryption();
     }
 }
@@ -124,76 +178,84 @@ void HTTPServer::resume()
     disabled = false;
 }
 
+// Requests finish in chronological order, so only the oldest ones have to be checked
 void HTTPServer::checkAndPurgeRequests()
 {
-    for (QMultiMap<QString, RequestData*>::iterator it = webDataRequests.begin() ; it != webDataRequests.end();)
+    long long now = QDateTime::currentMSecsSinceEpoch() / 1000;
+    while (!finishedWebDataRequests.isEmpty()
+           && (now - finishedWebDataRequests.head().second->tsEnd) > MAX_REQUEST_TIME_SECS)
     {
-        RequestData *requestData = it.value();
-        if ((requestData->status == RequestData::STATE_OK || requestData->status == RequestData::STATE_CANCELLED)
-                && (((QDateTime::currentMSecsSinceEpoch() / 1000) - requestData->tsEnd) > MAX_REQUEST_TIME_SECS))
-        {
-            webDataRequests.erase(it++);
-            delete requestData;
-        }
-        else
-        {
-            it++;
-        }
+        QPair<QString, RequestData*> request = finishedWebDataRequests.dequeue();
+        webDataRequests.remove(request.first, request.second);
+        delete request.second;
     }
 
-    for (QMap<MegaHandle, RequestTransferData*>::iterator it = webTransferStateRequests.begin() ; it != webTransferStateRequests.end();)
+    while (!finishedTransferStateRequests.isEmpty()
+           && (now - finishedTransferStateRequests.head().tsEnd) > MAX_REQUEST_TIME_SECS)
     {
-        RequestTransferData *transferData = it.value();
-        if ((transferData->state == MegaTransfer::STATE_CANCELLED
-             || transferData->state == MegaTransfer::STATE_COMPLETED
-             || transferData->state == MegaTransfer::STATE_FAILED)
-                && (((QDateTime::currentMSecsSinceEpoch() / 1000) - transferData->tsEnd) > MAX_REQUEST_TIME_SECS))
-        {
-            webTransferStateRequests.erase(it++);
-            delete transferData;
-        }
-        else
+        FinishedTransferData finished = finishedTransferStateRequests.dequeue();
+        RequestTransferData *transferData = webTransferStateRequests.value(finished.handle, NULL);
+        if (transferData != finished.tData || transferData->tsEnd != finished.tsEnd)
         {
-            it++;
+            // outdated entry
+            continue;
         }
+
+        webTransferStateRequests.remove(finished.handle);
+        delete transferData;
     }
 }
 
+int HTTPServer::getNumRequests()
+{
+    return webDataRequests.size() + webTransferStateRequests.size();
+}
+
 void HTTPServer::onUploadSelectionAccepted(int files, int folders)
 {
-    for (QMultiMap<QString, RequestData*>::iterator it = webDataRequests.begin() ; it != webDataRequests.end(); it++)
+    long long now = QDateTime::currentMSecsSinceEpoch() / 1000;
+    for (int i = 0; i < openWebDataRequests.size(); i++)
     {
-        if (it.value()->status == RequestData::STATE_OPEN)
-        {
-            it.value()->status = RequestData::STATE_OK;
-            it.value()->files = files;
-            it.value()->folders = folders;
-            it.value()->tsEnd = QDateTime::currentMSecsSinceEpoch() / 1000;
-        }
+        RequestData *requestData = openWebDataRequests.at(i).second;
+        requestData->status = RequestData::STATE_OK;
+        requestData->files = files;
+        requestData->folders = folders;
+        requestData->tsEnd = now;
+        finishedWebDataRequests.enqueue(openWebDataRequests.at(i));
     }
+    openWebDataRequests.clear();
 }
 
 void HTTPServer::onUploadSelectionDiscarded()
 {
-    for (QMultiMap<QString, RequestData*>::iterator it = webDataRequests.begin() ; it != webDataRequests.end(); it++)
+    long long now = QDateTime::currentMSecsSinceEpoch() / 1000;
+    for (int i = 0; i < openWebDataRequests.size(); i++)
     {
-        if (it.value()->status == RequestData::STATE_OPEN)
-        {
-            it.value()->status = RequestData::STATE_CANCELLED;
-            it.value()->tsEnd  = QDateTime::currentMSecsSinceEpoch() / 1000;
-        }
+        RequestData *requestData = openWebDataRequests.at(i).second;
+        requestData->status = RequestData::STATE_CANCELLED;
+        requestData->tsEnd = now;
+        finishedWebDataRequests.enqueue(openWebDataRequests.at(i));
     }
+    openWebDataRequests.clear();
+}
+
+void HTTPServer::addWebDataRequest(QString bid)
+{
+    RequestData *requestData = new RequestData();
+    webDataRequests.insert(bid, requestData);
+    openWebDataRequests.append(qMakePair(bid, requestData));
 }
 
 void HTTPServer::onTransferDataUpdate(MegaHandle handle, int state, long long progress, long long size, long long speed)
 {
-    QMap<MegaHandle, RequestTransferData*>::iterator it = webTransferStateRequests.find(handle);
+    QHash<MegaHandle, RequestTransferData*>::iterator it = webTransferStateRequests.find(handle);
     if (it == webTransferStateRequests.end())
     {
         return;
     }
 
     RequestTransferData* tData = it.value();
+    bool wasFinished = tData->tsEnd >= 0;
     tData->state = state;
     tData->progress = progress;
     tData->size = size;
@@ -202,8 +264,113 @@ void HTTPServer::onTransferDataUpdate(MegaHandle handle, int state, long long pr
             || state == MegaTransfer::STATE_COMPLETED
             || state == MegaTransfer::STATE_FAILED)
     {
-        tData->tsEnd = QDateTime::currentMSecsSinceEpoch() / 1000;
+        if (!wasFinished)
+        {
+            tData->tsEnd = QDateTime::currentMSecsSinceEpoch() / 1000;
+            finishedTransferStateRequests.enqueue(FinishedTransferData(handle, tData));
+        }
+    }
+    else
+    {
+        // the transfer was restarted, its queued entry becomes outdated
+        tData->tsEnd = -1;
+    }
+
+    for (int i = 0; i < servers.size(); i++)
+    {
+        servers.at(i)->notifyTransferUpdate(handle);
+    }
+}
+
+// mark the handle as changed in the streams subscribed to it, updates are sent by flushStreams
+void HTTPServer::notifyTransferUpdate(MegaHandle handle)
+{
+    bool changed = false;
+    for (QMap<QAbstractSocket*, TransferStream*>::iterator it = streams.begin(); it != streams.end(); it++)
+    {
+        TransferStream *stream = it.value();
+        if (stream->handles.contains(handle))
+        {
+            stream->pending.insert(handle);
+            changed = true;
+        }
+    }
+
+    if (changed && !streamTimer.isActive())
+    {
+        streamTimer.start(0);
+    }
+}
+
+// send the pending updates of each stream, at most once per STREAM_UPDATE_INTERVAL_MS
+void HTTPServer::flushStreams()
+{
+    long long now = QDateTime::currentMSecsSinceEpoch();
+    long long nextUpdate = -1;
+    for (QMap<QAbstractSocket*, TransferStream*>::iterator it = streams.begin(); it != streams.end(); it++)
+    {
+        TransferStream *stream = it.value();
+        if (stream->pending.isEmpty())
+        {
+            continue;
+        }
+
+        long long elapsed = now - stream->lastUpdate;
+        if (elapsed >= STREAM_UPDATE_INTERVAL_MS)
+        {
+            writeStreamEvents(it.key(), stream);
+            stream->lastUpdate = now;
+        }
+        else if (nextUpdate < 0 || (STREAM_UPDATE_INTERVAL_MS - elapsed) < nextUpdate)
+        {
+            nextUpdate = STREAM_UPDATE_INTERVAL_MS - elapsed;
+        }
+    }
+
+    if (nextUpdate >= 0)
+    {
+        streamTimer.start((int)nextUpdate);
+    }
+}
+
+void HTTPServer::writeStreamEvents(QAbstractSocket *socket, TransferStream *stream)
+{
+    QByteArray events;
+    for (QSet<MegaHandle>::iterator it = stream->pending.begin(); it != stream->pending.end(); it++)
+    {
+        RequestTransferData *tData = webTransferStateRequests.value(*it, NULL);
+        if (tData)
+        {
+            events.append("data: ");
+            events.append(transferDataToJSON(tData, stream->handles.value(*it)).toUtf8());
+            events.append("\n\n");
+        }
+    }
+    stream->pending.clear();
+
+    if (events.size())
+    {
+        socket->write(events);
+        socket->flush();
+    }
+}
+
+QString HTTPServer::transferDataToJSON(RequestTransferData *tData, QString handle)
+{
+    QString json = handle.isEmpty() ? QString::fromUtf8("{") : QString::fromUtf8("{\"h\":\"%1\",").arg(handle);
+    if (tData->state == MegaTransfer::STATE_NONE)
+    {
+        json.append(QString::fromUtf8("\"s\":%1}").arg(tData->state));
     }
+    else
+    {
+        json.append(QString::fromUtf8("\"s\":%1,\"p\":%2,\"t\":%3,\"v\":%4}")
+                .arg(tData->state)
+                .arg(tData->progress)
+                .arg(tData->size)
+                .arg(tData->speed));
+    }
+    return json;
 }
 
 void HTTPServer::readClient()
@@ -218,104 +385,176 @@ void HTTPServer::readClient()
         return;
     }
 
-    request->data.append(QString::fromUtf8(socket->readAll().data()));
-    if (request->data.contains(QString::fromUtf8("\r\n\r\n")))
+    request->buffer.append(socket->readAll());
+    request->lastActivity = QDateTime::currentMSecsSinceEpoch() / 1000;
+    if (request->streaming)
     {
-        QStringList tokens = request->data.split(QString::fromUtf8("\r\n\r\n"));
-        QStringList headers = tokens[0].split(QString::fromUtf8("\r\n"));
-        if (!headers.size() || !headers[0].startsWith(QString::fromAscii("POST")))
-        {
-            MegaApi::log(MegaApi::LOG_LEVEL_WARNING, "Method not allowed for webclient request");
-            rejectRequest(socket, QString::fromUtf8("405 Method Not Allowed"));
-            return;
-        }
+        // nothing else is expected from the client on a stream
+        request->buffer.clear();
+        return;
+    }
 
-        if (Preferences::HTTPS_ORIGIN_CHECK_ENABLED && !Preferences::HTTPS_ALLOWED_ORIGINS.isEmpty())
-        {
-            bool found = false;
-            for (int i = 0; i < Preferences::HTTPS_ALLOWED_ORIGINS.size(); i++)
-            {                
-                QRegExp check = QRegExp(QString::fromUtf8("Origin: %1").arg(Preferences::HTTPS_ALLOWED_ORIGINS.at(i)),
-                                        Qt::CaseSensitive, QRegExp::Wildcard);
-                for (int j = 0; j < headers.size(); j++)
-                {
-                    if (check.exactMatch(headers[j]))
-                    {
-                       request->origin = headers[j].mid(8);
-                       found = true;
-                       break;
-                    }
-                }
+    if (request->processing)
+    {
+        // pipelined requests are answered in order, once the current one finishes
+        return;
+    }
 
-                if (found)
-                {
-                    break;
-                }
+    QPointer<QAbstractSocket> safeSocket = socket;
+    QPointer<HTTPServer> safeServer = this;
+    while (true)
+    {
+        if (request->state == HTTPRequest::STATE_HEADERS)
+        {
+            // continue the search where the previous one finished
+            int headersLength = request->buffer.indexOf("\r\n\r\n", qMax(0, request->scanned - 3));
+            if (headersLength < 0)
+            {
+                request->scanned = request->buffer.size();
+                return;
             }
 
-            if (!found)
+            if (!parseHeaders(socket, request, headersLength))
             {
-                MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Missing or invalid Origin header");
-                rejectRequest(socket);
                 return;
             }
+
+            request->buffer.remove(0, headersLength + 4);
+            request->state = HTTPRequest::STATE_BODY;
         }
 
-        QString contentLengthId = QString::fromUtf8("Content-length: ");
-        QStringList contentLengthHeader = headers.filter(QRegExp(contentLengthId, Qt::CaseInsensitive));
-        if (!contentLengthHeader.size())
+        if (request->contentLength > request->buffer.size())
         {
-            MegaApi::log(MegaApi::LOG_LEVEL_WARNING, "Missing Content-length header");
-            rejectRequest(socket);
             return;
         }
 
-        bool ok;
-        request->contentLength = contentLengthHeader[0].mid(contentLengthId.size(), contentLengthHeader[0].size() - contentLengthId.size()).toInt(&ok);
-        if (!ok || request->contentLength < tokens[1].size())
+        request->data = QString::fromUtf8(request->buffer.constData(), request->contentLength);
+        request->buffer.remove(0, request->contentLength);
+
+        request->processing = true;
+        processRequest(socket, *request);
+        if (!safeServer || !safeSocket)
         {
-            if (!ok)
-            {
-                MegaApi::log(MegaApi::LOG_LEVEL_WARNING, QString::fromUtf8("Unable to parse Content-length header: %1")
-                             .arg(contentLengthHeader[0]).toUtf8().constData());
-            }
-            else
-            {
-                MegaApi::log(MegaApi::LOG_LEVEL_WARNING, QString::fromUtf8("Invalid Content-length header. Header: %1 - Data: %2")
-                             .arg(request->contentLength).arg(tokens[1].size()).toUtf8().constData());
-            }
-            rejectRequest(socket);
             return;
         }
 
-        if (request->contentLength > tokens[1].size())
+        HTTPRequest *req = requests.value(socket, NULL);
+        if (request != req)
         {
             return;
         }
 
-        request->data = tokens[1];
-
-
-        QPointer<QAbstractSocket> safeSocket = socket;
-        QPointer<HTTPServer> safeServer = this;
-        processRequest(socket, *request);
-        if (!safeServer || !safeSocket)
+        request->processing = false;
+        request->served++;
+        if (streams.contains(socket))
         {
+            request->streaming = true;
+            request->buffer.clear();
             return;
         }
 
-        HTTPRequest *req = requests.value(socket, NULL);
-        if (request == req)
+        if (!request->keepAlive)
         {
             requests.remove(socket);
             delete request;
+            return;
+        }
+
+        request->reset();
+    }
+}
+
+// parse the request line and the headers of a request, once they are complete
+// returns false if the request has been rejected
+bool HTTPServer::parseHeaders(QAbstractSocket *socket, HTTPRequest *request, int headersLength)
+{
+    QList<QByteArray> headers = request->buffer.left(headersLength).split('\n');
+    if (!headers[0].startsWith("POST"))
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_WARNING, "Method not allowed for webclient request");
+        rejectRequest(socket, QString::fromUtf8("405 Method Not Allowed"));
+        return false;
+    }
+
+    // HTTP/1.1 connections are persistent unless the client asks otherwise
+    request->keepAlive = headers[0].trimmed().endsWith("HTTP/1.1");
+
+    bool checkOrigin = Preferences::HTTPS_ORIGIN_CHECK_ENABLED && !allowedOrigins.isEmpty();
+    bool originFound = false;
+    bool contentLengthFound = false;
+    for (int i = 1; i < headers.size(); i++)
+    {
+        const QByteArray &header = headers.at(i);
+        int separator = header.indexOf(':');
+        if (separator <= 0)
+        {
+            continue;
+        }
+
+        QByteArray name = header.left(separator).trimmed().toLower();
+        QByteArray value = header.mid(separator + 1).trimmed();
+        if (name == "content-length" && !contentLengthFound)
+        {
+            bool ok;
+            contentLengthFound = true;
+            request->contentLength = value.toInt(&ok);
+            if (!ok || request->contentLength < 0)
+            {
+                MegaApi::log(MegaApi::LOG_LEVEL_WARNING, QString::fromUtf8("Unable to parse Content-length header: %1")
+                             .arg(QString::fromUtf8(header.constData())).toUtf8().constData());
+                rejectRequest(socket);
+                return false;
+            }
+        }
+        else if (name == "connection")
+        {
+            value = value.toLower();
+            if (value.contains("close"))
+            {
+                request->keepAlive = false;
+            }
+            else if (value.contains("keep-alive"))
+            {
+                request->keepAlive = true;
+            }
         }
+        else if (name == "origin" && checkOrigin && !originFound)
+        {
+            QString origin = QString::fromUtf8(value.constData(), value.size());
+            for (int j = 0; j < allowedOrigins.size(); j++)
+            {
+                if (allowedOrigins.at(j).exactMatch(origin))
+                {
+                    request->origin = origin;
+                    originFound = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (checkOrigin && !originFound)
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Missing or invalid Origin header");
+        rejectRequest(socket);
+        return false;
+    }
+
+    if (!contentLengthFound)
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_WARNING, "Missing Content-length header");
+        rejectRequest(socket);
+        return false;
     }
+
+    return true;
 }
+
 void HTTPServer::discardClient()
 {
     QAbstractSocket* socket = (QSslSocket*)sender();
     socket->deleteLater();
+    delete streams.take(socket);
 
     HTTPRequest *request = requests.value(socket);
     if (request)
@@ -327,11 +566,14 @@ void HTTPServer::discardClient()
 
 void HTTPServer::rejectRequest(QAbstractSocket *socket, QString response)
 {
-    socket->write(QString::fromUtf8("HTTP/1.0 %1\r\n"
+    socket->write(QString::fromUtf8("HTTP/1.1 %1\r\n"
+                  "Connection: close\r\n"
+                  "Content-Length: 0\r\n"
                   "\r\n").arg(response).toUtf8());
     socket->flush();
     socket->disconnectFromHost();
     socket->deleteLater();
+    delete streams.take(socket);
 
     HTTPRequest *request = requests.value(socket);
     if (request)
@@ -341,429 +583,868 @@ void HTTPServer::rejectRequest(QAbstractSocket *socket, QString response)
     }
 }
 
-void HTTPServer::processRequest(QAbstractSocket *socket, HTTPRequest request)
+// Single-pass recursive descent parser for the JSON documents sent by the webclient
+class JSONParser
 {
-    QString response;
-    QString openLinkRequestStart(QString::fromUtf8("{\"a\":\"l\","));
-    QString externalDownloadRequestStart   = QString::fromUtf8("{\"a\":\"d\",");
-    QString externalFileUploadRequestStart = QString::fromUtf8("{\"a\":\"ufi\",");
-    QString externalFolderUploadRequestStart = QString::fromUtf8("{\"a\":\"ufo\",");
-    QString externalFolderSyncRequestStart = QString::fromUtf8("{\"a\":\"s\",");
-    QString externalFolderSyncCheckStart   = QString::fromUtf8("{\"a\":\"sp\",");
-    QString externalOpenTransferManagerStart   = QString::fromUtf8("{\"a\":\"tm\",");
-    QString externalUploadSelectionStatusStart = QString::fromUtf8("{\"a\":\"uss\",");
-    QString externalTransferQueryProgressStart = QString::fromUtf8("{\"a\":\"t\",");
+public:
+    static const int MAX_DEPTH = 32;
 
-    QPointer<QAbstractSocket> safeSocket = socket;
-    QPointer<HTTPServer> safeServer = this;
+    JSONParser(const QString &json) : pos(json.constData()), end(json.constData() + json.size()) {}
 
-    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Webclient request received: %1").arg(request.data).toUtf8().constData());
-    if (request.data == QString::fromUtf8("{\"a\":\"v\"}"))
+    bool parseDocument(JSONValue *value)
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "GetVersion command received from the webclient");
-        char *myHandle = megaApi->getMyUserHandle();
-        if (!myHandle)
+        if (!parseValue(value, 0))
         {
-            response = QString::fromUtf8("{\"v\":\"%1\"}").arg(Preferences::VERSION_STRING);
+            return false;
         }
-        else
+        skipSpaces();
+        return pos == end;
+    }
+
+private:
+    const QChar *pos;
+    const QChar *end;
+
+    void skipSpaces()
+    {
+        while (pos < end && (*pos == QChar::fromAscii(' ') || *pos == QChar::fromAscii('\t')
+                             || *pos == QChar::fromAscii('\r') || *pos == QChar::fromAscii('\n')))
+        {
+            pos++;
+        }
+    }
+
+    bool parseLiteral(const char *literal)
+    {
+        const QChar *current = pos;
+        while (*literal)
         {
-            response = QString::fromUtf8("{\"v\":\"%1\",\"u\":\"%2\"}")
-                    .arg(Preferences::VERSION_STRING)
-                    .arg(QString::fromUtf8(myHandle));
-            delete [] myHandle;
+            if (current == end || *current != QChar::fromAscii(*literal))
+            {
+                return false;
+            }
+            current++;
+            literal++;
         }
+        pos = current;
+        return true;
     }
-    else if (request.data.startsWith(openLinkRequestStart))
+
+    bool parseValue(JSONValue *value, int depth)
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "OpenLink command received from the webclient");
-        QString handle = Utilities::extractJSONString(request.data, QString::fromUtf8("h"));
-        QString key = Utilities::extractJSONString(request.data, QString::fromUtf8("k"));
-        QString auth = Utilities::extractJSONString(request.data, QString::fromUtf8("esid"));
+        skipSpaces();
+        if (pos == end || depth > MAX_DEPTH)
+        {
+            return false;
+        }
+
+        char c = pos->toAscii();
+        if (c == '{')
+        {
+            value->type = JSONValue::TYPE_OBJECT;
+            return parseObject(value, depth);
+        }
+        if (c == '[')
+        {
+            value->type = JSONValue::TYPE_ARRAY;
+            return parseArray(value, depth);
+        }
+        if (c == '"')
+        {
+            value->type = JSONValue::TYPE_STRING;
+            return parseString(&value->string);
+        }
+        if (c == '-' || (c >= '0' && c <= '9'))
+        {
+            value->type = JSONValue::TYPE_NUMBER;
+            return parseNumber(&value->number);
+        }
+        if (parseLiteral("true"))
+        {
+            value->type = JSONValue::TYPE_BOOL;
+            value->number = 1;
+            return true;
+        }
+        if (parseLiteral("false"))
+        {
+            value->type = JSONValue::TYPE_BOOL;
+            value->number = 0;
+            return true;
+        }
+        if (parseLiteral("null"))
+        {
+            value->type = JSONValue::TYPE_NULL;
+            return true;
+        }
+        return false;
+    }
 
-        if (key.size() > 43)
+    bool parseObject(JSONValue *value, int depth)
+    {
+        pos++;
+        skipSpaces();
+        if (pos < end && *pos == QChar::fromAscii('}'))
         {
-            key.resize(43);
+            pos++;
+            return true;
         }
 
-        if (handle.size() == 8 && key.size() == 43)
+        while (pos < end)
         {
-            QString link = QString::fromUtf8("https://mega.nz/#!%1!%2").arg(handle).arg(key);
-            emit onLinkReceived(link, auth);
-            response = QString::fromUtf8("0");
+            QString name;
+            skipSpaces();
+            if (pos == end || *pos != QChar::fromAscii('"') || !parseString(&name))
+            {
+                return false;
+            }
 
-            Preferences *preferences = Preferences::instance();
-            QString defaultPath = preferences->downloadFolder();
-            webTransferStateRequests.insert(megaApi->base64ToHandle(handle.toUtf8().constData()), new RequestTransferData());
+            skipSpaces();
+            if (pos == end || *pos != QChar::fromAscii(':'))
+            {
+                return false;
+            }
+            pos++;
 
-            if (preferences->hasDefaultDownloadFolder() && QFile(defaultPath).exists())
+            if (!parseValue(&value->members[name], depth + 1))
             {
-                ((MegaApplication *)qApp)->showInfoMessage(tr("Your download has started"));
+                return false;
             }
 
-            if (!isFirstWebDownloadDone && !Preferences::instance()->isFirstWebDownloadDone())
+            skipSpaces();
+            if (pos == end)
             {
-                megaApi->sendEvent(99503, "MEGAsync first webclient download");
-                isFirstWebDownloadDone = true;
+                return false;
             }
+            if (*pos == QChar::fromAscii('}'))
+            {
+                pos++;
+                return true;
+            }
+            if (*pos != QChar::fromAscii(','))
+            {
+                return false;
+            }
+            pos++;
+        }
+        return false;
+    }
+
+    bool parseArray(JSONValue *value, int depth)
+    {
+        pos++;
+        skipSpaces();
+        if (pos < end && *pos == QChar::fromAscii(']'))
+        {
+            pos++;
+            return true;
         }
-        else if (key.size() && key.size() != 43)
+
+        while (pos < end)
         {
-            response = QString::number(MegaError::API_EKEY);
+            value->items.append(JSONValue());
+            if (!parseValue(&value->items.last(), depth + 1))
+            {
+                return false;
+            }
+
+            skipSpaces();
+            if (pos == end)
+            {
+                return false;
+            }
+            if (*pos == QChar::fromAscii(']'))
+            {
+                pos++;
+                return true;
+            }
+            if (*pos != QChar::fromAscii(','))
+            {
+                return false;
+            }
+            pos++;
         }
+        return false;
     }
-    else if (request.data.startsWith(externalDownloadRequestStart))
+
+    bool parseString(QString *string)
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "ExternalDownload command received from the webclient");
-        int start = request.data.indexOf(QString::fromUtf8("\"f\":[")) + 5;
-        if (start > 0)
+        pos++;
+        const QChar *start = pos;
+        while (pos < end && *pos != QChar::fromAscii('"') && *pos != QChar::fromAscii('\\'))
         {
-            QString privateAuth = Utilities::extractJSONString(request.data.mid(0, start), QString::fromUtf8("esid"));
-            QString publicAuth = Utilities::extractJSONString(request.data.mid(0, start), QString::fromUtf8("en"));
+            pos++;
+        }
+        *string = QString(start, pos - start);
 
-            if (privateAuth.isEmpty() && publicAuth.isEmpty())
+        while (pos < end)
+        {
+            char c = pos->toAscii();
+            if (c == '"')
             {
-                QString auth  = Utilities::extractJSONString(request.data.mid(0, start), QString::fromUtf8("auth"));
-                if (auth.length() == 8)
-                {
-                    publicAuth = auth;
-                }
-                else
-                {
-                    privateAuth = auth;
-                }
+                pos++;
+                return true;
+            }
+
+            if (c != '\\')
+            {
+                string->append(*pos);
+                pos++;
+                continue;
             }
 
-            if (privateAuth.size() || publicAuth.size())
+            pos++;
+            if (pos == end)
             {
-                QQueue<MegaNode *> downloadQueue;
-                int end;
-                bool firstnode = true;
+                return false;
+            }
 
-                while (request.data[start] == QChar::fromAscii('{'))
+            c = pos->toAscii();
+            pos++;
+            switch (c)
+            {
+                case '"':
+                case '\\':
+                case '/':
+                    string->append(QChar::fromAscii(c));
+                    break;
+                case 'b':
+                    string->append(QChar::fromAscii('\b'));
+                    break;
+                case 'f':
+                    string->append(QChar::fromAscii('\f'));
+                    break;
+                case 'n':
+                    string->append(QChar::fromAscii('\n'));
+                    break;
+                case 'r':
+                    string->append(QChar::fromAscii('\r'));
+                    break;
+                case 't':
+                    string->append(QChar::fromAscii('\t'));
+                    break;
+                case 'u':
                 {
-                    end = request.data.indexOf(QChar::fromAscii('}'), start);
-                    if (end < 0)
+                    if (end - pos < 4)
                     {
-                        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Error parsing webclient request");
-                        qDeleteAll(downloadQueue);
-                        downloadQueue.clear();
-                        break;
+                        return false;
                     }
 
-                    end++;
-                    QString file = request.data.mid(start, end - start);
-                    start = end + 1;
-
-                    int type = Utilities::extractJSONNumber(file, QString::fromUtf8("t"));
-                    if (type < 0)
+                    bool ok;
+                    ushort unicode = QString(pos, 4).toUShort(&ok, 16);
+                    if (!ok)
                     {
-                        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without type in webclient request");
-                        qDeleteAll(downloadQueue);
-                        downloadQueue.clear();
-                        break;
+                        return false;
                     }
-
-                    QString handle = Utilities::extractJSONString(file, QString::fromUtf8("h"));
-                    if (handle.isEmpty())
-                    {
-                        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without handle in webclient request");
-                        qDeleteAll(downloadQueue);
-                        downloadQueue.clear();
-                        break;
-                    }
-
-                    QString name = Utilities::extractJSONString(file, QString::fromUtf8("n"));
-                    name.replace(QString::fromUtf8("-"), QString::fromUtf8("+"));
-                    name.replace(QString::fromUtf8("_"), QString::fromUtf8("/"));
-                    name = QString::fromUtf8(QByteArray::fromBase64(name.toUtf8().constData()).constData());
-                    if (name.isEmpty())
-                    {
-                        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without name in webclient request");
-                        qDeleteAll(downloadQueue);
-                        downloadQueue.clear();
-                        break;
-                    }
-
-                    MegaHandle h = megaApi->base64ToHandle(handle.toUtf8().constData());
-                    MegaHandle p = INVALID_HANDLE;
-
-                    if (!firstnode)
-                    {
-                        QString parentHandle = Utilities::extractJSONString(file, QString::fromUtf8("p"));
-                        p = megaApi->base64ToHandle(parentHandle.toUtf8().constData());
-                        QApplication::processEvents();
-                        if (!safeServer || !safeSocket)
-                        {
-                            return;
-                        }
-                    }
-                    else
-                    {
-                        firstnode = false;
-                    }
-
-                    if (type != MegaNode::TYPE_FILE)
-                    {
-                        MegaNode *node = megaApi->createForeignFolderNode(h, name.toUtf8().constData(), p,
-                                                                         privateAuth.toUtf8().constData(),
-                                                                         publicAuth.toUtf8().constData());
-                        downloadQueue.append(node);
-                    }
-                    else
-                    {
-                        QString key = Utilities::extractJSONString(file, QString::fromUtf8("k"));
-                        if (key.size() == 43)
-                        {
-                            long long size = Utilities::extractJSONNumber(file, QString::fromUtf8("s"));
-                            long long mtime = Utilities::extractJSONNumber(file, QString::fromUtf8("ts"));
-
-                            MegaNode *node = megaApi->createForeignFileNode(h, key.toUtf8().constData(),
-                                                             name.toUtf8().constData(), size, mtime,
-                                                             p, privateAuth.toUtf8().constData(),
-                                                             publicAuth.toUtf8().constData());
-                            downloadQueue.append(node);
-                        }
-                        else
-                        {
-                            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without key (or an invalid key) in webclient request");
-                        }
-                    }
-                }
-
-                if (downloadQueue.size())
-                {
-                    emit onExternalDownloadRequested(downloadQueue);
-                    emit onExternalDownloadRequestFinished();
-                    response = QString::number(MegaError::API_OK);
+                    string->append(QChar(unicode));
+                    pos += 4;
+                    break;
                 }
+                default:
+                    return false;
             }
         }
+        return false;
     }
-    else if (request.data.startsWith(externalFileUploadRequestStart))
+
+    // only the integer part of numbers is used by the webclient protocol
+    bool parseNumber(long long *number)
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "UploadFile command received from the webclient");
-        QString targetHandle = Utilities::extractJSONString(request.data, QString::fromUtf8("h"));
-        MegaHandle handle = ::mega::INVALID_HANDLE;
-        if (targetHandle.size())
+        bool negative = false;
+        if (*pos == QChar::fromAscii('-'))
         {
-            handle = MegaApi::base64ToHandle(targetHandle.toUtf8().constData());
+            negative = true;
+            pos++;
         }
 
-        MegaNode *targetNode = megaApi->getNodeByHandle(handle);
-        if (!targetNode)
+        if (pos == end || !pos->isDigit())
         {
-            response = QString::number(MegaError::API_ENOENT);
+            return false;
         }
-        else
+
+        long long result = 0;
+        while (pos < end && pos->isDigit())
         {
-            delete targetNode;
-            QString bid = Utilities::extractJSONString(request.data, QString::fromUtf8("bid"));
-            if (!bid.isEmpty())
+            result = result * 10 + pos->digitValue();
+            pos++;
+        }
+
+        if (pos < end && *pos == QChar::fromAscii('.'))
+        {
+            pos++;
+            while (pos < end && pos->isDigit())
             {
-                webDataRequests.insert(bid, new RequestData());
-                emit onExternalFileUploadRequested(handle);
-                response = QString::number(MegaError::API_OK);
+                pos++;
             }
-            else
+        }
+
+        if (pos < end && (*pos == QChar::fromAscii('e') || *pos == QChar::fromAscii('E')))
+        {
+            pos++;
+            if (pos < end && (*pos == QChar::fromAscii('+') || *pos == QChar::fromAscii('-')))
             {
-                response = QString::number(MegaError::API_EARGS);
+                pos++;
+            }
+            while (pos < end && pos->isDigit())
+            {
+                pos++;
             }
         }
+
+        *number = negative ? -result : result;
+        return true;
     }
-    else if (request.data.startsWith(externalFolderUploadRequestStart))
+};
+
+bool JSONValue::parse(const QString &json, JSONValue *value)
+{
+    JSONParser parser(json);
+    return parser.parseDocument(value);
+}
+
+const JSONValue *JSONValue::get(const QString &name) const
+{
+    QHash<QString, JSONValue>::const_iterator it = members.find(name);
+    if (it == members.end())
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "UploadFolder command received from the webclient");
-        QString targetHandle = Utilities::extractJSONString(request.data, QString::fromUtf8("h"));
-        MegaHandle handle = ::mega::INVALID_HANDLE;
-        if (targetHandle.size())
+        return NULL;
+    }
+    return &it.value();
+}
+
+QString JSONValue::getString(const QString &name) const
+{
+    const JSONValue *value = get(name);
+    if (!value || value->type != TYPE_STRING)
+    {
+        return QString();
+    }
+    return value->string;
+}
+
+long long JSONValue::getNumber(const QString &name, long long defaultValue) const
+{
+    const JSONValue *value = get(name);
+    if (!value || value->type != TYPE_NUMBER)
+    {
+        return defaultValue;
+    }
+    return value->number;
+}
+
+void HTTPServer::processRequest(QAbstractSocket *socket, HTTPRequest request)
+{
+    QString response;
+    QPointer<QAbstractSocket> safeSocket = socket;
+    QPointer<HTTPServer> safeServer = this;
+
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Webclient request received: %1").arg(request.data).toUtf8().constData());
+
+    JSONValue command;
+    if (JSONValue::parse(request.data, &command) && command.type == JSONValue::TYPE_OBJECT)
+    {
+        CommandHandler handler = commandHandlers.value(command.getString(QString::fromUtf8("a")), NULL);
+        if (handler)
         {
-            handle = MegaApi::base64ToHandle(targetHandle.toUtf8().constData());
+            response = (this->*handler)(socket, command);
+            if (!safeServer || !safeSocket || streams.contains(socket))
+            {
+                // streams send their own response
+                return;
+            }
         }
+    }
 
-        MegaNode *targetNode = megaApi->getNodeByHandle(handle);
-        if (!targetNode)
+    if (!response.size())
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, QString::fromUtf8("Invalid webclient request: %1").arg(request.data).toUtf8().constData());
+        response = QString::number(MegaError::API_EARGS);
+    }
+    else
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Response to HTTP request: %1").arg(response).toUtf8().constData());
+    }
+
+    QByteArray body = response.toUtf8();
+    QString connection = request.keepAlive
+            ? QString::fromUtf8("keep-alive\r\nKeep-Alive: timeout=%1").arg(KEEP_ALIVE_TIMEOUT_SECS)
+            : QString::fromUtf8("close");
+    QString fullResponse = QString::fromUtf8("HTTP/1.1 200 Ok\r\n"
+                                             "Access-Control-Allow-Origin: %1\r\n"
+                                             "Content-Type: text/html; charset=\"utf-8\"\r\n"
+                                             "Content-Length: %2\r\n"
+                                             "Connection: %3\r\n"
+                                             "\r\n").arg(request.origin).arg(body.size()).arg(connection);
+    if (safeServer && safeSocket)
+    {
+        safeSocket->write(fullResponse.toUtf8() + body);
+        safeSocket->flush();
+        if (!request.keepAlive)
         {
-            response = QString::number(MegaError::API_ENOENT);
+            safeSocket->disconnectFromHost();
+            safeSocket->deleteLater();
         }
-        else
+    }
+}
+
+QString HTTPServer::getVersion(QAbstractSocket *, const JSONValue &)
+{
+    QString response;
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "GetVersion command received from the webclient");
+    char *myHandle = megaApi->getMyUserHandle();
+    if (!myHandle)
+    {
+        response = QString::fromUtf8("{\"v\":\"%1\"}").arg(Preferences::VERSION_STRING);
+    }
+    else
+    {
+        response = QString::fromUtf8("{\"v\":\"%1\",\"u\":\"%2\"}")
+                .arg(Preferences::VERSION_STRING)
+                .arg(QString::fromUtf8(myHandle));
+        delete [] myHandle;
+    }
+    return response;
+}
+
+QString HTTPServer::openLink(QAbstractSocket *, const JSONValue &command)
+{
+    QString response;
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "OpenLink command received from the webclient");
+    QString handle = command.getString(QString::fromUtf8("h"));
+    QString key = command.getString(QString::fromUtf8("k"));
+    QString auth = command.getString(QString::fromUtf8("esid"));
+
+    if (key.size() > 43)
+    {
+        key.resize(43);
+    }
+
+    if (handle.size() == 8 && key.size() == 43)
+    {
+        QString link = QString::fromUtf8("https://mega.nz/#!%1!%2").arg(handle).arg(key);
+        emit onLinkReceived(link, auth);
+        response = QString::fromUtf8("0");
+
+        Preferences *preferences = Preferences::instance();
+        QString defaultPath = preferences->downloadFolder();
+        // a previous entry for the same handle is replaced (its queued entry becomes outdated)
+        MegaHandle h = megaApi->base64ToHandle(handle.toUtf8().constData());
+        delete webTransferStateRequests.value(h, NULL);
+        webTransferStateRequests.insert(h, new RequestTransferData());
+
+        if (preferences->hasDefaultDownloadFolder() && QFile(defaultPath).exists())
         {
-            delete targetNode;
-            QString bid = Utilities::extractJSONString(request.data, QString::fromUtf8("bid"));
-            if (!bid.isEmpty())
-            {
-                webDataRequests.insert(bid, new RequestData());
-                emit onExternalFolderUploadRequested(handle);
-                response = QString::number(MegaError::API_OK);
-            }
-            else
-            {
-                response = QString::number(MegaError::API_EARGS);
-            }
+            ((MegaApplication *)qApp)->showInfoMessage(tr("Your download has started"));
+        }
+
+        if (!isFirstWebDownloadDone && !Preferences::instance()->isFirstWebDownloadDone())
+        {
+            megaApi->sendEvent(99503, "MEGAsync first webclient download");
+            isFirstWebDownloadDone = true;
         }
     }
-    else if (request.data.startsWith(externalUploadSelectionStatusStart))
+    else if (key.size() && key.size() != 43)
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Upload selection status command received from the webclient");
-        QString bid = Utilities::extractJSONString(request.data, QString::fromUtf8("bid"));
-        if (!bid.isEmpty())
+        response = QString::number(MegaError::API_EKEY);
+    }
+    return response;
+}
+
+QString HTTPServer::externalDownload(QAbstractSocket *socket, const JSONValue &command)
+{
+    QString response;
+    QPointer<QAbstractSocket> safeSocket = socket;
+    QPointer<HTTPServer> safeServer = this;
+
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "ExternalDownload command received from the webclient");
+    const JSONValue *files = command.get(QString::fromUtf8("f"));
+    if (!files || files->type != JSONValue::TYPE_ARRAY)
+    {
+        return response;
+    }
+
+    QString privateAuth = command.getString(QString::fromUtf8("esid"));
+    QString publicAuth = command.getString(QString::fromUtf8("en"));
+    if (privateAuth.isEmpty() && publicAuth.isEmpty())
+    {
+        QString auth = command.getString(QString::fromUtf8("auth"));
+        if (auth.length() == 8)
         {
-            QList<RequestData*> values = webDataRequests.values(bid);
-            if (!values.isEmpty())
-            {
-                qSort(values.begin(), values.end(), ts_comparator);
-                for (int i = 0; i < values.size(); ++i)
-                {
-                    response.append(i == 0 ? QString::fromUtf8("[") : QString::fromUtf8(","));
-                    if (values.at(i)->status == RequestData::STATE_OK)
-                    {
-                        response.append(QString::fromUtf8("{\"s\":%1,\"ts\":%2,\"fi\":%3,\"fo\":%4}")
-                                .arg(values.at(i)->status)
-                                .arg(values.at(i)->tsStart)
-                                .arg(values.at(i)->files)
-                                .arg(values.at(i)->folders));
-                    }
-                    else
-                    {
-                        response.append(QString::fromUtf8("{\"s\":%1,\"ts\":%2}")
-                                .arg(values.at(i)->status)
-                                .arg(values.at(i)->tsStart));
-                    }
-                }
-                response.append(QString::fromUtf8("]"));
-            }
-            else
-            {
-                response = QString::number(MegaError::API_ENOENT);
-            }
+            publicAuth = auth;
         }
         else
         {
-            response = QString::number(MegaError::API_EARGS);
+            privateAuth = auth;
         }
     }
-    else if (request.data.startsWith(externalFolderSyncRequestStart))
+
+    if (privateAuth.isEmpty() && publicAuth.isEmpty())
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Sync command received from the webclient");
-        QString targetHandle = Utilities::extractJSONString(request.data, QString::fromUtf8("h"));
-        MegaHandle handle = ::mega::INVALID_HANDLE;
-        if (targetHandle.size())
+        return response;
+    }
+
+    QQueue<MegaNode *> downloadQueue;
+    bool firstnode = true;
+    for (int i = 0; i < files->items.size(); i++)
+    {
+        const JSONValue &file = files->items.at(i);
+        if (file.type != JSONValue::TYPE_OBJECT)
         {
-            handle = MegaApi::base64ToHandle(targetHandle.toUtf8().constData());
+            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Error parsing webclient request");
+            qDeleteAll(downloadQueue);
+            downloadQueue.clear();
+            break;
         }
 
-        MegaNode *targetNode = megaApi->getNodeByHandle(handle);
-        if (!targetNode)
+        int type = file.getNumber(QString::fromUtf8("t"));
+        if (type < 0)
         {
-            response = QString::number(MegaError::API_ENOENT);
+            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without type in webclient request");
+            qDeleteAll(downloadQueue);
+            downloadQueue.clear();
+            break;
+        }
+
+        QString handle = file.getString(QString::fromUtf8("h"));
+        if (handle.isEmpty())
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without handle in webclient request");
+            qDeleteAll(downloadQueue);
+            downloadQueue.clear();
+            break;
+        }
+
+        QString name = file.getString(QString::fromUtf8("n"));
+        name.replace(QString::fromUtf8("-"), QString::fromUtf8("+"));
+        name.replace(QString::fromUtf8("_"), QString::fromUtf8("/"));
+        name = QString::fromUtf8(QByteArray::fromBase64(name.toUtf8().constData()).constData());
+        if (name.isEmpty())
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without name in webclient request");
+            qDeleteAll(downloadQueue);
+            downloadQueue.clear();
+            break;
+        }
+
+        MegaHandle h = megaApi->base64ToHandle(handle.toUtf8().constData());
+        MegaHandle p = INVALID_HANDLE;
+
+        if (!firstnode)
+        {
+            QString parentHandle = file.getString(QString::fromUtf8("p"));
+            p = megaApi->base64ToHandle(parentHandle.toUtf8().constData());
+            QApplication::processEvents();
+            if (!safeServer || !safeSocket)
+            {
+                qDeleteAll(downloadQueue);
+                return QString();
+            }
         }
         else
         {
-            delete targetNode;
-            emit onExternalFolderSyncRequested(handle);
-            response = QString::number(MegaError::API_OK);
+            firstnode = false;
         }
-    }
-    else if (request.data.startsWith(externalFolderSyncCheckStart))
-    {
-        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Check sync folder command received from the webclient");
-        QString targetHandle = Utilities::extractJSONString(request.data, QString::fromUtf8("h"));
-        MegaHandle handle = ::mega::INVALID_HANDLE;
-        if (targetHandle.size())
+
+        if (type != MegaNode::TYPE_FILE)
         {
-            handle = MegaApi::base64ToHandle(targetHandle.toUtf8().constData());
-            MegaNode *targetNode = megaApi->getNodeByHandle(handle);
-            if (!targetNode)
+            MegaNode *node = megaApi->createForeignFolderNode(h, name.toUtf8().constData(), p,
+                                                             privateAuth.toUtf8().constData(),
+                                                             publicAuth.toUtf8().constData());
+            downloadQueue.append(node);
+        }
+        else
+        {
+            QString key = file.getString(QString::fromUtf8("k"));
+            if (key.size() == 43)
             {
-                response = QString::number(MegaError::API_ENOENT);
+                long long size = file.getNumber(QString::fromUtf8("s"));
+                long long mtime = file.getNumber(QString::fromUtf8("ts"));
+
+                MegaNode *node = megaApi->createForeignFileNode(h, key.toUtf8().constData(),
+                                                 name.toUtf8().constData(), size, mtime,
+                                                 p, privateAuth.toUtf8().constData(),
+                                                 publicAuth.toUtf8().constData());
+                downloadQueue.append(node);
             }
             else
             {
-                int result = megaApi->isNodeSyncable(targetNode);
-                response = QString::number(result);
-                delete targetNode;
+                MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Node without key (or an invalid key) in webclient request");
             }
         }
-        else
-        {
-            response = QString::number(MegaError::API_EARGS);
-        }
     }
-    else if (request.data.startsWith(externalOpenTransferManagerStart))
+
+    if (downloadQueue.size())
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Open Transfer Manager command received from the webclient");
-        int tab = Utilities::extractJSONNumber(request.data, QString::fromUtf8("t"));
-        if (tab < 0 || tab > 3) //Not valid number tab (all, downloads, uploads, completed)
+        emit onExternalDownloadRequested(downloadQueue);
+        emit onExternalDownloadRequestFinished();
+        response = QString::number(MegaError::API_OK);
+    }
+    return response;
+}
+
+QString HTTPServer::externalFileUpload(QAbstractSocket *, const JSONValue &command)
+{
+    QString response;
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "UploadFile command received from the webclient");
+    QString targetHandle = command.getString(QString::fromUtf8("h"));
+    MegaHandle handle = ::mega::INVALID_HANDLE;
+    if (targetHandle.size())
+    {
+        handle = MegaApi::base64ToHandle(targetHandle.toUtf8().constData());
+    }
+
+    MegaNode *targetNode = megaApi->getNodeByHandle(handle);
+    if (!targetNode)
+    {
+        response = QString::number(MegaError::API_ENOENT);
+    }
+    else
+    {
+        delete targetNode;
+        QString bid = command.getString(QString::fromUtf8("bid"));
+        if (!bid.isEmpty())
         {
-            response = QString::number(MegaError::API_EARGS);
+            addWebDataRequest(bid);
+            emit onExternalFileUploadRequested(handle);
+            response = QString::number(MegaError::API_OK);
         }
         else
         {
-            emit onExternalOpenTransferManagerRequested(tab);
-            response = QString::number(MegaError::API_OK);
+            response = QString::number(MegaError::API_EARGS);
         }
     }
-    else if (request.data.startsWith(externalTransferQueryProgressStart))
+    return response;
+}
+
+QString HTTPServer::externalFolderUpload(QAbstractSocket *, const JSONValue &command)
+{
+    QString response;
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "UploadFolder command received from the webclient");
+    QString targetHandle = command.getString(QString::fromUtf8("h"));
+    MegaHandle handle = ::mega::INVALID_HANDLE;
+    if (targetHandle.size())
     {
-        QString targetHandle = Utilities::extractJSONString(request.data, QString::fromUtf8("h"));
-        MegaHandle handle = ::mega::INVALID_HANDLE;
-        if (targetHandle.size())
+        handle = MegaApi::base64ToHandle(targetHandle.toUtf8().constData());
+    }
+
+    MegaNode *targetNode = megaApi->getNodeByHandle(handle);
+    if (!targetNode)
+    {
+        response = QString::number(MegaError::API_ENOENT);
+    }
+    else
+    {
+        delete targetNode;
+        QString bid = command.getString(QString::fromUtf8("bid"));
+        if (!bid.isEmpty())
         {
-            handle = MegaApi::base64ToHandle(targetHandle.toUtf8().constData());
+            addWebDataRequest(bid);
+            emit onExternalFolderUploadRequested(handle);
+            response = QString::number(MegaError::API_OK);
         }
-
-        if (handle == ::mega::INVALID_HANDLE)
+        else
         {
             response = QString::number(MegaError::API_EARGS);
         }
-        else
+    }
+    return response;
+}
+
+QString HTTPServer::uploadSelectionStatus(QAbstractSocket *, const JSONValue &command)
+{
+    QString response;
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Upload selection status command received from the webclient");
+    QString bid = command.getString(QString::fromUtf8("bid"));
+    if (!bid.isEmpty())
+    {
+        QList<RequestData*> values = webDataRequests.values(bid);
+        if (!values.isEmpty())
         {
-            if (!webTransferStateRequests.contains(handle))
+            qSort(values.begin(), values.end(), ts_comparator);
+            for (int i = 0; i < values.size(); ++i)
             {
-                response = QString::number(MegaError::API_ENOENT);
-            }
-            else
-            {
-                RequestTransferData* tData = webTransferStateRequests.value(handle);
-                if (tData->state == MegaTransfer::STATE_NONE)
+                response.append(i == 0 ? QString::fromUtf8("[") : QString::fromUtf8(","));
+                if (values.at(i)->status == RequestData::STATE_OK)
                 {
-                    response = QString::fromUtf8("{\"s\":%1}").arg(tData->state);
+                    response.append(QString::fromUtf8("{\"s\":%1,\"ts\":%2,\"fi\":%3,\"fo\":%4}")
+                            .arg(values.at(i)->status)
+                            .arg(values.at(i)->tsStart)
+                            .arg(values.at(i)->files)
+                            .arg(values.at(i)->folders));
                 }
                 else
                 {
-                    response = QString::fromUtf8("{\"s\":%1,\"p\":%2,\"t\":%3,\"v\":%4}")
-                            .arg(tData->state)
-                            .arg(tData->progress)
-                            .arg(tData->size)
-                            .arg(tData->speed);
+                    response.append(QString::fromUtf8("{\"s\":%1,\"ts\":%2}")
+                            .arg(values.at(i)->status)
+                            .arg(values.at(i)->tsStart));
                 }
             }
+            response.append(QString::fromUtf8("]"));
+        }
+        else
+        {
+            response = QString::number(MegaError::API_ENOENT);
         }
     }
+    else
+    {
+        response = QString::number(MegaError::API_EARGS);
+    }
+    return response;
+}
 
-    if (!response.size())
+QString HTTPServer::externalFolderSync(QAbstractSocket *, const JSONValue &command)
+{
+    QString response;
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Sync command received from the webclient");
+    QString targetHandle = command.getString(QString::fromUtf8("h"));
+    MegaHandle handle = ::mega::INVALID_HANDLE;
+    if (targetHandle.size())
+    {
+        handle = MegaApi::base64ToHandle(targetHandle.toUtf8().constData());
+    }
+
+    MegaNode *targetNode = megaApi->getNodeByHandle(handle);
+    if (!targetNode)
+    {
+        response = QString::number(MegaError::API_ENOENT);
+    }
+    else
+    {
+        delete targetNode;
+        emit onExternalFolderSyncRequested(handle);
+        response = QString::number(MegaError::API_OK);
+    }
+    return response;
+}
+
+QString HTTPServer::externalFolderSyncCheck(QAbstractSocket *, const JSONValue &command)
+{
+    QString response;
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Check sync folder command received from the webclient");
+    QString targetHandle = command.getString(QString::fromUtf8("h"));
+    MegaHandle handle = ::mega::INVALID_HANDLE;
+    if (targetHandle.size())
+    {
+        handle = MegaApi::base64ToHandle(targetHandle.toUtf8().constData());
+        MegaNode *targetNode = megaApi->getNodeByHandle(handle);
+        if (!targetNode)
+        {
+            response = QString::number(MegaError::API_ENOENT);
+        }
+        else
+        {
+            int result = megaApi->isNodeSyncable(targetNode);
+            response = QString::number(result);
+            delete targetNode;
+        }
+    }
+    else
+    {
+        response = QString::number(MegaError::API_EARGS);
+    }
+    return response;
+}
+
+QString HTTPServer::externalOpenTransferManager(QAbstractSocket *, const JSONValue &command)
+{
+    QString response;
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Open Transfer Manager command received from the webclient");
+    int tab = command.getNumber(QString::fromUtf8("t"));
+    if (tab < 0 || tab > 3) //Not valid number tab (all, downloads, uploads, completed)
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, QString::fromUtf8("Invalid webclient request: %1").arg(request.data).toUtf8().constData());
         response = QString::number(MegaError::API_EARGS);
     }
     else
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Response to HTTP request: %1").arg(response).toUtf8().constData());
+        emit onExternalOpenTransferManagerRequested(tab);
+        response = QString::number(MegaError::API_OK);
     }
+    return response;
+}
 
-    QString fullResponse = QString::fromUtf8("HTTP/1.0 200 Ok\r\n"
-                                             "Access-Control-Allow-Origin: %1\r\n"
-                                             "Content-Type: text/html; charset=\"utf-8\"\r\n"
-                                             "Content-Length: %2\r\n"
-                                             "\r\n"
-                                             "%3").arg(request.origin).arg(response.size()).arg(response);
-    if (safeServer && safeSocket)
+QString HTTPServer::transferQueryProgress(QAbstractSocket *, const JSONValue &command)
+{
+    QString response;
+    QString targetHandle = command.getString(QString::fromUtf8("h"));
+    MegaHandle handle = ::mega::INVALID_HANDLE;
+    if (targetHandle.size())
     {
-        safeSocket->write(fullResponse.toUtf8());
-        safeSocket->flush();
-        safeSocket->disconnectFromHost();
-        safeSocket->deleteLater();
+        handle = MegaApi::base64ToHandle(targetHandle.toUtf8().constData());
+    }
+
+    if (handle == ::mega::INVALID_HANDLE)
+    {
+        response = QString::number(MegaError::API_EARGS);
     }
+    else
+    {
+        if (!webTransferStateRequests.contains(handle))
+        {
+            response = QString::number(MegaError::API_ENOENT);
+        }
+        else
+        {
+            response = transferDataToJSON(webTransferStateRequests.value(handle));
+        }
+    }
+    return response;
+}
+
+// Turn the connection into a stream of Server-Sent Events with the progress of the requested transfers
+QString HTTPServer::transferSubscribe(QAbstractSocket *socket, const JSONValue &command)
+{
+    QString response;
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Transfer subscription received from the webclient");
+    const JSONValue *handles = command.get(QString::fromUtf8("h"));
+    if (!handles || (handles->type != JSONValue::TYPE_ARRAY && handles->type != JSONValue::TYPE_STRING))
+    {
+        return QString::number(MegaError::API_EARGS);
+    }
+
+    QList<JSONValue> items = handles->type == JSONValue::TYPE_ARRAY ? handles->items : (QList<JSONValue>() << *handles);
+    TransferStream *stream = new TransferStream();
+    for (int i = 0; i < items.size(); i++)
+    {
+        const JSONValue &item = items.at(i);
+        MegaHandle handle = ::mega::INVALID_HANDLE;
+        if (item.type == JSONValue::TYPE_STRING && item.string.size())
+        {
+            handle = MegaApi::base64ToHandle(item.string.toUtf8().constData());
+        }
+
+        if (handle == ::mega::INVALID_HANDLE)
+        {
+            delete stream;
+            return QString::number(MegaError::API_EARGS);
+        }
+
+        stream->handles.insert(handle, item.string);
+        if (webTransferStateRequests.contains(handle))
+        {
+            stream->pending.insert(handle);
+        }
+    }
+
+    if (stream->handles.isEmpty())
+    {
+        delete stream;
+        return QString::number(MegaError::API_EARGS);
+    }
+
+    HTTPRequest *request = requests.value(socket, NULL);
+    QString origin = request ? request->origin : QString::fromUtf8("*");
+    socket->write(QString::fromUtf8("HTTP/1.1 200 Ok\r\n"
+                                    "Access-Control-Allow-Origin: %1\r\n"
+                                    "Content-Type: text/event-stream; charset=\"utf-8\"\r\n"
+                                    "Cache-Control: no-cache\r\n"
+                                    "Connection: close\r\n"
+                                    "\r\n").arg(origin).toUtf8());
+
+    // the current state is sent right away, then only the changes
+    streams.insert(socket, stream);
+    writeStreamEvents(socket, stream);
+    stream->lastUpdate = QDateTime::currentMSecsSinceEpoch();
+    return response;
 }
 
 void HTTPServer::error(QAbstractSocket::SocketError)
@@ -772,7 +1453,7 @@ void HTTPServer::error(QAbstractSocket::SocketError)
     {
         QAbstractSocket *socket = (QAbstractSocket*)sender();
         HTTPRequest *request = requests.value(socket);
-        if (request && !request->data.size())
+        if (request && !request->served && request->state == HTTPRequest::STATE_HEADERS && !request->buffer.size())
         {
             MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Webclient failed to connect using HTTPS");
             emit onConnectionError();
@@ -780,6 +1461,33 @@ void HTTPServer::error(QAbstractSocket::SocketError)
     }
 }
 
+void HTTPServer::checkIdleClients()
+{
+    long long now = QDateTime::currentMSecsSinceEpoch() / 1000;
+    QList<QAbstractSocket*> idleSockets;
+    for (QMap<QAbstractSocket*, HTTPRequest*>::iterator it = requests.begin(); it != requests.end(); it++)
+    {
+        HTTPRequest *request = it.value();
+        if (!request->processing && !request->streaming && (now - request->lastActivity) > KEEP_ALIVE_TIMEOUT_SECS)
+        {
+            idleSockets.append(it.key());
+        }
+    }
+
+    // comments keep streams alive and let dead clients be detected
+    for (QMap<QAbstractSocket*, TransferStream*>::iterator it = streams.begin(); it != streams.end(); it++)
+    {
+        it.key()->write(": ping\n\n");
+    }
+
+    // closing a socket removes its request from the map
+    for (int i = 0; i < idleSockets.size(); i++)
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Closing idle webclient connection");
+        idleSockets.at(i)->disconnectFromHost();
+    }
+}
+
 void HTTPServer::sslErrors(const QList<QSslError> &)
 {
 }
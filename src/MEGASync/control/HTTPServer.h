@@ -8,6 +8,9 @@
 #include <QStringList>
 #include <QDateTime>
 #include <QQueue>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
 
 #include <megaapi.h>
 
@@ -44,10 +47,80 @@ public:
 class HTTPRequest
 {
 public:
-    HTTPRequest() : contentLength(0), origin(QString::fromUtf8("*")) {}
+    enum
+    {
+        STATE_HEADERS = 0,    ///< Waiting for the end of the headers.
+        STATE_BODY    = 1,    ///< Headers parsed, waiting for the rest of the body.
+    };
+
+    HTTPRequest() : contentLength(0), origin(QString::fromUtf8("*")), keepAlive(false),
+                    state(STATE_HEADERS), scanned(0), processing(false), streaming(false),
+                    served(0), lastActivity(0) {}
+
+    // Prepare the next request of a persistent connection
+    void reset();
+
     QString data;
     int contentLength;
     QString origin;
+    bool keepAlive;
+
+    int state;
+    int scanned;        ///< Bytes of buffer already searched for the end of the headers.
+    QByteArray buffer;  ///< Received bytes not parsed yet (may include pipelined requests).
+    bool processing;    ///< A request of this connection is being processed.
+    bool streaming;     ///< The connection has become a transfer progress stream.
+    int served;         ///< Requests already answered on this connection.
+    long long lastActivity;
+};
+
+class FinishedTransferData
+{
+public:
+    FinishedTransferData(mega::MegaHandle handle, RequestTransferData *tData)
+        : handle(handle), tData(tData), tsEnd(tData->tsEnd) {}
+    mega::MegaHandle handle;
+    RequestTransferData *tData;
+    long long tsEnd;    ///< Entries are outdated if the transfer data was replaced or finished again
+};
+
+class TransferStream
+{
+public:
+    TransferStream() : lastUpdate(0) {}
+    QMap<mega::MegaHandle, QString> handles;    ///< Subscribed handles (and their Base64 representation)
+    QSet<mega::MegaHandle> pending;             ///< Subscribed handles with changes not sent yet
+    long long lastUpdate;                       ///< Time of the last update sent (in milliseconds)
+};
+
+class JSONValue
+{
+public:
+    enum
+    {
+        TYPE_NULL   = 0,
+        TYPE_BOOL   = 1,
+        TYPE_NUMBER = 2,
+        TYPE_STRING = 3,
+        TYPE_ARRAY  = 4,
+        TYPE_OBJECT = 5,
+    };
+
+    JSONValue() : type(TYPE_NULL), number(0) {}
+
+    // Parse a JSON document in a single pass
+    static bool parse(const QString &json, JSONValue *value);
+
+    // Members of objects (empty string, default number or NULL if missing)
+    QString getString(const QString &name) const;
+    long long getNumber(const QString &name, long long defaultValue = 0) const;
+    const JSONValue *get(const QString &name) const;
+
+    int type;
+    long long number;               ///< TYPE_NUMBER (integer part) and TYPE_BOOL
+    QString string;                 ///< TYPE_STRING
+    QList<JSONValue> items;         ///< TYPE_ARRAY
+    QHash<QString, JSONValue> members;  ///< TYPE_OBJECT
 };
 
 class HTTPServer: public QTcpServer
@@ -56,6 +129,8 @@ class HTTPServer: public QTcpServer
 
     public:
         static const unsigned int MAX_REQUEST_TIME_SECS;
+        static const unsigned int KEEP_ALIVE_TIMEOUT_SECS;
+        static const unsigned int STREAM_UPDATE_INTERVAL_MS;
 
         HTTPServer(mega::MegaApi *megaApi, quint16 port, bool sslEnabled);
         ~HTTPServer();
@@ -68,6 +143,7 @@ class HTTPServer: public QTcpServer
         void resume();
 
         static void checkAndPurgeRequests();
+        static int getNumRequests();
         static void onUploadSelectionAccepted(int files, int folders);
         static void onUploadSelectionDiscarded();
         static void onTransferDataUpdate(mega::MegaHandle handle, int state, long long progress, long long size, long long speed);
@@ -86,19 +162,54 @@ class HTTPServer: public QTcpServer
         void readClient();
         void discardClient();
         void rejectRequest(QAbstractSocket *socket, QString response = QString::fromUtf8("403 Forbidden"));
+        bool parseHeaders(QAbstractSocket *socket, HTTPRequest *request, int headersLength);
         void processRequest(QAbstractSocket *socket, HTTPRequest request);
         void error(QAbstractSocket::SocketError);
         void sslErrors(const QList<QSslError> & errors);
         void peerVerifyError(const QSslError & error);
+        void checkIdleClients();
+        void flushStreams();
 
     private:
+        typedef QString (HTTPServer::*CommandHandler)(QAbstractSocket *socket, const JSONValue &command);
+        static QHash<QString, CommandHandler> commandHandlers;
+
+        QString getVersion(QAbstractSocket *socket, const JSONValue &command);
+        QString openLink(QAbstractSocket *socket, const JSONValue &command);
+        QString externalDownload(QAbstractSocket *socket, const JSONValue &command);
+        QString externalFileUpload(QAbstractSocket *socket, const JSONValue &command);
+        QString externalFolderUpload(QAbstractSocket *socket, const JSONValue &command);
+        QString uploadSelectionStatus(QAbstractSocket *socket, const JSONValue &command);
+        QString externalFolderSync(QAbstractSocket *socket, const JSONValue &command);
+        QString externalFolderSyncCheck(QAbstractSocket *socket, const JSONValue &command);
+        QString externalOpenTransferManager(QAbstractSocket *socket, const JSONValue &command);
+        QString transferQueryProgress(QAbstractSocket *socket, const JSONValue &command);
+        QString transferSubscribe(QAbstractSocket *socket, const JSONValue &command);
+
+        void notifyTransferUpdate(mega::MegaHandle handle);
+        void writeStreamEvents(QAbstractSocket *socket, TransferStream *stream);
+        static void addWebDataRequest(QString bid);
+        static QString transferDataToJSON(RequestTransferData *tData, QString handle = QString());
+
         bool disabled;
         bool sslEnabled;
         mega::MegaApi *megaApi;
         QMap<QAbstractSocket*, HTTPRequest*> requests;
+        QList<QRegExp> allowedOrigins;
+        QSslKey sslKey;
+        QList<QSslCertificate> sslCertificates;
+        QTimer idleTimer;
+        QMap<QAbstractSocket*, TransferStream*> streams;
+        QTimer streamTimer;
+        static QList<HTTPServer*> servers;
         static bool isFirstWebDownloadDone;
-        static QMultiMap<QString, RequestData*> webDataRequests;
-        static QMap<mega::MegaHandle, RequestTransferData*> webTransferStateRequests;
+        static QMultiHash<QString, RequestData*> webDataRequests;
+        static QHash<mega::MegaHandle, RequestTransferData*> webTransferStateRequests;
+
+        // Requests with the selection dialog still open and finished requests, in finishing order
+        static QList<QPair<QString, RequestData*> > openWebDataRequests;
+        static QQueue<QPair<QString, RequestData*> > finishedWebDataRequests;
+        static QQueue<FinishedTransferData> finishedTransferStateRequests;
 };
 
 #endif // HTTPSERVER_H
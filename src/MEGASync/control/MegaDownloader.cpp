@@ -1,111 +1,278 @@
 #include "MegaDownloader.h"
 #include "Utilities.h"
+#include "Preferences.h"
 #include <QApplication>
 #include <QDateTime>
 #include <QPointer>
+#include <QtCore>
+
+#if QT_VERSION >= 0x050000
+#include <QtConcurrent/QtConcurrent>
+#endif
+
+#ifndef WIN32
+#include <sys/stat.h>
+#endif
 
 using namespace mega;
 
-MegaDownloader::MegaDownloader(MegaApi *megaApi, MegaApi *megaApiGuest) : QObject()
+const int DownloadPlanner::PROGRESS_INTERVAL = 1000;
+
+// Runs in the thread pool, the folders of the same level are created in parallel
+static void createLocalFolder(LocalFolder &folder)
+{
+    QDir dir(folder.path);
+    if (dir.exists())
+    {
+        folder.created = true;
+        return;
+    }
+
+#ifndef WIN32
+    // same permissions as MegaApi::createLocalFolder, without locking the SDK
+    QByteArray path = QDir::toNativeSeparators(folder.path).toUtf8();
+    folder.created = !mkdir(path.constData(), 0700) && !chmod(path.constData(), folder.permissions | 0700);
+#else
+    folder.created = dir.mkpath(QString::fromAscii("."));
+#endif
+}
+
+DownloadPlanner::DownloadPlanner(MegaApi *megaApi, MegaApi *megaApiGuest) : QObject()
 {
     this->megaApi = megaApi;
     this->megaApiGuest = megaApiGuest;
+    numFolders = 0;
+    numFiles = 0;
+    lastReport = 0;
 }
 
-MegaDownloader::~MegaDownloader()
+DownloadPlanner::~DownloadPlanner()
+{
+    for (int i = 0; i < jobs.size(); i++)
+    {
+        qDeleteAll(jobs[i].nodes);
+    }
+}
+
+void DownloadPlanner::addJob(QQueue<MegaNode *> *nodes, QString path, int folderPermissions)
 {
+    DownloadJob job;
+    job.nodes = *nodes;
+    job.path = path;
+    job.folderPermissions = folderPermissions;
+    job.generation = getGeneration();
+    nodes->clear();
 
+    mutex.lock();
+    jobs.enqueue(job);
+    mutex.unlock();
 }
 
-void MegaDownloader::download(MegaNode *parent, QString path)
+void DownloadPlanner::cancel()
 {
-    return download(parent, QFileInfo(path));
+    generation.fetchAndAddOrdered(1);
 }
 
-void MegaDownloader::processDownloadQueue(QQueue<MegaNode *> *downloadQueue, QString path)
+int DownloadPlanner::getGeneration()
 {
-    QDir dir(path);
-    if (!dir.exists() && !dir.mkpath(QString::fromAscii(".")))
-    {
-        qDeleteAll(*downloadQueue);
-        downloadQueue->clear();
-        return;
-    }
+    return generation.fetchAndAddOrdered(0);
+}
 
-    QString currentPath;
-    while (!downloadQueue->isEmpty())
+void DownloadPlanner::processJobs()
+{
+    while (true)
     {
-        MegaNode *node = downloadQueue->dequeue();
-        if (node->isForeign() && pathMap.contains(node->getParentHandle()))
+        mutex.lock();
+        if (jobs.isEmpty())
         {
-            currentPath = pathMap[node->getParentHandle()];
-        }
-        else
-        {
-            currentPath = path;
+            mutex.unlock();
+            break;
         }
+        DownloadJob job = jobs.dequeue();
+        mutex.unlock();
 
-        download(node, currentPath);
-        delete node;
+        processJob(job);
+    }
+
+    if (numFolders || numFiles)
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Download planned: %1 folders / %2 files")
+                     .arg(numFolders).arg(numFiles).toUtf8().constData());
+        emit progress(numFolders, numFiles, true);
+        numFolders = numFiles = lastReport = 0;
     }
-    pathMap.clear();
 }
 
-void MegaDownloader::download(MegaNode *parent, QFileInfo info)
+void DownloadPlanner::processJob(DownloadJob &job)
 {
-    QPointer<MegaDownloader> safePointer = this;
-    QApplication::processEvents();
-    if (!safePointer)
+    QMap<MegaHandle, QString> pathMap;
+    while (!job.nodes.isEmpty())
     {
-        return;
-    }
+        MegaNode *node = job.nodes.dequeue();
+        if (job.generation != getGeneration())
+        {
+            // cancelled
+            delete node;
+            continue;
+        }
 
-    QString currentPath = QDir::toNativeSeparators(info.absoluteFilePath());
+        QString currentPath = job.path;
+        if (node->isForeign() && pathMap.contains(node->getParentHandle()))
+        {
+            currentPath = pathMap[node->getParentHandle()];
+        }
+        currentPath = QDir::toNativeSeparators(QFileInfo(currentPath).absoluteFilePath());
 
-    if (parent->getType() == MegaNode::TYPE_FILE)
-    {
-        if ((parent->isPublic() || parent->isForeign()) && megaApiGuest)
+        if (node->getType() == MegaNode::TYPE_FILE)
         {
-            megaApiGuest->startDownload(parent, (currentPath + QDir::separator()).toUtf8().constData());
+            startDownload(node, currentPath);
         }
         else
         {
-            megaApi->startDownload(parent, (currentPath + QDir::separator()).toUtf8().constData());
+            char *escapedName = megaApi->escapeFsIncompatible(node->getName());
+            QString nodeName = QString::fromUtf8(escapedName);
+            delete [] escapedName;
+
+            LocalFolder folder(currentPath + QDir::separator() + nodeName, node->getHandle(), job.folderPermissions);
+            createLocalFolder(folder);
+            if (folder.created)
+            {
+                numFolders++;
+                if (!node->isForeign())
+                {
+                    downloadFolder(node, folder.path, job);
+                }
+                else
+                {
+                    pathMap[node->getHandle()] = folder.path;
+                }
+            }
         }
+        delete node;
     }
-    else
-    {
-        char *escapedName = megaApi->escapeFsIncompatible(parent->getName());
-        QString nodeName = QString::fromUtf8(escapedName);
-        delete [] escapedName;
+}
 
-        QString destPath = currentPath + QDir::separator() + nodeName;
-        QDir dir(destPath);
-        if (!dir.exists())
+// Walk the tree level by level. The files of a level are queued in the SDK while
+// the local folders of the next level are created, so shallow files get the highest priority
+void DownloadPlanner::downloadFolder(MegaNode *folder, QString path, DownloadJob &job)
+{
+    QList<LocalFolder> level;
+    level.append(LocalFolder(path, folder->getHandle(), job.folderPermissions));
+    level[0].created = true;
+
+    while (!level.isEmpty())
+    {
+        QList<LocalFolder> nextLevel;
+        for (int i = 0; i < level.size(); i++)
         {
-#ifndef WIN32
-            if (!megaApi->createLocalFolder(dir.toNativeSeparators(destPath).toUtf8().constData()))
-#else
-            if (!dir.mkpath(QString::fromAscii(".")))
-#endif
+            if (job.generation != getGeneration())
             {
                 return;
             }
-        }
 
-        if (!parent->isForeign())
-        {
-            MegaNodeList *nList = megaApi->getChildren(parent);
-            for (int i = 0; i < nList->size(); i++)
+            const LocalFolder &current = level.at(i);
+            if (!current.created)
             {
-                MegaNode *child = nList->get(i);
-                download(child, destPath);
+                continue;
             }
-            delete nList;
-        }
-        else
-        {
-            pathMap[parent->getHandle()] = destPath;
+
+            MegaNode *node = megaApi->getNodeByHandle(current.handle);
+            if (!node)
+            {
+                continue;
+            }
+
+            MegaNodeList *children = megaApi->getChildren(node);
+            delete node;
+            for (int j = 0; j < children->size(); j++)
+            {
+                MegaNode *child = children->get(j);
+                if (child->getType() == MegaNode::TYPE_FILE)
+                {
+                    startDownload(child, current.path);
+                }
+                else
+                {
+                    char *escapedName = megaApi->escapeFsIncompatible(child->getName());
+                    nextLevel.append(LocalFolder(current.path + QDir::separator() + QString::fromUtf8(escapedName),
+                                                 child->getHandle(), job.folderPermissions));
+                    delete [] escapedName;
+                }
+            }
+            delete children;
         }
+
+        QtConcurrent::blockingMap(nextLevel, createLocalFolder);
+        numFolders += nextLevel.size();
+        reportProgress();
+        level = nextLevel;
+    }
+}
+
+void DownloadPlanner::startDownload(MegaNode *node, QString path)
+{
+    if ((node->isPublic() || node->isForeign()) && megaApiGuest)
+    {
+        megaApiGuest->startDownload(node, (path + QDir::separator()).toUtf8().constData());
     }
+    else
+    {
+        megaApi->startDownload(node, (path + QDir::separator()).toUtf8().constData());
+    }
+
+    numFiles++;
+    reportProgress();
+}
+
+void DownloadPlanner::reportProgress()
+{
+    if ((numFolders + numFiles - lastReport) >= PROGRESS_INTERVAL)
+    {
+        lastReport = numFolders + numFiles;
+        emit progress(numFolders, numFiles, false);
+    }
+}
+
+MegaDownloader::MegaDownloader(MegaApi *megaApi, MegaApi *megaApiGuest) : QObject()
+{
+    plannerThread = new QThread();
+    planner = new DownloadPlanner(megaApi, megaApiGuest);
+    planner->moveToThread(plannerThread);
+    connect(plannerThread, SIGNAL(finished()), planner, SLOT(deleteLater()));
+    connect(planner, SIGNAL(progress(int, int, bool)), this, SIGNAL(progress(int, int, bool)));
+    plannerThread->start();
+}
+
+MegaDownloader::~MegaDownloader()
+{
+    planner->cancel();
+    plannerThread->quit();
+    plannerThread->wait();
+    delete plannerThread;
+}
+
+void MegaDownloader::download(MegaNode *parent, QString path)
+{
+    QQueue<MegaNode *> downloadQueue;
+    downloadQueue.append(parent->copy());
+    processDownloadQueue(&downloadQueue, path);
+}
+
+void MegaDownloader::processDownloadQueue(QQueue<MegaNode *> *downloadQueue, QString path)
+{
+    QDir dir(path);
+    if (!dir.exists() && !dir.mkpath(QString::fromAscii(".")))
+    {
+        qDeleteAll(*downloadQueue);
+        downloadQueue->clear();
+        return;
+    }
+
+    planner->addJob(downloadQueue, path, Preferences::instance()->folderPermissionsValue());
+    QMetaObject::invokeMethod(planner, "processJobs", Qt::QueuedConnection);
+}
+
+void MegaDownloader::cancel()
+{
+    planner->cancel();
 }
@@ -7,8 +7,72 @@
 #include <QDir>
 #include <QQueue>
 #include <QMap>
+#include <QMutex>
+#include <QThread>
+#include <QAtomicInt>
 #include "megaapi.h"
 
+class DownloadJob
+{
+public:
+    QQueue<mega::MegaNode *> nodes;
+    QString path;
+    int folderPermissions;
+    int generation;
+};
+
+class LocalFolder
+{
+public:
+    LocalFolder() : handle(mega::INVALID_HANDLE), permissions(0), created(false) {}
+    LocalFolder(QString path, mega::MegaHandle handle, int permissions)
+        : path(path), handle(handle), permissions(permissions), created(false) {}
+    QString path;
+    mega::MegaHandle handle;
+    int permissions;
+    bool created;
+};
+
+// Walks remote folders and starts their downloads from a background thread
+class DownloadPlanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int PROGRESS_INTERVAL;
+
+    DownloadPlanner(mega::MegaApi *megaApi, mega::MegaApi *megaApiGuest);
+    virtual ~DownloadPlanner();
+
+    // Thread-safe. Takes the ownership of the nodes
+    void addJob(QQueue<mega::MegaNode *> *nodes, QString path, int folderPermissions);
+
+    // Thread-safe. Drops every download requested before the call (downloads already started are not affected)
+    void cancel();
+    int getGeneration();
+
+public slots:
+    void processJobs();
+
+signals:
+    void progress(int folders, int files, bool finished);
+
+protected:
+    void processJob(DownloadJob &job);
+    void downloadFolder(mega::MegaNode *folder, QString path, DownloadJob &job);
+    void startDownload(mega::MegaNode *node, QString path);
+    void reportProgress();
+
+    mega::MegaApi *megaApi;
+    mega::MegaApi *megaApiGuest;
+    QMutex mutex;
+    QQueue<DownloadJob> jobs;
+    QAtomicInt generation;
+    int numFolders;
+    int numFiles;
+    int lastReport;
+};
+
 class MegaDownloader : public QObject
 {
     Q_OBJECT
@@ -20,13 +84,14 @@ public:
     virtual ~MegaDownloader();
     void processDownloadQueue(QQueue<mega::MegaNode *> *downloadQueue, QString path);
     void download(mega::MegaNode *parent, QString path);
+    void cancel();
 
-protected:
-    void download(mega::MegaNode *parent, QFileInfo info);
+signals:
+    void progress(int folders, int files, bool finished);
 
-    mega::MegaApi *megaApi;
-    mega::MegaApi *megaApiGuest;
-    QMap<mega::MegaHandle, QString> pathMap;
+protected:
+    QThread *plannerThread;
+    DownloadPlanner *planner;
 };
 
 #endif // MEGADOWNLOADER_H
@@ -8,20 +8,384 @@
 #include <QString>
 #include <QDesktopServices>
 #include <QDir>
+#include <QtCore>
+
+#if QT_VERSION >= 0x050000
+#include <QtConcurrent/QtConcurrent>
+#endif
+
+#include <string.h>
 
 #define MEGA_LOGGER QString::fromUtf8("MEGA_LOGGER")
 #define ENABLE_MEGASYNC_LOGS QString::fromUtf8("MEGA_ENABLE_LOGS")
 #define MAX_MESSAGE_SIZE 4096
 
+// Binary transport to MEGALogger: the stream starts with LOG_PROTOCOL_MAGIC, then one frame per message:
+// [payload length: 4 bytes, big endian][log level: 1 byte][timestamp length: 1 byte][timestamp][UTF-8 message]
+#define LOG_PROTOCOL_MAGIC "MEGALOG1"
+#define MAX_PENDING_LOG_SIZE 4194304
+#define LOG_FLUSH_RETRY_MS 100
+
 using namespace mega;
 using namespace std;
 
+const int LogWriter::WRITE_INTERVAL_MS = 50;
+const qint64 LogWriter::MAX_FILE_SIZE = 20 * 1024 * 1024;
+const int LogWriter::MAX_ROTATED_FILES = 5;
+
+static inline int atomicLoad(QAtomicInt &value)
+{
+#if QT_VERSION >= 0x050000
+    return value.loadAcquire();
+#else
+    return value.fetchAndAddAcquire(0);
+#endif
+}
+
+static inline void atomicStore(QAtomicInt &value, int newValue)
+{
+#if QT_VERSION >= 0x050000
+    value.storeRelease(newValue);
+#else
+    value.fetchAndStoreRelease(newValue);
+#endif
+}
+
+static const char *logLevelLabel(int loglevel)
+{
+    switch(loglevel)
+    {
+        case MegaApi::LOG_LEVEL_DEBUG:
+            return " (debug): ";
+        case MegaApi::LOG_LEVEL_ERROR:
+            return " (error): ";
+        case MegaApi::LOG_LEVEL_FATAL:
+            return " (fatal): ";
+        case MegaApi::LOG_LEVEL_INFO:
+            return " (info):  ";
+        case MegaApi::LOG_LEVEL_MAX:
+            return " (verb):  ";
+        case MegaApi::LOG_LEVEL_WARNING:
+            return " (warn):  ";
+        default:
+            return "";
+    }
+}
+
+// Append text to a log line, keeping room for the end of line
+static inline int appendToLine(char *line, int size, int capacity, const char *text)
+{
+    if (!text)
+    {
+        return size;
+    }
+
+    int length = strlen(text);
+    if (length > capacity - 1 - size)
+    {
+        length = capacity - 1 - size;
+    }
+    memcpy(line + size, text, length);
+    return size + length;
+}
+
+static QString rotatedLogPath(QString path, int index, bool compressed)
+{
+    return path + QString::fromUtf8(".%1").arg(index) + (compressed ? QString::fromUtf8(".gz") : QString());
+}
+
+// Replace a rotated log file by a gzip file (qCompress provides the deflate stream)
+static void compressLogFile(QString path)
+{
+    static quint32 crcTable[256];
+    static bool crcTableReady = false;
+    if (!crcTableReady)
+    {
+        for (quint32 i = 0; i < 256; i++)
+        {
+            quint32 c = i;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            }
+            crcTable[i] = c;
+        }
+        crcTableReady = true;
+    }
+
+    QFile input(path);
+    if (!input.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+    QByteArray data = input.readAll();
+    input.close();
+
+    // 4 bytes with the uncompressed size, 2 bytes of zlib header, deflate data, 4 bytes of Adler-32
+    QByteArray compressed = qCompress(data, 6);
+    if (compressed.size() < 10)
+    {
+        return;
+    }
+
+    quint32 crc = 0xFFFFFFFF;
+    const unsigned char *bytes = (const unsigned char *)data.constData();
+    for (int i = 0; i < data.size(); i++)
+    {
+        crc = crcTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    crc ^= 0xFFFFFFFF;
+
+    quint32 size = data.size();
+    const char header[10] = {'\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff'};
+    char trailer[8];
+    for (int i = 0; i < 4; i++)
+    {
+        trailer[i] = (crc >> (8 * i)) & 0xFF;
+        trailer[i + 4] = (size >> (8 * i)) & 0xFF;
+    }
+
+    QFile output(path + QString::fromUtf8(".gz"));
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return;
+    }
+
+    bool ok = output.write(header, sizeof(header)) == sizeof(header)
+            && output.write(compressed.constData() + 6, compressed.size() - 10) == compressed.size() - 10
+            && output.write(trailer, sizeof(trailer)) == sizeof(trailer);
+    output.close();
+    if (ok)
+    {
+        QFile::remove(path);
+    }
+    else
+    {
+        output.remove();
+    }
+}
+
+LogWriter::LogWriter(QString filePath) : QThread()
+{
+    this->filePath = filePath;
+    dequeuePosition = 0;
+    cells = new Cell[NUM_CELLS];
+    for (int i = 0; i < NUM_CELLS; i++)
+    {
+        atomicStore(cells[i].sequence, i);
+        cells[i].size = 0;
+    }
+    atomicStore(enabled, 1);
+    atomicStore(compression, 1);
+}
+
+LogWriter::~LogWriter()
+{
+    delete [] cells;
+}
+
+bool LogWriter::push(const char *time, int loglevel, const char *source, const char *message)
+{
+    // reserve a cell
+    Cell *cell;
+    int position = atomicLoad(enqueuePosition);
+    while (true)
+    {
+        cell = &cells[position & (NUM_CELLS - 1)];
+        int difference = (int)((unsigned int)atomicLoad(cell->sequence) - (unsigned int)position);
+        if (!difference)
+        {
+            if (enqueuePosition.testAndSetRelaxed(position, position + 1))
+            {
+                break;
+            }
+            position = atomicLoad(enqueuePosition);
+        }
+        else if (difference < 0)
+        {
+            // full
+            dropped.fetchAndAddRelaxed(1);
+            return false;
+        }
+        else
+        {
+            position = atomicLoad(enqueuePosition);
+        }
+    }
+
+    const char *fileName = source;
+    for (const char *c = source; c && *c; c++)
+    {
+        if (*c == '/' || *c == '\\')
+        {
+            fileName = c + 1;
+        }
+    }
+
+    int size = appendToLine(cell->data, 0, CELL_SIZE, time);
+    size = appendToLine(cell->data, size, CELL_SIZE, logLevelLabel(loglevel));
+    size = appendToLine(cell->data, size, CELL_SIZE, message);
+    if (fileName && *fileName)
+    {
+        size = appendToLine(cell->data, size, CELL_SIZE, " (");
+        size = appendToLine(cell->data, size, CELL_SIZE, fileName);
+        size = appendToLine(cell->data, size, CELL_SIZE, ")");
+    }
+    cell->data[size++] = '\n';
+    cell->size = size;
+
+    // publish it
+    atomicStore(cell->sequence, position + 1);
+    return true;
+}
+
+bool LogWriter::pop(QByteArray *batch)
+{
+    Cell *cell = &cells[dequeuePosition & (NUM_CELLS - 1)];
+    if (atomicLoad(cell->sequence) != dequeuePosition + 1)
+    {
+        return false;
+    }
+
+    batch->append(cell->data, cell->size);
+    atomicStore(cell->sequence, dequeuePosition + NUM_CELLS);
+    dequeuePosition++;
+    return true;
+}
+
+void LogWriter::setEnabled(bool enable)
+{
+    atomicStore(enabled, enable);
+}
+
+void LogWriter::setCompression(bool enable)
+{
+    atomicStore(compression, enable);
+}
+
+void LogWriter::stop()
+{
+    atomicStore(stopped, 1);
+}
+
+void LogWriter::run()
+{
+    QByteArray batch;
+    batch.reserve(NUM_CELLS * 64);
+    while (true)
+    {
+        bool stopping = atomicLoad(stopped);
+        while (pop(&batch));
+
+        int lost = dropped.fetchAndStoreRelaxed(0);
+        if (lost)
+        {
+            batch.append(QString::fromUtf8("[%1 log lines dropped]\n").arg(lost).toUtf8());
+        }
+
+        if (batch.size())
+        {
+            write(batch);
+            batch.clear();
+            continue;
+        }
+
+        if (file.isOpen() && !atomicLoad(enabled))
+        {
+            // release the file while logging is disabled
+            file.close();
+        }
+
+        if (stopping)
+        {
+            break;
+        }
+        msleep(WRITE_INTERVAL_MS);
+    }
+    file.close();
+    compressionTask.waitForFinished();
+}
+
+void LogWriter::write(const QByteArray &batch)
+{
+    if (!file.isOpen())
+    {
+        file.setFileName(filePath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        {
+            return;
+        }
+    }
+
+    if (file.size() && (file.size() + batch.size()) > MAX_FILE_SIZE)
+    {
+        rotate();
+        if (!file.isOpen())
+        {
+            return;
+        }
+    }
+
+    file.write(batch);
+    file.flush();
+}
+
+void LogWriter::rotate()
+{
+    file.close();
+
+    // the rotated files can't be renamed while the previous one is being compressed
+    compressionTask.waitForFinished();
+
+    QFile::remove(rotatedLogPath(filePath, MAX_ROTATED_FILES, false));
+    QFile::remove(rotatedLogPath(filePath, MAX_ROTATED_FILES, true));
+    for (int i = MAX_ROTATED_FILES - 1; i > 0; i--)
+    {
+        QFile::rename(rotatedLogPath(filePath, i, false), rotatedLogPath(filePath, i + 1, false));
+        QFile::rename(rotatedLogPath(filePath, i, true), rotatedLogPath(filePath, i + 1, true));
+    }
+
+    QString rotatedPath = rotatedLogPath(filePath, 1, false);
+    if (QFile::rename(filePath, rotatedPath) && atomicLoad(compression))
+    {
+        // compressed in the thread pool so that the writer doesn't stop draining the buffer
+        compressionTask = QtConcurrent::run(compressLogFile, rotatedPath);
+    }
+
+    file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+}
+
+static QByteArray logFrame(const char *time, int loglevel, const QByteArray &message)
+{
+    int timeLength = time ? strlen(time) : 0;
+    if (timeLength > 255)
+    {
+        timeLength = 255;
+    }
+
+    quint32 length = 2 + timeLength + message.size();
+    QByteArray frame;
+    frame.reserve(4 + length);
+    frame.append((char)((length >> 24) & 0xFF));
+    frame.append((char)((length >> 16) & 0xFF));
+    frame.append((char)((length >> 8) & 0xFF));
+    frame.append((char)(length & 0xFF));
+    frame.append((char)loglevel);
+    frame.append((char)timeLength);
+    frame.append(time, timeLength);
+    frame.append(message);
+    return frame;
+}
+
 MegaSyncLogger::MegaSyncLogger(QObject *parent) : QObject(parent), MegaLogger()
 {
-    xmlWriter = NULL;
     connected = true;
+    headerSent = false;
+    flushScheduled = false;
+    droppedMessages = 0;
     logToStdout = false;
     logToFile = false;
+    logWriter = NULL;
     client = NULL;
     megaServer = NULL;
 
@@ -31,8 +395,6 @@ MegaSyncLogger::MegaSyncLogger(QObject *parent) : QObject(parent), MegaLogger()
     megaServer = new QLocalServer(this);
 
     connect(megaServer,SIGNAL(newConnection()),this,SLOT(clientConnected()));
-    connect(this, SIGNAL(sendLog(QString,int,QString)),
-            this, SLOT(onLogAvailable(QString,int,QString)), Qt::QueuedConnection);
     connect(client, SIGNAL(disconnected()), this, SLOT(disconnected()));
     connect(client, SIGNAL(error(QLocalSocket::LocalSocketError)), SLOT(disconnected()));
 
@@ -49,6 +411,13 @@ MegaSyncLogger::~MegaSyncLogger()
     {
         delete megaServer;
     }
+
+    if (logWriter)
+    {
+        logWriter->stop();
+        logWriter->wait();
+        delete logWriter;
+    }
 }
 
 void MegaSyncLogger::log(const char *time, int loglevel, const char *source, const char *message)
@@ -56,10 +425,10 @@ void MegaSyncLogger::log(const char *time, int loglevel, const char *source, con
 #ifdef LOG_TO_LOGGER
     if (connected)
     {
-        QString m = QString::fromUtf8(message);
+        QByteArray m(message);
         if (m.size() > MAX_MESSAGE_SIZE)
         {
-            m = m.left(MAX_MESSAGE_SIZE - 3).append(QString::fromUtf8("..."));
+            m = m.left(MAX_MESSAGE_SIZE - 3).append("...");
         }
 
 #ifdef DEBUG
@@ -68,85 +437,52 @@ void MegaSyncLogger::log(const char *time, int loglevel, const char *source, con
         fileName = info.fileName();
         if (fileName.size())
         {
-            m.append(QString::fromUtf8(" (%1)").arg(fileName));
+            m.append(QString::fromUtf8(" (%1)").arg(fileName).toUtf8());
         }
 #endif
 
-        emit sendLog(QString::fromUtf8(time), loglevel, m);
+        // Frames are sent in batches from the main thread.
+        // If MEGALogger doesn't keep up, messages are dropped instead of growing the buffer
+        QByteArray frame = logFrame(time, loglevel, m);
+        bool schedule = false;
+        pendingMutex.lock();
+        if ((pendingFrames.size() + frame.size()) > MAX_PENDING_LOG_SIZE)
+        {
+            droppedMessages++;
+        }
+        else
+        {
+            pendingFrames.append(frame);
+            schedule = !flushScheduled;
+            flushScheduled = true;
+        }
+        pendingMutex.unlock();
+
+        if (schedule)
+        {
+            QMetaObject::invokeMethod(this, "flushLogs", Qt::QueuedConnection);
+        }
     }
 #endif
 
-    if (logToFile || logToStdout)
+    if (logToFile && logWriter)
+    {
+        logWriter->push(time, loglevel, source, message);
+    }
+
+    if (logToStdout)
     {
         QString fileName;
         QFileInfo info(QString::fromUtf8(source));
         fileName = info.fileName();
 
         ostringstream oss;
-        oss << time;
-        switch(loglevel)
-        {
-            case MegaApi::LOG_LEVEL_DEBUG:
-                oss << " (debug): ";
-                break;
-            case MegaApi::LOG_LEVEL_ERROR:
-                oss << " (error): ";
-                break;
-            case MegaApi::LOG_LEVEL_FATAL:
-                oss << " (fatal): ";
-                break;
-            case MegaApi::LOG_LEVEL_INFO:
-                oss << " (info):  ";
-                break;
-            case MegaApi::LOG_LEVEL_MAX:
-                oss << " (verb):  ";
-                break;
-            case MegaApi::LOG_LEVEL_WARNING:
-                oss << " (warn):  ";
-                break;
-        }
-
-        oss << message;
+        oss << time << logLevelLabel(loglevel) << message;
         if (fileName.size())
         {
             oss << " ("<< fileName.toUtf8().constData() << ")";
         }
-
-        if (logToStdout)
-        {
-            cout << oss.str() << endl;
-        }
-
-        if (logToFile)
-        {
-            static QString filePath;
-            if (filePath.isEmpty())
-            {
-                QString dataPath;
-#if QT_VERSION < 0x050000
-                dataPath = QDesktopServices::storageLocation(QDesktopServices::DesktopLocation);
-#else
-                QStringList desktopPaths = QStandardPaths::standardLocations(QStandardPaths::DesktopLocation);
-                if (desktopPaths.size())
-                {
-                    dataPath = desktopPaths.at(0);
-                }
-                else
-                {
-                    dataPath = Utilities::getDefaultBasePath();
-                }
-#endif
-                filePath = dataPath + QDir::separator() + QString::fromAscii("MEGAsync.log");
-            }
-
-            QFile file(filePath);
-            if (file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
-            {
-                QTextStream out(&file);
-                out.setCodec("UTF-8");
-                out << QString::fromUtf8(oss.str().c_str()) << endl;
-            }
-        }
+        cout << oss.str() << endl;
     }
 }
 
@@ -157,6 +493,31 @@ void MegaSyncLogger::sendLogsToStdout(bool enable)
 
 void MegaSyncLogger::sendLogsToFile(bool enable)
 {
+    if (enable && !logWriter)
+    {
+        QString dataPath;
+#if QT_VERSION < 0x050000
+        dataPath = QDesktopServices::storageLocation(QDesktopServices::DesktopLocation);
+#else
+        QStringList desktopPaths = QStandardPaths::standardLocations(QStandardPaths::DesktopLocation);
+        if (desktopPaths.size())
+        {
+            dataPath = desktopPaths.at(0);
+        }
+        else
+        {
+            dataPath = Utilities::getDefaultBasePath();
+        }
+#endif
+        // the writer lives until the logger is destroyed, other threads could be using it
+        logWriter = new LogWriter(dataPath + QDir::separator() + QString::fromAscii("MEGAsync.log"));
+        logWriter->start();
+    }
+
+    if (logWriter)
+    {
+        logWriter->setEnabled(enable);
+    }
     this->logToFile = enable;
 }
 
@@ -170,67 +531,43 @@ bool MegaSyncLogger::isLogToFileEnabled()
     return logToFile;
 }
 
-void MegaSyncLogger::onLogAvailable(QString time, int loglevel, QString message)
+void MegaSyncLogger::flushLogs()
 {
-    if (!connected)
+    pendingMutex.lock();
+    if (connected && client && client->bytesToWrite() > MAX_PENDING_LOG_SIZE)
     {
+        // the previous batches weren't consumed yet
+        pendingMutex.unlock();
+        QTimer::singleShot(LOG_FLUSH_RETRY_MS, this, SLOT(flushLogs()));
         return;
     }
 
-    if (!xmlWriter)
-    {
-        xmlWriter = new QXmlStreamWriter(client);
-        xmlWriter->writeStartDocument();
-        xmlWriter->writeStartElement(QString::fromUtf8("MEGA"));
+    QByteArray frames = pendingFrames;
+    int dropped = droppedMessages;
+    pendingFrames = QByteArray();
+    droppedMessages = 0;
+    flushScheduled = false;
+    pendingMutex.unlock();
 
-        xmlWriter->writeStartElement(QString::fromUtf8("log"));
-        xmlWriter->writeAttribute(QString::fromUtf8("timestamp"), time);
-        xmlWriter->writeAttribute(QString::fromUtf8("type"), QString::fromUtf8("info"));
-        xmlWriter->writeAttribute(QString::fromUtf8("content"), QString::fromUtf8("LOG START"));
-        xmlWriter->writeEndElement();
+    if (!connected || !client)
+    {
+        return;
     }
 
-    if (xmlWriter->hasError())
+    if (!headerSent)
     {
-        connected = false;
-        delete xmlWriter;
-        xmlWriter = NULL;
-        client->deleteLater();
-        client = NULL;
-        return;
+        client->write(LOG_PROTOCOL_MAGIC);
+        headerSent = true;
     }
 
-    QString level;
-    switch(loglevel)
+    if (dropped)
     {
-        case MegaApi::LOG_LEVEL_DEBUG:
-            level = QString::fromUtf8("debug");
-            break;
-        case MegaApi::LOG_LEVEL_ERROR:
-            level = QString::fromUtf8("error");
-            break;
-        case MegaApi::LOG_LEVEL_FATAL:
-            level = QString::fromUtf8("fatal");
-            break;
-        case MegaApi::LOG_LEVEL_INFO:
-            level = QString::fromUtf8("info");
-            break;
-        case MegaApi::LOG_LEVEL_MAX:
-            level = QString::fromUtf8("verbose");
-            break;
-        case MegaApi::LOG_LEVEL_WARNING:
-            level = QString::fromUtf8("warning");
-            break;
-        default:
-            level = QString::fromUtf8("unknown");
-            break;
+        frames.append(logFrame(QDateTime::currentDateTimeUtc().toString(QString::fromUtf8("MM/dd-hh:mm:ss")).toUtf8().constData(),
+                               MegaApi::LOG_LEVEL_WARNING,
+                               QString::fromUtf8("%1 log messages dropped").arg(dropped).toUtf8()));
     }
 
-    xmlWriter->writeStartElement(QString::fromUtf8("log"));
-    xmlWriter->writeAttribute(QString::fromUtf8("timestamp"), time);
-    xmlWriter->writeAttribute(QString::fromUtf8("type"),level);
-    xmlWriter->writeAttribute(QString::fromUtf8("content"), message);
-    xmlWriter->writeEndElement();
+    client->write(frames);
     client->flush();
 }
 
@@ -255,11 +592,11 @@ void MegaSyncLogger::clientConnected()
 void MegaSyncLogger::disconnected()
 {
     connected = false;
-    if (xmlWriter)
-    {
-        delete xmlWriter;
-        xmlWriter = NULL;
-    }
+    headerSent = false;
+    pendingMutex.lock();
+    pendingFrames = QByteArray();
+    droppedMessages = 0;
+    pendingMutex.unlock();
 
     if (client)
     {
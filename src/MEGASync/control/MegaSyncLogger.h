@@ -3,10 +3,62 @@
 
 #include <QLocalSocket>
 #include <QLocalServer>
-#include <QXmlStreamWriter>
+#include <QMutex>
+#include <QThread>
+#include <QAtomicInt>
+#include <QFile>
+#include <QFuture>
 
 #include "megaapi.h"
 
+// Writes log lines to a file from a dedicated thread.
+// Lines are passed through a lock-free ring buffer with multiple producers and one consumer,
+// so logging only costs the caller a copy of the line.
+class LogWriter : public QThread
+{
+public:
+    static const int NUM_CELLS = 1024;  // must be a power of two
+    static const int CELL_SIZE = 2048;  // longer lines are truncated
+    static const int WRITE_INTERVAL_MS;
+    static const qint64 MAX_FILE_SIZE;
+    static const int MAX_ROTATED_FILES;
+
+    LogWriter(QString filePath);
+    ~LogWriter();
+
+    // Callable from any thread, never blocks. Returns false (and counts the line as dropped) if the buffer is full
+    bool push(const char *time, int loglevel, const char *source, const char *message);
+
+    void setEnabled(bool enable);
+    void setCompression(bool enable);
+    void stop();
+
+protected:
+    class Cell
+    {
+    public:
+        QAtomicInt sequence;
+        int size;
+        char data[CELL_SIZE];
+    };
+
+    void run();
+    bool pop(QByteArray *batch);
+    void write(const QByteArray &batch);
+    void rotate();
+
+    QString filePath;
+    QFile file;
+    Cell *cells;
+    QAtomicInt enqueuePosition;
+    int dequeuePosition;
+    QAtomicInt dropped;
+    QAtomicInt enabled;
+    QAtomicInt compression;
+    QAtomicInt stopped;
+    QFuture<void> compressionTask;  ///< Compression of the last rotated file
+};
+
 class MegaSyncLogger : public QObject, public mega::MegaLogger
 {
     Q_OBJECT
@@ -20,21 +72,23 @@ public:
     bool isLogToStdoutEnabled();
     bool isLogToFileEnabled();
 
-signals:
-    void sendLog(QString time, int loglevel, QString message);
-
 public slots:
-    void onLogAvailable(QString time, int loglevel, QString message);
+    void flushLogs();
     void clientConnected();
     void disconnected();
 
 protected:
     QLocalSocket* client;
     QLocalServer* megaServer;
-    QXmlStreamWriter *xmlWriter;
     bool connected;
+    bool headerSent;
+    QMutex pendingMutex;
+    QByteArray pendingFrames;
+    int droppedMessages;
+    bool flushScheduled;
     bool logToStdout;
     bool logToFile;
+    LogWriter *logWriter;
 };
 
 #endif // MEGASYNCLOGGER_H
@@ -13,27 +13,90 @@
 using namespace mega;
 using namespace std;
 
-MegaUploader::MegaUploader(MegaApi *megaApi) : QObject()
+const int UploadScanner::MAX_FOLDER_REQUESTS = 64;
+const int UploadScanner::PROGRESS_INTERVAL = 1000;
+
+UploadScanner::UploadScanner(MegaApi *megaApi) : QObject()
 {
     this->megaApi = megaApi;
-    delegateListener = new QTMegaRequestListener(megaApi, this);
+    delegateListener = NULL;
+    stateGeneration = 0;
+    numFolders = 0;
+    numFiles = 0;
+    numUploads = 0;
+    lastReport = 0;
 }
 
-MegaUploader::~MegaUploader()
+UploadScanner::~UploadScanner()
 {
     delete delegateListener;
 }
 
-void MegaUploader::upload(QString path, MegaNode *parent)
+void UploadScanner::start()
+{
+    // Created here so that request callbacks are delivered to the scanner thread
+    delegateListener = new QTMegaRequestListener(megaApi, this);
+}
+
+void UploadScanner::cancel()
+{
+    generation.fetchAndAddOrdered(1);
+}
+
+int UploadScanner::getGeneration()
+{
+    return generation.fetchAndAddOrdered(0);
+}
+
+bool UploadScanner::isCancelled()
+{
+    return getGeneration() != stateGeneration;
+}
+
+// Forget the pending folders if the uploads were cancelled
+void UploadScanner::checkGeneration()
+{
+    int currentGeneration = getGeneration();
+    if (currentGeneration != stateGeneration)
+    {
+        if (folders.size())
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_INFO, "Pending folder uploads cancelled");
+        }
+
+        folders.clear();
+        readyFolders.clear();
+        requestedFolders.clear();
+        numFolders = numFiles = numUploads = lastReport = 0;
+        stateGeneration = currentGeneration;
+    }
+}
+
+void UploadScanner::scan(QString path, qlonglong parentHandle, int generation)
 {
-    return upload(QFileInfo(path), parent);
+    checkGeneration();
+    if (generation != stateGeneration)
+    {
+        // requested before a cancellation
+        return;
+    }
+
+    MegaNode *parent = megaApi->getNodeByHandle(parentHandle);
+    if (!parent)
+    {
+        return;
+    }
+
+    upload(QFileInfo(path), parent);
+    delete parent;
+
+    createFolders();
+    checkFinished();
 }
 
-void MegaUploader::upload(QFileInfo info, MegaNode *parent)
+void UploadScanner::upload(QFileInfo info, MegaNode *parent)
 {
-    QPointer<MegaUploader> safePointer = this;
-    QApplication::processEvents();
-    if (!safePointer)
+    if (isCancelled())
     {
         return;
     }
@@ -90,41 +153,195 @@ void MegaUploader::upload(QFileInfo info, MegaNode *parent)
     else if (info.isFile())
     {
         megaApi->startUpload(currentPath.toUtf8().constData(), parent);
+        numUploads++;
     }
     else if (info.isDir())
     {
-        folders.enqueue(info);
-        megaApi->createFolder(utf8name.constData(), parent, delegateListener);
+        scanFolder(info, fileName, parent->getHandle());
     }
 }
 
-void MegaUploader::onRequestFinish(MegaApi *, MegaRequest *request, MegaError *e)
+// List the whole local tree once, breadth first
+void UploadScanner::scanFolder(QFileInfo info, QString name, MegaHandle parentHandle)
 {
-    switch(request->getType())
+    int root = folders.size();
+    UploadFolder rootFolder;
+    rootFolder.name = name;
+    rootFolder.path = info.absoluteFilePath();
+    rootFolder.parentHandle = parentHandle;
+    folders.append(rootFolder);
+    numFolders++;
+
+    for (int i = root; i < folders.size(); i++)
     {
-        case MegaRequest::TYPE_CREATE_FOLDER:
-            if (e->getErrorCode() == MegaError::API_OK)
+        if (isCancelled())
+        {
+            return;
+        }
+
+        QDir dir(folders.at(i).path);
+        QFileInfoList entries = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot);
+        for (int j = 0; j < entries.size(); j++)
+        {
+            const QFileInfo &entry = entries.at(j);
+            if (entry.isFile())
+            {
+                folders[i].files.append(QDir::toNativeSeparators(entry.absoluteFilePath()));
+                numFiles++;
+            }
+            else if (entry.isDir())
             {
-                MegaNode *parent = megaApi->getNodeByHandle(request->getNodeHandle());
-                QDir dir(folders.dequeue().absoluteFilePath());
-                QFileInfoList entries = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot);
-                for (int i = 0; i < entries.size(); i++)
-                {
-                    QFileInfo info = entries[i];
-                    if (info.isFile())
-                    {
-                        megaApi->startUpload(QDir::toNativeSeparators(info.absoluteFilePath()).toUtf8().constData(), parent);
-                    }
-                    else if (info.isDir())
-                    {
-                        folders.enqueue(info);
-                        megaApi->createFolder(info.fileName().toUtf8().constData(),
-                                              parent,
-                                              delegateListener);
-                    }
-                }
-                delete parent;
+                UploadFolder folder;
+                folder.name = entry.fileName();
+                folder.path = entry.absoluteFilePath();
+                folders[i].subfolders.append(folders.size());
+                folders.append(folder);
+                numFolders++;
             }
-            break;
+        }
+        reportProgress();
+    }
+
+    readyFolders.enqueue(root);
+    createFolders();
+}
+
+// Create the folders whose parent already exists, keeping up to MAX_FOLDER_REQUESTS in flight
+void UploadScanner::createFolders()
+{
+    while (requestedFolders.size() < MAX_FOLDER_REQUESTS && !readyFolders.isEmpty())
+    {
+        int index = readyFolders.dequeue();
+        const UploadFolder &folder = folders.at(index);
+        MegaNode *parent = megaApi->getNodeByHandle(folder.parentHandle);
+        if (!parent)
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_WARNING, QString::fromUtf8("Unable to upload folder %1: destination not found")
+                         .arg(folder.path).toUtf8().constData());
+            continue;
+        }
+
+        requestedFolders.insert(qMakePair(folder.parentHandle, folder.name), index);
+        megaApi->createFolder(folder.name.toUtf8().constData(), parent, delegateListener);
+        delete parent;
+    }
+}
+
+void UploadScanner::startUploads(int folder, MegaNode *parent)
+{
+    QStringList files = folders.at(folder).files;
+    folders[folder].files.clear();
+    for (int i = 0; i < files.size(); i++)
+    {
+        if (isCancelled())
+        {
+            return;
+        }
+
+        megaApi->startUpload(files.at(i).toUtf8().constData(), parent);
+        numUploads++;
+        reportProgress();
+    }
+}
+
+void UploadScanner::reportProgress()
+{
+    if ((numFolders + numFiles + numUploads - lastReport) >= PROGRESS_INTERVAL)
+    {
+        lastReport = numFolders + numFiles + numUploads;
+        emit progress(numFolders, numFiles, numUploads, false);
+    }
+}
+
+void UploadScanner::checkFinished()
+{
+    if (folders.isEmpty() || !readyFolders.isEmpty() || !requestedFolders.isEmpty())
+    {
+        return;
+    }
+
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, QString::fromUtf8("Folder upload processed: %1 folders / %2 files")
+                 .arg(numFolders).arg(numFiles).toUtf8().constData());
+    emit progress(numFolders, numFiles, numUploads, true);
+    folders.clear();
+    numFolders = numFiles = numUploads = lastReport = 0;
+}
+
+void UploadScanner::onRequestFinish(MegaApi *, MegaRequest *request, MegaError *e)
+{
+    if (request->getType() != MegaRequest::TYPE_CREATE_FOLDER)
+    {
+        return;
+    }
+
+    checkGeneration();
+    QPair<MegaHandle, QString> key(request->getParentHandle(), QString::fromUtf8(request->getName()));
+    QMultiHash<QPair<MegaHandle, QString>, int>::iterator it = requestedFolders.find(key);
+    if (it == requestedFolders.end())
+    {
+        // cancelled
+        return;
     }
+
+    int index = it.value();
+    requestedFolders.erase(it);
+
+    MegaNode *node = NULL;
+    if (e->getErrorCode() == MegaError::API_OK)
+    {
+        node = megaApi->getNodeByHandle(request->getNodeHandle());
+    }
+
+    if (!node)
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, QString::fromUtf8("Error creating folder %1: %2")
+                     .arg(folders.at(index).path).arg(e->getErrorCode()).toUtf8().constData());
+    }
+    else
+    {
+        QList<int> subfolders = folders.at(index).subfolders;
+        for (int i = 0; i < subfolders.size(); i++)
+        {
+            folders[subfolders.at(i)].parentHandle = node->getHandle();
+            readyFolders.enqueue(subfolders.at(i));
+        }
+
+        // keep the folder requests flowing while the uploads are started
+        createFolders();
+        startUploads(index, node);
+        delete node;
+    }
+
+    createFolders();
+    checkFinished();
+}
+
+MegaUploader::MegaUploader(MegaApi *megaApi) : QObject()
+{
+    scannerThread = new QThread();
+    scanner = new UploadScanner(megaApi);
+    scanner->moveToThread(scannerThread);
+    connect(scannerThread, SIGNAL(started()), scanner, SLOT(start()));
+    connect(scannerThread, SIGNAL(finished()), scanner, SLOT(deleteLater()));
+    connect(this, SIGNAL(scanRequested(QString, qlonglong, int)), scanner, SLOT(scan(QString, qlonglong, int)));
+    connect(scanner, SIGNAL(progress(int, int, int, bool)), this, SIGNAL(progress(int, int, int, bool)));
+    scannerThread->start();
+}
+
+MegaUploader::~MegaUploader()
+{
+    scanner->cancel();
+    scannerThread->quit();
+    scannerThread->wait();
+    delete scannerThread;
+}
+
+void MegaUploader::upload(QString path, MegaNode *parent)
+{
+    emit scanRequested(path, parent->getHandle(), scanner->getGeneration());
+}
+
+void MegaUploader::cancel()
+{
+    scanner->cancel();
 }
@@ -5,26 +5,90 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QQueue>
+#include <QVector>
+#include <QHash>
+#include <QThread>
+#include <QAtomicInt>
 #include "Preferences.h"
 #include "megaapi.h"
 #include "QTMegaRequestListener.h"
 
-class MegaUploader : public QObject, public mega::MegaRequestListener
+class UploadFolder
+{
+public:
+    UploadFolder() : parentHandle(mega::INVALID_HANDLE) {}
+    QString name;
+    QString path;
+    mega::MegaHandle parentHandle;  ///< Set once the parent folder exists in MEGA
+    QStringList files;
+    QList<int> subfolders;
+};
+
+// Scans local folders and uploads them from a background thread
+class UploadScanner : public QObject, public mega::MegaRequestListener
 {
     Q_OBJECT
 
 public:
-    MegaUploader(mega::MegaApi *megaApi);
-    virtual ~MegaUploader();
-    void upload(QString path, mega::MegaNode *parent);
+    static const int MAX_FOLDER_REQUESTS;
+    static const int PROGRESS_INTERVAL;
+
+    UploadScanner(mega::MegaApi *megaApi);
+    virtual ~UploadScanner();
     virtual void onRequestFinish(mega::MegaApi* api, mega::MegaRequest *request, mega::MegaError* e);
 
+    // Thread-safe. Drops every upload requested before the call (uploads already started are not affected)
+    void cancel();
+    int getGeneration();
+
+public slots:
+    void start();
+    void scan(QString path, qlonglong parentHandle, int generation);
+
+signals:
+    void progress(int folders, int files, int uploads, bool finished);
+
 protected:
     void upload(QFileInfo info, mega::MegaNode *parent);
+    void scanFolder(QFileInfo info, QString name, mega::MegaHandle parentHandle);
+    void createFolders();
+    void startUploads(int folder, mega::MegaNode *parent);
+    void reportProgress();
+    bool isCancelled();
+    void checkGeneration();
+    void checkFinished();
 
     mega::MegaApi *megaApi;
     mega::QTMegaRequestListener *delegateListener;
-    QQueue<QFileInfo> folders;
+    QAtomicInt generation;
+    int stateGeneration;    ///< Generation of the pending folders
+
+    QVector<UploadFolder> folders;
+    QQueue<int> readyFolders;
+    QMultiHash<QPair<mega::MegaHandle, QString>, int> requestedFolders;
+    int numFolders;
+    int numFiles;
+    int numUploads;
+    int lastReport;
+};
+
+class MegaUploader : public QObject
+{
+    Q_OBJECT
+
+public:
+    MegaUploader(mega::MegaApi *megaApi);
+    virtual ~MegaUploader();
+    void upload(QString path, mega::MegaNode *parent);
+    void cancel();
+
+signals:
+    void scanRequested(QString path, qlonglong parentHandle, int generation);
+    void progress(int folders, int files, int uploads, bool finished);
+
+protected:
+    QThread *scannerThread;
+    UploadScanner *scanner;
 };
 
 #endif // MEGAUPLOADER_H
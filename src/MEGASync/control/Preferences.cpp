@@ -2,6 +2,7 @@
 #include "platform/Platform.h"
 
 #include <QDesktopServices>
+#include <QThread>
 #include <assert.h>
 
 using namespace mega;
@@ -30,6 +31,8 @@ const QString Preferences::TRANSLATION_FOLDER = QString::fromAscii("://translati
 const QString Preferences::TRANSLATION_PREFIX = QString::fromAscii("MEGASyncStrings_");
 
 const int Preferences::STATE_REFRESH_INTERVAL_MS        = 10000;
+const int Preferences::NETWORK_CHANGE_DELAY_MS          = 100;
+const int Preferences::SETTINGS_SYNC_DELAY_MS           = 2000;
 const int Preferences::FINISHED_TRANSFER_REFRESH_INTERVAL_MS        = 10000;
 
 const long long Preferences::MIN_UPDATE_STATS_INTERVAL  = 300000;
@@ -46,6 +49,7 @@ const unsigned int Preferences::MAX_LOGIN_TIME_MS                   = 40000;
 const unsigned int Preferences::PROXY_TEST_TIMEOUT_MS               = 10000;
 const unsigned int Preferences::MAX_IDLE_TIME_MS                    = 600000;
 const unsigned int Preferences::MAX_COMPLETED_ITEMS                 = 1000;
+const unsigned int Preferences::MAX_COMPLETED_ITEMS_LIMIT           = 100000;
 
 const qint16 Preferences::HTTP_PORT  = 6341;
 const qint16 Preferences::HTTPS_PORT = 6342;
@@ -301,6 +305,7 @@ const QString Preferences::lastUpdateVersionKey     = QString::fromAscii("lastUp
 const QString Preferences::previousCrashesKey       = QString::fromAscii("previousCrashes");
 const QString Preferences::lastRebootKey            = QString::fromAscii("lastReboot");
 const QString Preferences::lastExitKey              = QString::fromAscii("lastExit");
+const QString Preferences::maxCompletedTransfersKey = QString::fromAscii("maxCompletedTransfers");
 const QString Preferences::disableOverlayIconsKey   = QString::fromAscii("disableOverlayIcons");
 const QString Preferences::disableFileVersioningKey = QString::fromAscii("disableFileVersioning");
 const QString Preferences::disableLeftPaneIconsKey  = QString::fromAscii("disableLeftPaneIcons");
@@ -420,6 +425,8 @@ void Preferences::initialize(QString dataPath)
         if (QFile::rename(bakSettingsFile,settingsFile))
         {
             delete settings;
+            // The journal has changes made to the file that was replaced, not to the backup
+            EncryptedSettings::removeJournal(settingsFile);
             settings = new EncryptedSettings(settingsFile);
 
             //Retry with backup file
@@ -449,6 +456,10 @@ Preferences::Preferences() : QObject(), mutex(QMutex::Recursive)
 {
     diffTimeWithSDK = 0;
     clearTemporalBandwidth();
+
+    syncTimer.setSingleShot(true);
+    syncTimer.setInterval(SETTINGS_SYNC_DELAY_MS);
+    connect(&syncTimer, SIGNAL(timeout()), this, SLOT(onSyncTimeout()));
 }
 
 QString Preferences::email()
@@ -465,7 +476,7 @@ void Preferences::setEmail(QString email)
     mutex.lock();
     login(email);
     settings->setValue(emailKey, email);
-    settings->sync();
+    requestSync();
     mutex.unlock();
     emit stateChanged();
 }
@@ -483,7 +494,7 @@ void Preferences::setFirstName(QString firstName)
 {
     mutex.lock();
     settings->setValue(firstNameKey, firstName);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -500,7 +511,7 @@ void Preferences::setLastName(QString lastName)
 {
     mutex.lock();
     settings->setValue(lastNameKey, lastName);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -529,7 +540,7 @@ void Preferences::setSession(QString session)
     settings->setValue(sessionKey, session);
     settings->remove(emailHashKey);
     settings->remove(privatePwKey);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -934,7 +945,7 @@ void Preferences::setShowNotifications(bool value)
     mutex.lock();
     assert(logged());
     settings->setValue(showNotificationsKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -950,7 +961,7 @@ void Preferences::setStartOnStartup(bool value)
 {
     mutex.lock();
     settings->setValue(startOnStartupKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -966,7 +977,7 @@ void Preferences::setUseHttpsOnly(bool value)
 {
     mutex.lock();
     settings->setValue(useHttpsOnlyKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1002,7 +1013,7 @@ void Preferences::setSSLcertificateException(bool value)
     {
         settings->beginGroup(currentAccount);
     }
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1018,7 +1029,7 @@ void Preferences::setTransferDownloadMethod(int value)
 {
     mutex.lock();
     settings->setValue(transferDownloadMethodKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1034,7 +1045,7 @@ void Preferences::setTransferUploadMethod(int value)
 {
     mutex.lock();
     settings->setValue(transferUploadMethodKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1050,7 +1061,7 @@ void Preferences::setLanguage(QString &value)
 {
     mutex.lock();
     settings->setValue(languageKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1066,7 +1077,7 @@ void Preferences::setUpdateAutomatically(bool value)
 {
     mutex.lock();
     settings->setValue(updateAutomaticallyKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1098,7 +1109,7 @@ void Preferences::setHasDefaultUploadFolder(bool value)
 {
     mutex.lock();
     settings->setValue(hasDefaultUploadFolderKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1106,7 +1117,7 @@ void Preferences::setHasDefaultDownloadFolder(bool value)
 {
     mutex.lock();
     settings->setValue(hasDefaultDownloadFolderKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1114,7 +1125,7 @@ void Preferences::setHasDefaultImportFolder(bool value)
 {
     mutex.lock();
     settings->setValue(hasDefaultImportFolderKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1154,7 +1165,7 @@ void Preferences::setUploadLimitKB(int value)
     mutex.lock();
     assert(logged());
     settings->setValue(uploadLimitKBKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1192,7 +1203,7 @@ void Preferences::setParallelUploadConnections(int value)
        value = 3;
     }
     settings->setValue(parallelUploadConnectionsKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1205,7 +1216,7 @@ void Preferences::setParallelDownloadConnections(int value)
        value = 4;
     }
     settings->setValue(parallelDownloadConnectionsKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1214,7 +1225,7 @@ void Preferences::setDownloadLimitKB(int value)
     mutex.lock();
     assert(logged());
     settings->setValue(downloadLimitKBKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1230,7 +1241,7 @@ void Preferences::setUpperSizeLimit(bool value)
 {
     mutex.lock();
     settings->setValue(upperSizeLimitKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1247,7 +1258,7 @@ void Preferences::setUpperSizeLimitValue(long long value)
     mutex.lock();
     assert(logged());
     settings->setValue(upperSizeLimitValueKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1263,7 +1274,7 @@ void Preferences::setCleanerDaysLimit(bool value)
 {
     mutex.lock();
     settings->setValue(cleanerDaysLimitKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1280,7 +1291,7 @@ void Preferences::setCleanerDaysLimitValue(int value)
     mutex.lock();
     assert(logged());
     settings->setValue(cleanerDaysLimitValueKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1297,7 +1308,7 @@ void Preferences::setUpperSizeLimitUnit(int value)
     mutex.lock();
     assert(logged());
     settings->setValue(upperSizeLimitUnitKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1313,7 +1324,7 @@ void Preferences::setLowerSizeLimit(bool value)
 {
     mutex.lock();
     settings->setValue(lowerSizeLimitKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1330,7 +1341,7 @@ void Preferences::setLowerSizeLimitValue(long long value)
     mutex.lock();
     assert(logged());
     settings->setValue(lowerSizeLimitValueKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1347,7 +1358,7 @@ void Preferences::setLowerSizeLimitUnit(int value)
     mutex.lock();
     assert(logged());
     settings->setValue(lowerSizeLimitUnitKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1363,7 +1374,7 @@ void Preferences::setFolderPermissionsValue(int permissions)
 {
     mutex.lock();
     settings->setValue(folderPermissionsKey, permissions);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1379,7 +1390,7 @@ void Preferences::setFilePermissionsValue(int permissions)
 {
     mutex.lock();
     settings->setValue(filePermissionsKey, permissions);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1395,7 +1406,7 @@ void Preferences::setProxyType(int value)
 {
     mutex.lock();
     settings->setValue(proxyTypeKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1411,7 +1422,7 @@ void Preferences::setProxyProtocol(int value)
 {
     mutex.lock();
     settings->setValue(proxyProtocolKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1427,7 +1438,7 @@ void Preferences::setProxyServer(const QString &value)
 {
     mutex.lock();
     settings->setValue(proxyServerKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1443,7 +1454,7 @@ void Preferences::setProxyPort(int value)
 {
     mutex.lock();
     settings->setValue(proxyPortKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1459,7 +1470,7 @@ void Preferences::setProxyRequiresAuth(bool value)
 {
     mutex.lock();
     settings->setValue(proxyRequiresAuthKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1475,7 +1486,7 @@ void Preferences::setProxyUsername(const QString &value)
 {
     mutex.lock();
     settings->setValue(proxyUsernameKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1491,7 +1502,7 @@ void Preferences::setProxyPassword(const QString &value)
 {
     mutex.lock();
     settings->setValue(proxyPasswordKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1533,7 +1544,7 @@ void Preferences::setInstallationTime(long long time)
 {
     mutex.lock();
     settings->setValue(installationTimeKey, time);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 long long Preferences::accountCreationTime()
@@ -1547,7 +1558,7 @@ void Preferences::setAccountCreationTime(long long time)
 {
     mutex.lock();
     settings->setValue(accountCreationTimeKey, time);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 
 }
@@ -1562,7 +1573,7 @@ void Preferences::setHasLoggedIn(long long time)
 {
     mutex.lock();
     settings->setValue(hasLoggedInKey, time);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1578,7 +1589,7 @@ void Preferences::setFirstStartDone(bool value)
 {
     mutex.lock();
     settings->setValue(firstStartDoneKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1594,7 +1605,7 @@ void Preferences::setFirstSyncDone(bool value)
 {
     mutex.lock();
     settings->setValue(firstSyncDoneKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1610,7 +1621,7 @@ void Preferences::setFirstFileSynced(bool value)
 {
     mutex.lock();
     settings->setValue(firstFileSyncedKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1626,7 +1637,7 @@ void Preferences::setFirstWebDownloadDone(bool value)
 {
     mutex.lock();
     settings->setValue(firstWebDownloadKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1642,7 +1653,7 @@ void Preferences::setFatWarningShown(bool value)
 {
     mutex.lock();
     settings->setValue(fatWarningShownKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1658,7 +1669,7 @@ void Preferences::setLastCustomStreamingApp(const QString &value)
 {
     mutex.lock();
     settings->setValue(lastCustomStreamingAppKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1674,7 +1685,7 @@ void Preferences::setMaxMemoryUsage(long long value)
 {
     mutex.lock();
     settings->setValue(maxMemoryUsageKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1690,7 +1701,7 @@ void Preferences::setMaxMemoryReportTime(long long timestamp)
 {
     mutex.lock();
     settings->setValue(maxMemoryReportTimeKey, timestamp);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1698,7 +1709,7 @@ void Preferences::setLastExecutionTime(qint64 time)
 {
     mutex.lock();
     settings->setValue(lastExecutionTimeKey, time);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1716,7 +1727,7 @@ void Preferences::setLastUpdateTime(long long time)
     mutex.lock();
     assert(logged());
     settings->setValue(lastUpdateTimeKey, time);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1734,7 +1745,7 @@ void Preferences::setLastUpdateVersion(int version)
     mutex.lock();
     assert(logged());
     settings->setValue(lastUpdateVersionKey, version);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1750,7 +1761,7 @@ void Preferences::setDownloadFolder(QString value)
 {
     mutex.lock();
     settings->setValue(downloadFolderKey, QDir::toNativeSeparators(value));
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1768,7 +1779,7 @@ void Preferences::setUploadFolder(long long value)
     mutex.lock();
     assert(logged());
     settings->setValue(uploadFolderKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1786,7 +1797,7 @@ void Preferences::setImportFolder(long long value)
     mutex.lock();
     assert(logged());
     settings->setValue(importFolderKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -1983,7 +1994,7 @@ void Preferences::setOneTimeActionDone(int action, bool done)
     {
         settings->beginGroup(currentAccount);
     }
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2111,6 +2122,63 @@ void Preferences::removeAllFolders()
     mutex.unlock();
 }
 
+// Keys of the path index. The filesystems of Windows and macOS are usually case-insensitive
+static QString syncPathKey(QString path)
+{
+    QString key = QDir::toNativeSeparators(path);
+    while (key.size() > 1 && key.endsWith(QDir::separator()))
+    {
+        key.chop(1);
+    }
+#if defined(WIN32) || defined(__APPLE__)
+    key = key.toLower();
+#endif
+    return key;
+}
+
+int Preferences::getSyncIndexByHandle(MegaHandle handle)
+{
+    mutex.lock();
+    int value = syncIndexByHandle.value(handle, -1);
+    mutex.unlock();
+    return value;
+}
+
+int Preferences::getSyncIndexByLocalPath(QString localPath)
+{
+    QString key = syncPathKey(localPath);
+
+    mutex.lock();
+    int value = -1;
+    while (!syncIndexByPath.isEmpty())
+    {
+        QHash<QString, int>::const_iterator it = syncIndexByPath.constFind(key);
+        if (it != syncIndexByPath.constEnd())
+        {
+            value = it.value();
+            break;
+        }
+
+        // try with the parent folder
+        int separator = key.lastIndexOf(QDir::separator());
+        if (separator < 0 || key.size() == 1)
+        {
+            break;
+        }
+        key = key.left(separator ? separator : 1);
+    }
+    mutex.unlock();
+    return value;
+}
+
+QStringList Preferences::getActiveSyncRoots()
+{
+    mutex.lock();
+    QStringList value = activeSyncRoots;
+    mutex.unlock();
+    return value;
+}
+
 QStringList Preferences::getExcludedSyncNames()
 {
     mutex.lock();
@@ -2134,7 +2202,7 @@ void Preferences::setExcludedSyncNames(QStringList names)
         settings->setValue(excludedSyncNamesKey, excludedSyncNames.join(QString::fromAscii("\n")));
     }
 
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2161,7 +2229,7 @@ void Preferences::setExcludedSyncPaths(QStringList paths)
         settings->setValue(excludedSyncPathsKey, excludedSyncPaths.join(QString::fromAscii("\n")));
     }
 
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2209,7 +2277,7 @@ void Preferences::setPreviousCrashes(QStringList crashes)
         settings->beginGroup(currentAccount);
     }
 
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2251,7 +2319,7 @@ void Preferences::setLastReboot(long long value)
         settings->beginGroup(currentAccount);
     }
 
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2293,7 +2361,49 @@ void Preferences::setLastExit(long long value)
         settings->beginGroup(currentAccount);
     }
 
-    settings->sync();
+    sync();
+    mutex.unlock();
+}
+
+int Preferences::maxCompletedTransfers()
+{
+    mutex.lock();
+    QString currentAccount;
+    if (logged())
+    {
+        settings->endGroup();
+        currentAccount = settings->value(currentAccountKey).toString();
+    }
+
+    int value = settings->value(maxCompletedTransfersKey, MAX_COMPLETED_ITEMS).toInt();
+
+    if (!currentAccount.isEmpty())
+    {
+        settings->beginGroup(currentAccount);
+    }
+
+    mutex.unlock();
+    return qBound(1, value, (int)MAX_COMPLETED_ITEMS_LIMIT);
+}
+
+void Preferences::setMaxCompletedTransfers(int value)
+{
+    mutex.lock();
+    QString currentAccount;
+    if (logged())
+    {
+        settings->endGroup();
+        currentAccount = settings->value(currentAccountKey).toString();
+    }
+
+    settings->setValue(maxCompletedTransfersKey, qBound(1, value, (int)MAX_COMPLETED_ITEMS_LIMIT));
+
+    if (!currentAccount.isEmpty())
+    {
+        settings->beginGroup(currentAccount);
+    }
+
+    requestSync();
     mutex.unlock();
 }
 
@@ -2334,7 +2444,7 @@ void Preferences::setHttpsKey(QString key)
         settings->beginGroup(currentAccount);
     }
 
-    settings->sync();
+    requestSync();
 }
 
 QString Preferences::getHttpsCert()
@@ -2374,7 +2484,7 @@ void Preferences::setHttpsCert(QString cert)
         settings->beginGroup(currentAccount);
     }
 
-    settings->sync();
+    requestSync();
 }
 
 QString Preferences::getHttpsCertIntermediate()
@@ -2414,7 +2524,7 @@ void Preferences::setHttpsCertIntermediate(QString intermediate)
         settings->beginGroup(currentAccount);
     }
 
-    settings->sync();
+    requestSync();
 }
 
 long long Preferences::getHttpsCertExpiration()
@@ -2454,7 +2564,7 @@ void Preferences::setHttpsCertExpiration(long long expiration)
         settings->beginGroup(currentAccount);
     }
 
-    settings->sync();
+    requestSync();
 }
 
 int Preferences::getNumUsers()
@@ -2496,6 +2606,7 @@ void Preferences::leaveUser()
     activeFolders.clear();
     temporaryInactiveFolders.clear();
     localFingerprints.clear();
+    updateSyncIndex();
     mutex.unlock();
 }
 
@@ -2518,7 +2629,8 @@ void Preferences::unlink()
     activeFolders.clear();
     temporaryInactiveFolders.clear();
     localFingerprints.clear();
-    settings->sync();
+    updateSyncIndex();
+    requestSync();
     mutex.unlock();
     emit stateChanged();
 }
@@ -2551,7 +2663,7 @@ void Preferences::setGlobalPaused(bool value)
 {
     mutex.lock();
     settings->setValue(wasPausedKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2567,7 +2679,7 @@ void Preferences::setUploadsPaused(bool value)
 {
     mutex.lock();
     settings->setValue(wasUploadsPausedKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2583,7 +2695,7 @@ void Preferences::setDownloadsPaused(bool value)
 {
     mutex.lock();
     settings->setValue(wasDownloadsPausedKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2599,7 +2711,7 @@ void Preferences::setLastStatsRequest(long long value)
 {
     mutex.lock();
     settings->setValue(lastStatsRequestKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2617,7 +2729,7 @@ void Preferences::disableFileVersioning(bool value)
     mutex.lock();
     assert(logged());
     settings->setValue(disableFileVersioningKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2633,7 +2745,7 @@ void Preferences::disableOverlayIcons(bool value)
 {
     mutex.lock();
     settings->setValue(disableOverlayIconsKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2649,7 +2761,7 @@ void Preferences::disableLeftPaneIcons(bool value)
 {
     mutex.lock();
     settings->setValue(disableLeftPaneIconsKey, value);
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2688,7 +2800,28 @@ void Preferences::clearAll()
 
 void Preferences::sync()
 {
+    mutex.lock();
+    syncTimer.stop();
     settings->sync();
+    mutex.unlock();
+}
+
+void Preferences::requestSync()
+{
+    // the timer belongs to the GUI thread
+    if (QThread::currentThread() == syncTimer.thread())
+    {
+        syncTimer.start();
+    }
+    else
+    {
+        QMetaObject::invokeMethod(&syncTimer, "start", Qt::QueuedConnection);
+    }
+}
+
+void Preferences::onSyncTimeout()
+{
+    sync();
 }
 
 void Preferences::login(QString account)
@@ -2708,7 +2841,7 @@ void Preferences::login(QString account)
         }
         settings->setValue(lastVersionKey, Preferences::VERSION_CODE);
     }
-    settings->sync();
+    requestSync();
     mutex.unlock();
 }
 
@@ -2756,6 +2889,7 @@ void Preferences::logout()
     activeFolders.clear();
     temporaryInactiveFolders.clear();
     localFingerprints.clear();
+    updateSyncIndex();
     mutex.unlock();
 }
 
@@ -2845,6 +2979,7 @@ void Preferences::readFolders()
         settings->endGroup();
     }
     settings->endGroup();
+    updateSyncIndex();
     mutex.unlock();
 }
 
@@ -2873,6 +3008,34 @@ void Preferences::writeFolders()
     }
 
     settings->endGroup();
-    settings->sync();
+    updateSyncIndex();
+    requestSync();
+    mutex.unlock();
+}
+
+void Preferences::updateSyncIndex()
+{
+    mutex.lock();
+    syncIndexByHandle.clear();
+    syncIndexByPath.clear();
+    activeSyncRoots.clear();
+    for (int i = 0; i < localFolders.size(); i++)
+    {
+        if (!activeFolders.at(i))
+        {
+            continue;
+        }
+
+        syncIndexByHandle.insert(megaFolderHandles.at(i), i);
+        syncIndexByPath.insert(syncPathKey(localFolders.at(i)), i);
+
+        // syncs are started with the canonical path
+        QString root = QDir::toNativeSeparators(QDir(localFolders.at(i)).canonicalPath());
+        if (!root.isEmpty())
+        {
+            syncIndexByPath.insert(syncPathKey(root), i);
+            activeSyncRoots.append(root);
+        }
+    }
     mutex.unlock();
 }
@@ -6,6 +6,8 @@
 #include <QLocale>
 #include <QStringList>
 #include <QMutex>
+#include <QTimer>
+#include <QHash>
 
 #include "control/EncryptedSettings.h"
 #include "megaapi.h"
@@ -224,6 +226,12 @@ public:
     void removeSyncedFolder(int num);
     void removeAllFolders();
 
+    // Position of the active sync rooted at a MEGA folder / containing a local path, -1 if there isn't any
+    int getSyncIndexByHandle(mega::MegaHandle handle);
+    int getSyncIndexByLocalPath(QString localPath);
+    // Canonical local paths of the active syncs
+    QStringList getActiveSyncRoots();
+
     QStringList getExcludedSyncNames();
     void setExcludedSyncNames(QStringList names);
     QStringList getExcludedSyncPaths();
@@ -235,6 +243,9 @@ public:
     void setLastReboot(long long value);
     long long getLastExit();
     void setLastExit(long long value);
+    // Finished transfers kept in the transfer manager, applied on the next start
+    int maxCompletedTransfers();
+    void setMaxCompletedTransfers(int value);
 
     QString getHttpsKey();
     void setHttpsKey(QString key);
@@ -274,6 +285,9 @@ public:
     QString getDataPath();
     void clearTemporalBandwidth();
     void clearAll();
+
+    // Changes are written to disk SETTINGS_SYNC_DELAY_MS after the last one,
+    // sync() writes them immediately
     void sync();
 
     enum {
@@ -316,6 +330,8 @@ public:
     static const long long MIN_UPDATE_STATS_INTERVAL_OVERQUOTA;
     static const long long MIN_UPDATE_CLEANING_INTERVAL_MS;
     static const int STATE_REFRESH_INTERVAL_MS;
+    static const int NETWORK_CHANGE_DELAY_MS;
+    static const int SETTINGS_SYNC_DELAY_MS;
     static const int FINISHED_TRANSFER_REFRESH_INTERVAL_MS;
     static const long long MIN_UPDATE_NOTIFICATION_INTERVAL_MS;
     static const unsigned int UPDATE_INITIAL_DELAY_SECS;
@@ -350,16 +366,23 @@ public:
     static QStringList HTTPS_ALLOWED_ORIGINS;
     static bool HTTPS_ORIGIN_CHECK_ENABLED;
     static const unsigned int MAX_COMPLETED_ITEMS;
+    static const unsigned int MAX_COMPLETED_ITEMS_LIMIT;
     static const QString FINDER_EXT_BUNDLE_ID;
 
+protected slots:
+    void onSyncTimeout();
+
 protected:
     QMutex mutex;
+    QTimer syncTimer;
+    void requestSync();
     void login(QString account);
     void logout();
 
     void loadExcludedSyncNames();
     void readFolders();
     void writeFolders();
+    void updateSyncIndex();
 
     EncryptedSettings *settings;
     QStringList syncNames;
@@ -370,6 +393,9 @@ protected:
     QList<long long> localFingerprints;
     QList<bool> activeFolders;
     QList<bool> temporaryInactiveFolders;
+    QHash<long long, int> syncIndexByHandle;
+    QHash<QString, int> syncIndexByPath;
+    QStringList activeSyncRoots;
     QStringList excludedSyncNames;
     QStringList excludedSyncPaths;
     bool errorFlag;
@@ -463,6 +489,7 @@ protected:
     static const QString previousCrashesKey;
     static const QString lastRebootKey;
     static const QString lastExitKey;
+    static const QString maxCompletedTransfersKey;
     static const QString disableOverlayIconsKey;
     static const QString disableFileVersioningKey;
     static const QString disableLeftPaneIconsKey;
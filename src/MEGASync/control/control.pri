@@ -13,6 +13,7 @@ SOURCES += $$PWD/HTTPServer.cpp \
     $$PWD/ExportProcessor.cpp \
     $$PWD/Utilities.cpp \
     $$PWD/MegaDownloader.cpp \
+    $$PWD/FinishedTransfers.cpp \
     $$PWD/MegaSyncLogger.cpp \
     $$PWD/ConnectivityChecker.cpp
 
@@ -26,6 +27,7 @@ HEADERS  +=  $$PWD/HTTPServer.h \
     $$PWD/ExportProcessor.h \
     $$PWD/Utilities.h \
     $$PWD/MegaDownloader.h \
+    $$PWD/FinishedTransfers.h \
     $$PWD/MegaSyncLogger.h \
     $$PWD/ConnectivityChecker.h
 
@@ -956,11 +956,13 @@ void InfoDialog::uploadState()
 
 void InfoDialog::cancelAllUploads()
 {
+    app->cancelPendingUploads();
     megaApi->cancelTransfers(MegaTransfer::TYPE_UPLOAD);
 }
 
 void InfoDialog::cancelAllDownloads()
 {
+    app->cancelPendingDownloads();
     megaApi->cancelTransfers(MegaTransfer::TYPE_DOWNLOAD);
 }
 
@@ -1,6 +1,7 @@
 #include "MegaItem.h"
 
 #include <QByteArray>
+#include <algorithm>
 
 using namespace mega;
 
@@ -10,6 +11,7 @@ MegaItem::MegaItem(MegaNode *node, MegaItem *parentItem, bool showFiles)
     this->children = NULL;
     this->parent = parentItem;
     this->showFiles = showFiles;
+    this->numLoadedChildren = 0;
 }
 
 mega::MegaNode *MegaItem::getNode()
@@ -25,10 +27,11 @@ void MegaItem::setChildren(MegaNodeList *children)
         MegaNode *node = children->get(i);
         if (!showFiles && node->getType() == MegaNode::TYPE_FILE)
         {
-            break;
+            continue;
         }
-        childItems.append(new MegaItem(children->get(i), this, showFiles));
+        childNodes.append(node);
     }
+    std::stable_sort(childNodes.begin(), childNodes.end(), lessThan);
 }
 
 bool MegaItem::areChildrenSet()
@@ -43,46 +46,73 @@ MegaItem *MegaItem::getParent()
 
 MegaItem *MegaItem::getChild(int i)
 {
-    return childItems.at(i);
+    MegaNode *child = childNodes.at(i);
+    MegaItem *item = childItems.value(child);
+    if (!item)
+    {
+        item = new MegaItem(child, this, showFiles);
+        childItems.insert(child, item);
+    }
+    return item;
 }
 
 int MegaItem::getNumChildren()
 {
-    return childItems.size();
+    return numLoadedChildren;
 }
 
-int MegaItem::indexOf(MegaItem *item)
+int MegaItem::getNumUnloadedChildren()
 {
-    return childItems.indexOf(item);
+    return childNodes.size() - numLoadedChildren;
 }
 
-int MegaItem::insertPosition(MegaNode *node)
+void MegaItem::loadChildren(int count)
+{
+    numLoadedChildren = qMin(numLoadedChildren + count, childNodes.size());
+}
+
+int MegaItem::indexOf(MegaItem *item)
 {
-    int type = node->getType();
+    return indexOf(item->getNode());
+}
 
-    int i;
-    for (i = 0; i < childItems.size(); i++)
+int MegaItem::indexOf(MegaNode *node)
+{
+    // There can be several children with the same name
+    QList<MegaNode *>::const_iterator it = std::lower_bound(childNodes.constBegin(), childNodes.constEnd(), node, lessThan);
+    while (it != childNodes.constEnd() && !lessThan(node, *it))
     {
-        MegaNode *n = childItems.at(i)->getNode();
-        int nodeType = n->getType();
-        if (type < nodeType)
+        if ((*it)->getHandle() == node->getHandle())
         {
-            continue;
+            return it - childNodes.constBegin();
         }
+        it++;
+    }
 
-        if (qstricmp(node->getName(), n->getName()) <= 0)
+    // The name can be different from the one of the children, if it was renamed
+    for (int i = 0; i < childNodes.size(); i++)
+    {
+        if (childNodes.at(i)->getHandle() == node->getHandle())
         {
-            break;
+            return i;
         }
     }
+    return -1;
+}
 
-    return i;
+int MegaItem::insertPosition(MegaNode *node)
+{
+    return std::lower_bound(childNodes.constBegin(), childNodes.constEnd(), node, lessThan) - childNodes.constBegin();
 }
 
 void MegaItem::insertNode(MegaNode *node, int index)
 {
-    childItems.insert(index, new MegaItem(node, this, showFiles));
+    childNodes.insert(index, node);
     insertedNodes.append(node);
+    if (index <= numLoadedChildren)
+    {
+        numLoadedChildren++;
+    }
 }
 
 void MegaItem::removeNode(MegaNode *node)
@@ -92,24 +122,22 @@ void MegaItem::removeNode(MegaNode *node)
         return;
     }
 
-    for (int i = 0; i < childItems.size(); i++)
+    int index = indexOf(node);
+    if (index < 0)
     {
-        if (childItems[i]->getNode()->getHandle() == node->getHandle())
-        {
-            delete childItems[i];
-            childItems.removeAt(i);
-            break;
-        }
+        return;
     }
 
-    for (int i = 0; i < insertedNodes.size(); i++)
+    MegaNode *child = childNodes.takeAt(index);
+    delete childItems.take(child);
+    if (index < numLoadedChildren)
     {
-        if (insertedNodes[i]->getHandle() == node->getHandle())
-        {
-            delete insertedNodes[i];
-            insertedNodes.removeAt(i);
-            break;
-        }
+        numLoadedChildren--;
+    }
+
+    if (insertedNodes.removeOne(child))
+    {
+        delete child;
     }
 }
 
@@ -125,3 +153,12 @@ MegaItem::~MegaItem()
     qDeleteAll(insertedNodes);
 }
 
+// Folders first, then by name
+bool MegaItem::lessThan(MegaNode *node1, MegaNode *node2)
+{
+    if (node1->getType() != node2->getType())
+    {
+        return node1->getType() > node2->getType();
+    }
+    return qstricmp(node1->getName(), node2->getName()) < 0;
+}
@@ -2,8 +2,14 @@
 #define MEGAITEM_H
 
 #include <QList>
+#include <QHash>
 #include <megaapi.h>
 
+// Node of the remote folder tree.
+// Children are kept sorted (folders first, then by name) so they can be found
+// with a binary search, and their MegaItem is only created when it is used.
+// Only the first getNumChildren() children are loaded in the model, the rest
+// are added with loadChildren().
 class MegaItem
 {
 public:
@@ -16,7 +22,12 @@ public:
     MegaItem *getParent();
     MegaItem *getChild(int i);
     int getNumChildren();
+    int getNumUnloadedChildren();
+    void loadChildren(int count);
+
+    // Position of the child, even if it isn't loaded yet, or -1 if it isn't a child
     int indexOf(MegaItem *item);
+    int indexOf(mega::MegaNode *node);
 
     int insertPosition(mega::MegaNode *node);
     void insertNode(mega::MegaNode *node, int index);
@@ -26,12 +37,16 @@ public:
     ~MegaItem();
 
 protected:
+    static bool lessThan(mega::MegaNode *node1, mega::MegaNode *node2);
+
     bool showFiles;
     MegaItem *parent;
     mega::MegaNode *node;
     mega::MegaNodeList *children;
-    QList<MegaItem *> childItems;
+    QList<mega::MegaNode *> childNodes;                 ///< Sorted, only the ones that can be shown
+    QHash<mega::MegaNode *, MegaItem *> childItems;     ///< Created the first time they are used
     QList<mega::MegaNode *> insertedNodes;
+    int numLoadedChildren;
 };
 
 #endif // MEGAITEM_H
@@ -9,6 +9,8 @@
 #include "gui/QMegaMessageBox.h"
 #include "megaapi.h"
 #include "QTransfersModel.h"
+#include "QActiveTransfersModel.h"
+#include "QFinishedTransfersModel.h"
 
 
 using namespace mega;
@@ -17,6 +19,8 @@ MegaTransferDelegate::MegaTransferDelegate(QTransfersModel *model, QObject *pare
     : QStyledItemDelegate(parent)
 {
     this->model = model;
+    transferItem = new TransferItem(this);
+    connect(transferItem, SIGNAL(animationFrameChanged()), this, SIGNAL(animationFrameChanged()));
 }
 
 void MegaTransferDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
@@ -29,69 +33,13 @@ void MegaTransferDelegate::paint(QPainter *painter, const QStyleOptionViewItem &
         }
 
         int tag = index.internalId();
-        int modelType = model->getModelType();
-        TransferItem *ti = model->transferItems[tag];
-        if (!ti)
+        TransferRowData row;
+        if (!model->getRowData(tag, &row))
         {
-            ti = new TransferItem();
-            ti->setTransferTag(tag);
-            connect(ti, SIGNAL(refreshTransfer(int)), model, SLOT(refreshTransferItem(int)));
-            model->transferItems.insert(tag, ti);
-            MegaTransfer *transfer = model->getTransferByTag(tag);
-
-            if (transfer)
-            {
-                ti->setType(transfer->getType(), transfer->isSyncTransfer());
-                ti->setFileName(QString::fromUtf8(transfer->getFileName()));
-                ti->setTotalSize(transfer->getTotalBytes());
-                ti->setSpeed(transfer->getSpeed(), transfer->getMeanSpeed());
-                ti->setTransferredBytes(transfer->getTransferredBytes(), !transfer->isSyncTransfer());
-                ti->setTransferState(transfer->getState());
-                ti->setPriority(transfer->getPriority());
-                if (modelType == QTransfersModel::TYPE_FINISHED)
-                {
-                    ti->setFinishedTime(transfer->getUpdateTime());
-                }
-                else
-                {
-                    delete transfer;
-                }
-            }
-        }
-        else if (modelType != QTransfersModel::TYPE_FINISHED)
-        {
-            ti->updateTransfer();
-        }
-
-        if (modelType == QTransfersModel::TYPE_FINISHED)
-        {
-            ti->updateFinishedTime();
-        }
-        else
-        {
-            Preferences *preferences = Preferences::instance();
-            if ((modelType == QTransfersModel::TYPE_DOWNLOAD) &&
-                (preferences->getDownloadsPaused()))
-            {
-                ti->setStateLabel(tr("paused"));
-                ti->loadDefaultTransferIcon();
-            }
-            else if ((modelType == QTransfersModel::TYPE_UPLOAD) &&
-                (preferences->getUploadsPaused()))
-            {
-                ti->setStateLabel(tr("paused"));
-                ti->loadDefaultTransferIcon();
-            }
-            else
-            {
-                ti->updateAnimation();
-            }
+            return;
         }
 
-        painter->save();
-        painter->translate(option.rect.topLeft());
-        ti->render(painter, QPoint(0, 0), QRegion(0, 0, option.rect.width(), option.rect.height()));
-        painter->restore();
+        transferItem->paint(painter, option.rect, row, model->getHoveredTransfer() == tag, areTransfersPaused());
     }
     else
     {
@@ -103,7 +51,7 @@ QSize MegaTransferDelegate::sizeHint(const QStyleOptionViewItem &option, const Q
 {
     if (index.isValid())
     {
-        return QSize(800, 48);
+        return transferItem->sizeHint();
     }
     else
     {
@@ -116,13 +64,14 @@ bool MegaTransferDelegate::editorEvent(QEvent *event, QAbstractItemModel *, cons
     if (QEvent::MouseButtonRelease ==  event->type())
     {
         int tag = index.internalId();
-        TransferItem *item = model->transferItems[tag];
-        if (!item)
+        TransferRowData row;
+        if (!model->getRowData(tag, &row))
         {
             return true;
         }
 
-        if (item->cancelButtonClicked(((QMouseEvent *)event)->pos() - option.rect.topLeft()))
+        if (transferItem->cancelButtonClicked(row, model->getHoveredTransfer() == tag,
+                                              ((QMouseEvent *)event)->pos() - option.rect.topLeft()))
         {
             if (model->getModelType() == QTransfersModel::TYPE_FINISHED)
             {
@@ -155,17 +104,27 @@ bool MegaTransferDelegate::helpEvent(QHelpEvent *event, QAbstractItemView *view,
 {
     if (event->type() == QEvent::ToolTip)
     {
-        int tag = index.internalId();
-        TransferItem *item = model->transferItems[tag];
-        if (item)
+        TransferRowData row;
+        if (model->getRowData(index.internalId(), &row)
+                && row.fileName != transferItem->getTransferName(row))
         {
-            QString fileName = item->getFileName();
-            if (fileName != item->getTransferName())
-            {
-                QToolTip::showText(event->globalPos(), fileName);
-                return true;
-            }
+            QToolTip::showText(event->globalPos(), row.fileName);
+            return true;
         }
     }
     return QStyledItemDelegate::helpEvent(event, view, option, index);
 }
+
+bool MegaTransferDelegate::areTransfersPaused() const
+{
+    Preferences *preferences = Preferences::instance();
+    switch (model->getModelType())
+    {
+        case QTransfersModel::TYPE_DOWNLOAD:
+            return preferences->getDownloadsPaused();
+        case QTransfersModel::TYPE_UPLOAD:
+            return preferences->getUploadsPaused();
+        default:
+            return false;
+    }
+}
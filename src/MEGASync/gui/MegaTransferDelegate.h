@@ -16,8 +16,15 @@ public:
     bool editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option, const QModelIndex &index);
     bool helpEvent(QHelpEvent *event, QAbstractItemView *view, const QStyleOptionViewItem &option, const QModelIndex &index);
 
+signals:
+    // Rows showing an animation need to be painted again
+    void animationFrameChanged();
+
 protected:
+    bool areTransfersPaused() const;
+
     QTransfersModel *model;
+    TransferItem *transferItem;
 };
 
 #endif // MEGATRANSFERDELEGATE_H
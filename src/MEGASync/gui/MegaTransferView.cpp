@@ -15,7 +15,6 @@ MegaTransferView::MegaTransferView(QWidget *parent) :
     QTreeView(parent)
 {
     setMouseTracking(true);
-    lastItemHoveredTag = 0;
     contextInProgressMenu = NULL;
     pauseTransfer = NULL;
     resumeTransfer = NULL;
@@ -296,45 +295,7 @@ void MegaTransferView::mouseMoveEvent(QMouseEvent *event)
     if (model)
     {
         QModelIndex index = indexAt(event->pos());
-        if (index.isValid())
-        {
-            int tag = index.internalId();
-            if (tag != lastItemHoveredTag)
-            {
-                if (lastItemHoveredTag)
-                {
-                    TransferItem *lastItemHovered = model->transferItems[lastItemHoveredTag];
-                    if (lastItemHovered)
-                    {
-                        lastItemHovered->mouseHoverTransfer(false);
-                    }
-                }
-
-                TransferItem *item = model->transferItems[tag];
-                if (item)
-                {
-                    lastItemHoveredTag = item->getTransferTag();
-                    item->mouseHoverTransfer(true);
-                }
-                else
-                {
-                    lastItemHoveredTag = 0;
-                }
-            }
-        }
-        else
-        {
-            if (lastItemHoveredTag)
-            {
-                TransferItem *lastItemHovered = model->transferItems[lastItemHoveredTag];
-                if (lastItemHovered)
-                {
-                    lastItemHovered->mouseHoverTransfer(false);
-                    update();
-                }
-                lastItemHoveredTag = 0;
-            }
-        }
+        model->setHoveredTransfer(index.isValid() ? (int)index.internalId() : 0);
     }
     QTreeView::mouseMoveEvent(event);
 }
@@ -344,16 +305,7 @@ void MegaTransferView::leaveEvent(QEvent *event)
     QTransfersModel *model = (QTransfersModel*)this->model();
     if (model)
     {
-        if (lastItemHoveredTag)
-        {
-            TransferItem *lastItemHovered = model->transferItems[lastItemHoveredTag];
-            if (lastItemHovered)
-            {
-                lastItemHovered->mouseHoverTransfer(false);
-                update();
-            }
-            lastItemHoveredTag = 0;
-        }
+        model->setHoveredTransfer(0);
     }
     QTreeView::leaveEvent(event);
 }
@@ -394,8 +346,8 @@ void MegaTransferView::onCustomContextMenu(const QPoint &point)
             transferTagSelected.append(indexes[i].internalId());
             if (!enablePause || !enableResume || !enableCancel)
             {
-                TransferItem *item = model->transferItems[indexes[i].internalId()];
-                if (!item)
+                TransferRowData row;
+                if (!model->getRowData(indexes[i].internalId(), &row))
                 {
                     enableResume = true;
                     enablePause = true;
@@ -403,12 +355,12 @@ void MegaTransferView::onCustomContextMenu(const QPoint &point)
                 }
                 else
                 {
-                    if (item->getRegular())
+                    if (!row.syncTransfer)
                     {
                         enableCancel = true;
                     }
 
-                    if (item->getTransferState() == mega::MegaTransfer::STATE_PAUSED)
+                    if (row.state == mega::MegaTransfer::STATE_PAUSED)
                     {
                         enableResume = true;
                     }
@@ -425,20 +377,20 @@ void MegaTransferView::onCustomContextMenu(const QPoint &point)
             if (model->getModelType() == QTransfersModel::TYPE_FINISHED)
             {
                 bool failed = false;
-                MegaTransfer *transfer = NULL;
-                QTransfersModel *model = (QTransfersModel*)this->model();
+                const FinishedTransfer *transfer = NULL;
+                QFinishedTransfersModel *model = (QFinishedTransfersModel*)this->model();
                 if (model)
                 {
                     for (int i = 0; i < transferTagSelected.size(); i++)
                     {
-                        transfer = model->getTransferByTag(transferTagSelected[i]);
+                        transfer = model->getFinishedTransferByTag(transferTagSelected[i]);
                         if (!transfer)
                         {
                             transferTagSelected.clear();
                             return;
                         }
 
-                        if (transfer->getState() == MegaTransfer::STATE_FAILED)
+                        if (transfer->state == MegaTransfer::STATE_FAILED)
                         {
                             failed = true;
                         }
@@ -494,49 +446,37 @@ void MegaTransferView::resumeTransferClicked()
 
 void MegaTransferView::moveToTopClicked()
 {
-    QTransfersModel *model = (QTransfersModel*)this->model();
+    QActiveTransfersModel *model = (QActiveTransfersModel*)this->model();
     if (model)
     {
-        for (int i = transferTagSelected.size() - 1; i >= 0; i--)
-        {
-            model->megaApi->moveTransferToFirstByTag(transferTagSelected[i]);
-        }
+        model->moveTransfers(transferTagSelected, QActiveTransfersModel::MOVE_TO_FIRST);
     }
 }
 
 void MegaTransferView::moveUpClicked()
 {
-    QTransfersModel *model = (QTransfersModel*)this->model();
+    QActiveTransfersModel *model = (QActiveTransfersModel*)this->model();
     if (model)
     {
-        for (int i = 0; i < transferTagSelected.size(); i++)
-        {
-            model->megaApi->moveTransferUpByTag(transferTagSelected[i]);
-        }
+        model->moveTransfers(transferTagSelected, QActiveTransfersModel::MOVE_UP);
     }
 }
 
 void MegaTransferView::moveDownClicked()
 {
-    QTransfersModel *model = (QTransfersModel*)this->model();
+    QActiveTransfersModel *model = (QActiveTransfersModel*)this->model();
     if (model)
     {
-        for (int i = transferTagSelected.size() - 1; i >= 0 ; i--)
-        {
-            model->megaApi->moveTransferDownByTag(transferTagSelected[i]);
-        }
+        model->moveTransfers(transferTagSelected, QActiveTransfersModel::MOVE_DOWN);
     }
 }
 
 void MegaTransferView::moveToBottomClicked()
 {
-    QTransfersModel *model = (QTransfersModel*)this->model();
+    QActiveTransfersModel *model = (QActiveTransfersModel*)this->model();
     if (model)
     {
-        for (int i = 0; i < transferTagSelected.size(); i++)
-        {
-            model->megaApi->moveTransferToLastByTag(transferTagSelected[i]);
-        }
+        model->moveTransfers(transferTagSelected, QActiveTransfersModel::MOVE_TO_LAST);
     }
 }
 
@@ -569,36 +509,25 @@ void MegaTransferView::getLinkClicked()
         return;
     }
 
-    MegaTransfer *transfer = NULL;
-    QTransfersModel *model = (QTransfersModel*)this->model();
+    const FinishedTransfer *transfer = NULL;
+    QFinishedTransfersModel *model = (QFinishedTransfersModel*)this->model();
     if (model)
     {
         QList<MegaHandle> exportList;
         QStringList linkList;
         for (int i = 0; i < transferTagSelected.size(); i++)
         {
-            transfer = model->getTransferByTag(transferTagSelected[i]);
+            transfer = model->getFinishedTransferByTag(transferTagSelected[i]);
             if (transfer)
             {
-                MegaNode *node = transfer->getPublicMegaNode();
-                if (!node || !node->isPublic())
+                if (transfer->publicLink.isEmpty())
                 {
-                    exportList.push_back(transfer->getNodeHandle());
+                    exportList.push_back(transfer->nodeHandle);
                 }
                 else
                 {
-                    char *handle = node->getBase64Handle();
-                    char *key = node->getBase64Key();
-                    if (handle && key)
-                    {
-                        QString link = QString::fromUtf8("https://mega.nz/#!%1!%2")
-                                .arg(QString::fromUtf8(handle)).arg(QString::fromUtf8(key));
-                        linkList.append(link);
-                    }
-                    delete [] handle;
-                    delete [] key;
+                    linkList.append(transfer->publicLink);
                 }
-                delete node;
             }
         }
 
@@ -611,16 +540,16 @@ void MegaTransferView::getLinkClicked()
 
 void MegaTransferView::openItemClicked()
 {
-    MegaTransfer *transfer = NULL;
-    QTransfersModel *model = (QTransfersModel*)this->model();
+    const FinishedTransfer *transfer = NULL;
+    QFinishedTransfersModel *model = (QFinishedTransfersModel*)this->model();
     if (model)
     {
         for (int i = 0; i < transferTagSelected.size(); i++)
         {
-            transfer = model->getTransferByTag(transferTagSelected[i]);
-            if (transfer && transfer->getPath())
+            transfer = model->getFinishedTransferByTag(transferTagSelected[i]);
+            if (transfer && !transfer->path.isEmpty())
             {
-                QtConcurrent::run(QDesktopServices::openUrl, QUrl::fromLocalFile(QString::fromUtf8(transfer->getPath())));
+                QtConcurrent::run(QDesktopServices::openUrl, QUrl::fromLocalFile(transfer->path));
             }
         }
     }
@@ -628,16 +557,16 @@ void MegaTransferView::openItemClicked()
 
 void MegaTransferView::showInFolderClicked()
 {
-    MegaTransfer *transfer = NULL;
-    QTransfersModel *model = (QTransfersModel*)this->model();
+    const FinishedTransfer *transfer = NULL;
+    QFinishedTransfersModel *model = (QFinishedTransfersModel*)this->model();
     if (model)
     {
         for (int i = 0; i < transferTagSelected.size(); i++)
         {
-            transfer = model->getTransferByTag(transferTagSelected[i]);
-            if (transfer && transfer->getPath())
+            transfer = model->getFinishedTransferByTag(transferTagSelected[i]);
+            if (transfer && !transfer->path.isEmpty())
             {
-                QString localPath = QString::fromUtf8(transfer->getPath());
+                QString localPath = transfer->path;
                 #ifdef WIN32
                 if (localPath.startsWith(QString::fromAscii("\\\\?\\")))
                 {
@@ -652,17 +581,16 @@ void MegaTransferView::showInFolderClicked()
 
 void MegaTransferView::showInMEGAClicked()
 {
-    MegaTransfer *transfer = NULL;
-    QTransfersModel *model = (QTransfersModel*)this->model();
+    const FinishedTransfer *transfer = NULL;
+    QFinishedTransfersModel *model = (QFinishedTransfersModel*)this->model();
     if (model)
     {
         for (int i = 0; i < transferTagSelected.size(); i++)
         {
-            transfer = model->getTransferByTag(transferTagSelected[i]);
-            MegaHandle handle = transfer->getNodeHandle();
-            if (transfer && (handle != INVALID_HANDLE))
+            transfer = model->getFinishedTransferByTag(transferTagSelected[i]);
+            if (transfer && (transfer->nodeHandle != INVALID_HANDLE))
             {
-                const char *b64handle = MegaApi::handleToBase64(handle);
+                const char *b64handle = MegaApi::handleToBase64(transfer->nodeHandle);
                 QString url = QString::fromAscii("https://mega.nz/fm/") + QString::fromUtf8(b64handle);
                 QtConcurrent::run(QDesktopServices::openUrl, QUrl(url));
                 delete [] b64handle;
@@ -4,8 +4,8 @@
 #include <QTreeView>
 #include <QMenu>
 #include <QMouseEvent>
-#include "TransferItem.h"
 #include "QTransfersModel.h"
+#include "QActiveTransfersModel.h"
 
 class MegaTransferView : public QTreeView
 {
@@ -18,7 +18,6 @@ public:
     int getType() const;
 
 private:
-    int lastItemHoveredTag;
     QList<int> transferTagSelected;
     bool disableLink;
     int type;
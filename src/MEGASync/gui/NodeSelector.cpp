@@ -4,6 +4,7 @@
 #include <QMessageBox>
 #include <QPointer>
 #include <QMenu>
+#include <QScrollBar>
 #include "control/Utilities.h"
 
 
@@ -79,8 +80,12 @@ void NodeSelector::nodesReady()
         break;
     }
 
+    ui->tMegaFolders->setUniformRowHeights(true);
     ui->tMegaFolders->setModel(model);
     connect(ui->tMegaFolders->selectionModel(), SIGNAL(selectionChanged(QItemSelection,QItemSelection)),this, SLOT(onSelectionChanged(QItemSelection,QItemSelection)));
+    connect(ui->tMegaFolders->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(onFoldersScrolled(int)), Qt::UniqueConnection);
+    connect(ui->tMegaFolders, SIGNAL(expanded(QModelIndex)), this, SLOT(onFolderExpanded(QModelIndex)), Qt::UniqueConnection);
+    pagedFolders.clear();
 
     ui->tMegaFolders->collapseAll();
     ui->tMegaFolders->header()->close();
@@ -139,19 +144,14 @@ void NodeSelector::setSelectedFolderHandle(long long selectedHandle)
     QModelIndex parentModelIndex;
     node = list.at(index);
 
-    for (int i = 0; i < model->rowCount(); i++)
+    QModelIndex tmp = model->findIndex(node, modelIndex);
+    if (tmp.isValid())
     {
-        QModelIndex tmp = model->index(i, 0);
-        MegaNode *n = model->getNode(tmp);
-        if (n && n->getHandle() == node->getHandle())
-        {
-            node = NULL;
-            parentModelIndex = modelIndex;
-            modelIndex = tmp;
-            index--;
-            ui->tMegaFolders->expand(parentModelIndex);
-            break;
-        }
+        node = NULL;
+        parentModelIndex = modelIndex;
+        modelIndex = tmp;
+        index--;
+        ui->tMegaFolders->expand(parentModelIndex);
     }
 
     if (node)
@@ -167,19 +167,14 @@ void NodeSelector::setSelectedFolderHandle(long long selectedHandle)
     while (index >= 0)
     {
         node = list.at(index);
-        for (int j = 0; j < model->rowCount(modelIndex); j++)
+        tmp = model->findIndex(node, modelIndex);
+        if (tmp.isValid())
         {
-            QModelIndex tmp = model->index(j, 0, modelIndex);
-            MegaNode *n = model->getNode(tmp);
-            if (n && n->getHandle() == node->getHandle())
-            {
-                node = NULL;
-                parentModelIndex = modelIndex;
-                modelIndex = tmp;
-                index--;
-                ui->tMegaFolders->expand(parentModelIndex);
-                break;
-            }
+            node = NULL;
+            parentModelIndex = modelIndex;
+            modelIndex = tmp;
+            index--;
+            ui->tMegaFolders->expand(parentModelIndex);
         }
 
         if (node)
@@ -371,6 +366,45 @@ void NodeSelector::onSelectionChanged(QItemSelection, QItemSelection)
     }
 }
 
+void NodeSelector::onFoldersScrolled(int)
+{
+    // QTreeView only fetches more rows for the last folder of the tree, so the next page
+    // of an expanded folder is loaded when its last loaded row is above the bottom of the view,
+    // even if it was skipped by the scroll
+    int bottom = ui->tMegaFolders->viewport()->height();
+    for (int i = pagedFolders.size() - 1; i >= 0; i--)
+    {
+        QModelIndex folder = pagedFolders.at(i);
+        if (!folder.isValid() || !model->canFetchMore(folder))
+        {
+            pagedFolders.removeAt(i);
+            continue;
+        }
+
+        if (!ui->tMegaFolders->isExpanded(folder))
+        {
+            continue;
+        }
+
+        QRect rect = ui->tMegaFolders->visualRect(model->index(model->rowCount(folder) - 1, 0, folder));
+        if (rect.isValid() && rect.top() < bottom)
+        {
+            model->fetchMore(folder);
+        }
+    }
+}
+
+void NodeSelector::onFolderExpanded(const QModelIndex &index)
+{
+    // rowCount() gets the children, so it's known if there are more pages
+    model->rowCount(index);
+    if (model->canFetchMore(index) && !pagedFolders.contains(QPersistentModelIndex(index)))
+    {
+        pagedFolders.append(QPersistentModelIndex(index));
+    }
+    onFoldersScrolled(0);
+}
+
 void NodeSelector::on_bNewFolder_clicked()
 {
     QPointer<QInputDialog> id = new QInputDialog(this);
@@ -412,18 +446,12 @@ void NodeSelector::on_bNewFolder_clicked()
         }
         else
         {
-            for (int i = 0; i < model->rowCount(selectedItem); i++)
+            QModelIndex row = model->findIndex(node, selectedItem);
+            if (row.isValid())
             {
-                QModelIndex row = model->index(i, 0, selectedItem);
-                MegaNode *node = model->getNode(row);
-
-                if (node && text.compare(QString::fromUtf8(node->getName())) == 0)
-                {
-                    setSelectedFolderHandle(node->getHandle());
-                    ui->tMegaFolders->selectionModel()->select(row, QItemSelectionModel::ClearAndSelect);
-                    ui->tMegaFolders->selectionModel()->setCurrentIndex(row, QItemSelectionModel::ClearAndSelect);
-                    break;
-                }
+                setSelectedFolderHandle(node->getHandle());
+                ui->tMegaFolders->selectionModel()->select(row, QItemSelectionModel::ClearAndSelect);
+                ui->tMegaFolders->selectionModel()->setCurrentIndex(row, QItemSelectionModel::ClearAndSelect);
             }
         }
         delete parent;
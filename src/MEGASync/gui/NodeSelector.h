@@ -38,6 +38,7 @@ private:
     QModelIndex selectedItem;
     int selectMode;
     QMegaModel *model;
+    QList<QPersistentModelIndex> pagedFolders;  ///< Expanded folders with rows to load
 
 protected:
     void nodesReady();
@@ -54,6 +55,8 @@ protected:
 
 private slots:
     void onSelectionChanged(QItemSelection,QItemSelection);
+    void onFoldersScrolled(int);
+    void onFolderExpanded(const QModelIndex &index);
     void on_bNewFolder_clicked();
     void on_bOk_clicked();
 };
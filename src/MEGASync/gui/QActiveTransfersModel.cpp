@@ -1,9 +1,13 @@
 #include "QActiveTransfersModel.h"
 #include "MegaApplication.h"
 #include <assert.h>
+#include <algorithm>
 
 using namespace mega;
 
+const int QActiveTransfersModel::UPDATE_INTERVAL_MS = 16;
+const int QActiveTransfersModel::MAX_ROW_MOVES = 16;
+
 bool priority_comparator(TransferItemData* i, TransferItemData *j)
 {
     if (i->priority < j->priority)
@@ -18,56 +22,60 @@ bool priority_comparator(TransferItemData* i, TransferItemData *j)
 QActiveTransfersModel::QActiveTransfersModel(int type, MegaTransferData *transferData, QObject *parent) :
     QTransfersModel(type, parent)
 {
+    updateTimer = new QTimer(this);
+    updateTimer->setSingleShot(true);
+    updateTimer->setInterval(UPDATE_INTERVAL_MS);
+    connect(updateTimer, SIGNAL(timeout()), this, SLOT(applyPendingUpdates()));
+
+    pendingMoves = 0;
+    delegateListener = new QTMegaRequestListener(megaApi, this);
+
     if (!transferData)
     {
         return;
     }
 
-    TransferItemData *itemData = NULL;
-    if (type == TYPE_DOWNLOAD)
+    // All the transfers are added at once, the tree is built from them in O(n)
+    bool duplicated = false;
+    int numTransfers = (type == TYPE_DOWNLOAD) ? transferData->getNumDownloads() : transferData->getNumUploads();
+    QVector<TransferItemData *> items;
+    items.reserve(numTransfers);
+    for (int i = 0; i < numTransfers; i++)
     {
-        int numDownloads = transferData->getNumDownloads();
-        if (numDownloads)
+        TransferItemData *itemData = new TransferItemData();
+        itemData->tag = (type == TYPE_DOWNLOAD) ? transferData->getDownloadTag(i) : transferData->getUploadTag(i);
+        itemData->priority = (type == TYPE_DOWNLOAD) ? transferData->getDownloadPriority(i) : transferData->getUploadPriority(i);
+        if (transfers.contains(itemData->tag))
         {
-            beginInsertRows(QModelIndex(), 0, numDownloads - 1);
-            transferOrder.resize(numDownloads);
-            for (int i = 0; i < numDownloads; i++)
-            {
-                itemData = new TransferItemData();
-                itemData->tag = transferData->getDownloadTag(i);
-                itemData->priority = transferData->getDownloadPriority(i);
-                transfers.insert(itemData->tag, itemData);
-                transferOrder[i] = itemData;
-            }
-            endInsertRows();
+            duplicated = true;
+            delete itemData;
+            continue;
         }
+
+        transfers.insert(itemData->tag, itemData);
+        items.append(itemData);
     }
-    else if (type == TYPE_UPLOAD)
+
+    if (items.size())
     {
-        int numUploads = transferData->getNumUploads();
-        if (numUploads)
-        {
-            beginInsertRows(QModelIndex(), 0, numUploads - 1);
-            transferOrder.resize(numUploads);
-            for (int i = 0; i < numUploads; i++)
-            {
-                itemData = new TransferItemData();
-                itemData->tag = transferData->getUploadTag(i);
-                itemData->priority = transferData->getUploadPriority(i);
-                transfers.insert(itemData->tag, itemData);
-                transferOrder[i] = itemData;
-            }
-            endInsertRows();
-        }
+        std::sort(items.begin(), items.end(), priority_comparator);
+        beginInsertRows(QModelIndex(), 0, items.size() - 1);
+        transferOrder.assign(items);
+        endInsertRows();
     }
 
-    if (transferOrder.size() != transfers.size())
+    if (duplicated)
     {
         assert(false);
         megaApi->sendEvent(99513, QString::fromUtf8("Duplicated active transfer during initialization").toUtf8().constData());
     }
 }
 
+QActiveTransfersModel::~QActiveTransfersModel()
+{
+    delete delegateListener;
+}
+
 void QActiveTransfersModel::removeTransferByTag(int transferTag)
 {
     TransferItemData *item =  transfers.value(transferTag);
@@ -76,18 +84,18 @@ void QActiveTransfersModel::removeTransferByTag(int transferTag)
         return;
     }
 
-    transfer_it it = std::lower_bound(transferOrder.begin(), transferOrder.end(), item, priority_comparator);
-    int row = std::distance(transferOrder.begin(), it);
-    assert(it != transferOrder.end() && (*it)->tag == transferTag);
-    if (it == transferOrder.end() || (*it)->tag != transferTag)
+    int row = rowOf(item);
+    if (row < 0)
     {
         return;
     }
 
+    pendingUpdates.remove(transferTag);
+    pendingPriorities.remove(transferTag);
+
     beginRemoveRows(QModelIndex(), row, row);
     transfers.remove(transferTag);
-    transferOrder.erase(it);
-    transferItems.remove(transferTag);
+    transferOrder.remove(item);
     endRemoveRows();
     delete item;
 
@@ -147,7 +155,7 @@ bool QActiveTransfersModel::dropMimeData(const QMimeData *data, Qt::DropAction,
     TransferItemData *item = NULL;
     if (row != transferOrder.size())
     {
-        item = transferOrder[row];
+        item = transferOrder.at(row);
         if (item->tag == selectedTags[0])
         {
             return false;
@@ -159,26 +167,72 @@ bool QActiveTransfersModel::dropMimeData(const QMimeData *data, Qt::DropAction,
             return false;
         }
 
-        std::deque<TransferItemData*>::iterator srcit = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
-        int srcrow = std::distance(transferOrder.begin(), srcit);
+        int srcrow = rowOf(itemData);
         if (srcrow + selectedTags.size() == row)
         {
             return false;
         }
     }
 
-    for (int i = 0; i< selectedTags.size(); i++)
+    QList<int> tags;
+    for (int i = 0; i < selectedTags.size(); i++)
+    {
+        tags.append(selectedTags[i]);
+    }
+
+    if (item)
+    {
+        moveTransfers(tags, MOVE_BEFORE, item->tag);
+    }
+    else
+    {
+        moveTransfers(tags, MOVE_TO_LAST);
+    }
+    return true;
+}
+
+void QActiveTransfersModel::moveTransfers(QList<int> tags, int moveType, int beforeTag)
+{
+    // Sort the transfers by row, the selection isn't always in order
+    QList<QPair<int, int> > rows;
+    for (int i = 0; i < tags.size(); i++)
     {
-        if (item)
+        TransferItemData *itemData = transfers.value(tags.at(i));
+        if (itemData)
         {
-            megaApi->moveTransferBeforeByTag(selectedTags[i], item->tag);
+            rows.append(qMakePair(rowOf(itemData), itemData->tag));
         }
-        else
+    }
+    qSort(rows);
+
+    // Moving to the top or down starts with the last transfer, so they keep their order
+    bool reverse = (moveType == MOVE_TO_FIRST || moveType == MOVE_DOWN);
+    for (int i = 0; i < rows.size(); i++)
+    {
+        int tag = rows.at(reverse ? (rows.size() - 1 - i) : i).second;
+        pendingMoves++;
+        switch (moveType)
         {
-            megaApi->moveTransferToLastByTag(selectedTags[i]);
+            case MOVE_TO_FIRST:
+                megaApi->moveTransferToFirstByTag(tag, delegateListener);
+                break;
+            case MOVE_UP:
+                megaApi->moveTransferUpByTag(tag, delegateListener);
+                break;
+            case MOVE_DOWN:
+                megaApi->moveTransferDownByTag(tag, delegateListener);
+                break;
+            case MOVE_TO_LAST:
+                megaApi->moveTransferToLastByTag(tag, delegateListener);
+                break;
+            case MOVE_BEFORE:
+                megaApi->moveTransferBeforeByTag(tag, beforeTag, delegateListener);
+                break;
+            default:
+                pendingMoves--;
+                break;
         }
     }
-    return true;
 }
 
 MegaTransfer *QActiveTransfersModel::getTransferByTag(int tag)
@@ -186,6 +240,30 @@ MegaTransfer *QActiveTransfersModel::getTransferByTag(int tag)
     return megaApi->getTransferByTag(tag);
 }
 
+bool QActiveTransfersModel::getRowData(int tag, TransferRowData *row)
+{
+    TransferItemData *itemData = transfers.value(tag);
+    if (!itemData)
+    {
+        return false;
+    }
+
+    if (!itemData->row)
+    {
+        // Transfers loaded at startup don't have a row until they are painted
+        MegaTransfer *transfer = getTransferByTag(tag);
+        if (!transfer)
+        {
+            return false;
+        }
+        itemData->row = new TransferRowData(transfer);
+        delete transfer;
+    }
+
+    *row = *itemData->row;
+    return true;
+}
+
 void QActiveTransfersModel::onTransferStart(MegaApi *, MegaTransfer *transfer)
 {
     if (transfer->getType() == type)
@@ -193,9 +271,8 @@ void QActiveTransfersModel::onTransferStart(MegaApi *, MegaTransfer *transfer)
         TransferItemData *item = new TransferItemData();
         item->tag = transfer->getTag();
         item->priority = transfer->getPriority();
+        item->row = new TransferRowData(transfer);
 
-        transfer_it it = std::lower_bound(transferOrder.begin(), transferOrder.end(), item, priority_comparator);
-        int row = std::distance(transferOrder.begin(), it);
         if (transfers.count(item->tag))
         {
             assert(false);
@@ -204,9 +281,10 @@ void QActiveTransfersModel::onTransferStart(MegaApi *, MegaTransfer *transfer)
             return;
         }
 
+        int row = transferOrder.lowerBound(item->priority, item->tag);
         beginInsertRows(QModelIndex(), row, row);
         transfers.insert(item->tag, item);
-        transferOrder.insert(it, item);
+        transferOrder.insert(item);
         endInsertRows();
 
         if (transferOrder.size() == 1)
@@ -240,6 +318,22 @@ void QActiveTransfersModel::onTransferTemporaryError(MegaApi *, MegaTransfer *tr
     }
 }
 
+void QActiveTransfersModel::onRequestFinish(MegaApi *, MegaRequest *, MegaError *)
+{
+    // Only the move requests use delegateListener
+    if (!pendingMoves || --pendingMoves)
+    {
+        return;
+    }
+
+    // The whole batch has been moved
+    if (!pendingPriorities.isEmpty())
+    {
+        sortTransfers();
+        pendingPriorities.clear();
+    }
+}
+
 void QActiveTransfersModel::updateTransferInfo(MegaTransfer *transfer)
 {
     TransferItemData *itemData = transfers.value(transfer->getTag());
@@ -248,68 +342,148 @@ void QActiveTransfersModel::updateTransferInfo(MegaTransfer *transfer)
         return;
     }
 
+    if (itemData->row)
+    {
+        itemData->row->update(transfer);
+    }
+    else
+    {
+        itemData->row = new TransferRowData(transfer);
+    }
+
+    // The position of the row depends on itemData->priority, so it's changed when the batch is applied
     unsigned long long newPriority = transfer->getPriority();
-    TransferItem *item = transferItems[transfer->getTag()];
-    if (item)
+    if (newPriority != itemData->priority)
     {
-        if (item->getType() < 0)
-        {
-            item->setType(transfer->getType(), transfer->isSyncTransfer());
-            item->setFileName(QString::fromUtf8(transfer->getFileName()));
-            item->setTotalSize(transfer->getTotalBytes());
-        }
+        pendingPriorities.insert(itemData->tag, newPriority);
+    }
+    else
+    {
+        pendingPriorities.remove(itemData->tag);
+    }
 
-        item->setSpeed(transfer->getSpeed(), transfer->getMeanSpeed());
-        item->setTransferredBytes(transfer->getTransferredBytes(), !transfer->isSyncTransfer());
-        item->setTransferState(transfer->getState());
-        item->setPriority(newPriority);
+    pendingUpdates.insert(itemData->tag);
+    if (!updateTimer->isActive())
+    {
+        updateTimer->start();
     }
+}
 
-    if (newPriority == itemData->priority)
+void QActiveTransfersModel::applyPendingUpdates()
+{
+    // While a batch of moves is running, new priorities wait for its end
+    if (!pendingMoves)
     {
-        //Update modified item
-        std::deque<TransferItemData*>::iterator it = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
-        int row = std::distance(transferOrder.begin(), it);
-        assert(it != transferOrder.end() && (*it)->tag == itemData->tag);
-        if (row >= transferOrder.size())
+        if (pendingPriorities.size() > MAX_ROW_MOVES)
         {
-            return;
+            sortTransfers();
+        }
+        else
+        {
+            for (QHash<int, unsigned long long>::iterator it = pendingPriorities.begin(); it != pendingPriorities.end(); ++it)
+            {
+                TransferItemData *itemData = transfers.value(it.key());
+                if (itemData)
+                {
+                    moveTransfer(itemData, it.value());
+                }
+            }
         }
-        emit dataChanged(index(row, 0, QModelIndex()), index(row, 0, QModelIndex()));
+        pendingPriorities.clear();
     }
-    else
+
+    // Repaint the updated rows, with a single range for consecutive ones
+    QVector<int> rows;
+    rows.reserve(pendingUpdates.size());
+    for (QSet<int>::iterator it = pendingUpdates.begin(); it != pendingUpdates.end(); ++it)
     {
-        //Move item to its new position
-        std::deque<TransferItemData*>::iterator it = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
-        int row = std::distance(transferOrder.begin(), it);
-        assert(it != transferOrder.end() && (*it)->tag == itemData->tag);
-        if (it == transferOrder.end() || (*it)->tag != itemData->tag)
+        TransferItemData *itemData = transfers.value(*it);
+        int row = itemData ? rowOf(itemData) : -1;
+        if (row >= 0)
         {
-            return;
+            rows.append(row);
         }
+    }
+    pendingUpdates.clear();
+    qSort(rows);
 
-        TransferItemData testItem;
-        testItem.tag = itemData->tag;
-        testItem.priority = newPriority;
-        std::deque<TransferItemData*>::iterator newit = std::lower_bound(transferOrder.begin(), transferOrder.end(), &testItem, priority_comparator);
-        int newrow = std::distance(transferOrder.begin(), newit);
-
-        if (row == newrow || (row + 1) == newrow)
+    int i = 0;
+    while (i < rows.size())
+    {
+        int first = rows.at(i);
+        int last = first;
+        while (++i < rows.size() && rows.at(i) == last + 1)
         {
-            //Priorities are being adjusted, but there isn't an actual move operation
-            itemData->priority = newPriority;
-            emit dataChanged(index(row, 0, QModelIndex()), index(row, 0, QModelIndex()));
+            last++;
         }
-        else
+        emit dataChanged(index(first, 0, QModelIndex()), index(last, 0, QModelIndex()));
+    }
+}
+
+int QActiveTransfersModel::rowOf(TransferItemData *itemData)
+{
+    int row = transferOrder.rowOf(itemData);
+    assert(row >= 0);
+    return row;
+}
+
+void QActiveTransfersModel::moveTransfer(TransferItemData *itemData, unsigned long long newPriority)
+{
+    int row = rowOf(itemData);
+    if (row < 0)
+    {
+        return;
+    }
+
+    int newrow = transferOrder.lowerBound(newPriority, itemData->tag);
+
+    if (row == newrow || (row + 1) == newrow)
+    {
+        //Priorities are being adjusted, but there isn't an actual move operation
+        itemData->priority = newPriority;
+        return;
+    }
+
+    beginMoveRows(QModelIndex(), row, row, QModelIndex(), newrow);
+    transferOrder.remove(itemData);
+    itemData->priority = newPriority;
+    transferOrder.insert(itemData);
+    endMoveRows();
+}
+
+// Applies all the pending priorities at once, as a single layout change.
+// Each moved row is removed and inserted again, the rest of them aren't touched
+void QActiveTransfersModel::sortTransfers()
+{
+    emit layoutAboutToBeChanged();
+
+    QModelIndexList oldIndexes = persistentIndexList();
+    QList<TransferItemData *> movedItems;
+    for (QHash<int, unsigned long long>::iterator it = pendingPriorities.begin(); it != pendingPriorities.end(); ++it)
+    {
+        TransferItemData *itemData = transfers.value(it.key());
+        if (itemData)
         {
-            beginMoveRows(QModelIndex(), row, row, QModelIndex(), newrow);
-            transferOrder.erase(it);
-            itemData->priority = newPriority;
-            std::deque<TransferItemData*>::iterator finalit = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
-            transferOrder.insert(finalit, itemData);
-            endMoveRows();
+            transferOrder.remove(itemData);
+            itemData->priority = it.value();
+            movedItems.append(itemData);
         }
     }
+    for (int i = 0; i < movedItems.size(); i++)
+    {
+        transferOrder.insert(movedItems.at(i));
+    }
+
+    QModelIndexList newIndexes;
+    for (int i = 0; i < oldIndexes.size(); i++)
+    {
+        TransferItemData *itemData = transfers.value(oldIndexes.at(i).internalId());
+        int row = itemData ? rowOf(itemData) : -1;
+        newIndexes.append(row >= 0 ? index(row, oldIndexes.at(i).column(), QModelIndex()) : QModelIndex());
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+
+    emit layoutChanged();
 }
 
 void QActiveTransfersModel::refreshTransferItem(int tag)
@@ -320,10 +494,8 @@ void QActiveTransfersModel::refreshTransferItem(int tag)
         return;
     }
 
-    std::deque<TransferItemData*>::iterator it = std::lower_bound(transferOrder.begin(), transferOrder.end(), itemData, priority_comparator);
-    int row = std::distance(transferOrder.begin(), it);
-    assert(it != transferOrder.end() && (*it)->tag == itemData->tag);
-    if (row >= transferOrder.size())
+    int row = rowOf(itemData);
+    if (row < 0)
     {
         return;
     }
@@ -2,26 +2,42 @@
 #define QACTIVETRANSFERSMODEL_H
 
 #include <QAbstractItemModel>
-#include <QCache>
-#include "TransferItem.h"
+#include <QTimer>
+#include <QSet>
 #include <megaapi.h>
 #include "QTMegaTransferListener.h"
-#include <deque>
+#include "QTMegaRequestListener.h"
 #include "QTransfersModel.h"
 
 typedef bool (*comparator_function)(TransferItemData* i, TransferItemData *j);
-typedef std::deque<TransferItemData*>::iterator transfer_it;
 
-class QActiveTransfersModel : public QTransfersModel
+class QActiveTransfersModel : public QTransfersModel, public mega::MegaRequestListener
 {
     Q_OBJECT
 
 public:
+    enum {
+        MOVE_TO_FIRST = 0,
+        MOVE_UP,
+        MOVE_DOWN,
+        MOVE_TO_LAST,
+        MOVE_BEFORE
+    };
+
+    static const int UPDATE_INTERVAL_MS;
+    static const int MAX_ROW_MOVES;
+
     explicit QActiveTransfersModel(int type, mega::MegaTransferData *transferData, QObject *parent = 0);
+    virtual ~QActiveTransfersModel();
     void setupModelTransfers();
     void removeTransferByTag(int transferTag);
     void removeAllTransfers();
 
+    // Moves the transfers as a batch, keeping their relative order. beforeTag is only for MOVE_BEFORE.
+    // The SDK moves them one by one, but the rows are rearranged in a single
+    // layout change once all of them have been moved
+    void moveTransfers(QList<int> tags, int moveType, int beforeTag = 0);
+
     // Drag & drop
     QMimeData *mimeData(const QModelIndexList & indexes) const;
     virtual Qt::ItemFlags flags(const QModelIndex&index) const;
@@ -29,18 +45,31 @@ public:
     virtual bool dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent);
 
     virtual mega::MegaTransfer *getTransferByTag(int tag);
+    virtual bool getRowData(int tag, TransferRowData *row);
 
     // MegaApi callbacks
     virtual void onTransferStart(mega::MegaApi *api, mega::MegaTransfer *transfer);
     virtual void onTransferFinish(mega::MegaApi* api, mega::MegaTransfer *transfer, mega::MegaError* e);
     virtual void onTransferUpdate(mega::MegaApi *api, mega::MegaTransfer *transfer);
     virtual void onTransferTemporaryError(mega::MegaApi *api, mega::MegaTransfer *transfer, mega::MegaError* e);
+    virtual void onRequestFinish(mega::MegaApi *api, mega::MegaRequest *request, mega::MegaError *e);
 
 protected:
+    // Updates are applied to the rows in batches, at most once every UPDATE_INTERVAL_MS
     void updateTransferInfo(mega::MegaTransfer *transfer);
+    int rowOf(TransferItemData *itemData);
+    void moveTransfer(TransferItemData *itemData, unsigned long long newPriority);
+    void sortTransfers();
+
+    QTimer *updateTimer;
+    QSet<int> pendingUpdates;                           ///< Tags of the rows to repaint
+    QHash<int, unsigned long long> pendingPriorities;   ///< New priorities of the rows to move
+    int pendingMoves;                                   ///< Move requests of the current batch not finished yet
+    mega::QTMegaRequestListener *delegateListener;
 
 private slots:
     void refreshTransferItem(int tag);
+    void applyPendingUpdates();
 };
 
 #endif // QACTIVETRANSFERSMODEL_H
@@ -4,127 +4,112 @@
 
 using namespace mega;
 
-QFinishedTransfersModel::QFinishedTransfersModel(QList<MegaTransfer *> finishedTransfers, QObject *parent) :
+QFinishedTransfersModel::QFinishedTransfersModel(FinishedTransferStore *finishedTransfers, QObject *parent) :
     QTransfersModel(QTransfersModel::TYPE_FINISHED, parent)
 {
-    int numTransfers = finishedTransfers.size();
-    if (numTransfers)
-    {
-        beginInsertRows(QModelIndex(), 0, numTransfers - 1);
-        for (int i = 0; i < numTransfers; i++)
-        {
-            MegaTransfer *transfer = finishedTransfers.at(i);
-            TransferItemData *item = new TransferItemData();
-            item->tag = transfer->getTag();
-            item->priority = transfer->getPriority();
-            transfers.insert(item->tag, item);
-            transferOrder.push_front(item);
-        }
-        endInsertRows();
-    }
+    this->finishedTransfers = finishedTransfers;
+    finishedTransfers->setListener(this);
 }
 
-void QFinishedTransfersModel::insertTransfer(MegaTransfer *transfer)
+QFinishedTransfersModel::~QFinishedTransfersModel()
 {
-    TransferItemData *item = new TransferItemData();
-    item->tag = transfer->getTag();
-    item->priority = transfer->getPriority();
+    finishedTransfers->removeListener(this);
+}
 
-    if (transfers.size() == Preferences::MAX_COMPLETED_ITEMS)
+QModelIndex QFinishedTransfersModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent))
     {
-        TransferItemData *t = transferOrder.back();
-        int row = transferOrder.size() - 1;
-        beginRemoveRows(QModelIndex(), row, row);
-        transfers.remove(t->tag);
-        transferOrder.pop_back();
-        transferItems.remove(t->tag);
-        endRemoveRows();
-        delete t;
+        return QModelIndex();
     }
 
-    transfer_it it = transferOrder.begin();
-    int row = 0;
-
-    beginInsertRows(QModelIndex(), row, row);
-    transfers.insert(item->tag, item);
-    transferOrder.insert(it, item);
-    endInsertRows();
+    return createIndex(row, column, finishedTransfers->tagAt(row));
+}
 
-    if (transferOrder.size() == 1)
+int QFinishedTransfersModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
     {
-        emit onTransferAdded();
+        return 0;
     }
+    return finishedTransfers->size();
 }
 
 void QFinishedTransfersModel::removeTransferByTag(int transferTag)
 {
-    TransferItemData *item =  transfers.value(transferTag);
-    if (!item)
-    {
-        return;
-    }
-
-    int row = 0;
-    transfer_it it;
-    for (it = transferOrder.begin(); it != transferOrder.end() && (*it)->tag != transferTag; ++it)
-    {
-        ++row;
-    }
-    assert(row < transferOrder.size());
-
-    beginRemoveRows(QModelIndex(), row, row);
-    transfers.remove(transferTag);
-    transferOrder.erase(it);
     ((MegaApplication *)qApp)->removeFinishedTransfer(transferTag);
-    transferItems.remove(transferTag);
-    endRemoveRows();
-    delete item;
-
-    if (transfers.isEmpty())
-    {
-        emit noTransfers();
-    }
 }
 
 void QFinishedTransfersModel::removeAllTransfers()
 {
-    if (transfers.size())
+    // noTransfers() is emitted by onFinishedTransfersRemoved()
+    ((MegaApplication *)qApp)->removeAllFinishedTransfers();
+}
+
+const FinishedTransfer *QFinishedTransfersModel::getFinishedTransferByTag(int tag)
+{
+    return finishedTransfers->get(tag);
+}
+
+bool QFinishedTransfersModel::getRowData(int tag, TransferRowData *row)
+{
+    const FinishedTransfer *transfer = finishedTransfers->get(tag);
+    if (!transfer)
     {
-        beginRemoveRows(QModelIndex(), 0, transfers.size() - 1);
-        qDeleteAll(transfers);
-        transfers.clear();
-        transferOrder.clear();
-        transferItems.clear();
-        endRemoveRows();
+        return false;
     }
 
-    ((MegaApplication *)qApp)->removeAllFinishedTransfers();
-    emit noTransfers();
+    row->type = transfer->type;
+    row->state = transfer->state;
+    row->syncTransfer = transfer->syncTransfer;
+    row->fileName = transfer->fileName;
+    row->totalBytes = qMax(transfer->totalBytes, 0LL);
+    row->transferredBytes = qBound(0LL, transfer->transferredBytes, row->totalBytes);
+    row->speed = qMax(transfer->speed, 0LL);
+    row->meanSpeed = transfer->meanSpeed;
+    row->finishedTime = transfer->updateTime;
+    return true;
 }
 
-MegaTransfer *QFinishedTransfersModel::getTransferByTag(int tag)
+void QFinishedTransfersModel::onFinishedTransferAboutToBeAdded()
 {
-    return ((MegaApplication *)qApp)->getFinishedTransferByTag(tag);
+    beginInsertRows(QModelIndex(), 0, 0);
 }
 
-void QFinishedTransfersModel::onTransferFinish(MegaApi *, MegaTransfer *transfer, MegaError *)
+void QFinishedTransfersModel::onFinishedTransferAdded()
 {
-    if (transfer->getState() == MegaTransfer::STATE_COMPLETED || transfer->getState() == MegaTransfer::STATE_FAILED)
+    endInsertRows();
+
+    if (finishedTransfers->size() == 1)
     {
-        insertTransfer(transfer);
+        emit onTransferAdded();
     }
 }
 
-void QFinishedTransfersModel::refreshTransferItem(int tag)
+void QFinishedTransfersModel::onFinishedTransfersAboutToBeRemoved(int firstRow, int lastRow)
 {
-    int row = 0;
-    for (transfer_it it = transferOrder.begin(); it != transferOrder.end() && (*it)->tag != tag; ++it)
+    beginRemoveRows(QModelIndex(), firstRow, lastRow);
+}
+
+void QFinishedTransfersModel::onFinishedTransfersRemoved(int tag)
+{
+    if (tag < 0 || tag == hoveredTag)
     {
-        ++row;
+        hoveredTag = 0;
     }
+    endRemoveRows();
 
-    assert(row < transferOrder.size());
-    if (row >= transferOrder.size())
+    if (!finishedTransfers->size())
+    {
+        emit noTransfers();
+    }
+}
+
+void QFinishedTransfersModel::refreshTransferItem(int tag)
+{
+    int row = finishedTransfers->rowOf(tag);
+    assert(row >= 0);
+    if (row < 0)
     {
         return;
     }
@@ -2,29 +2,35 @@
 #define QFINISHEDTRANSFERSMODEL_H
 
 #include <QAbstractItemModel>
-#include <QCache>
-#include "TransferItem.h"
 #include <megaapi.h>
 #include "QTMegaTransferListener.h"
-#include <deque>
 #include "QTransfersModel.h"
+#include "control/FinishedTransfers.h"
 
-class QFinishedTransfersModel : public QTransfersModel
+// Rows of the finished transfers kept by MegaApplication, newest first
+class QFinishedTransfersModel : public QTransfersModel, public FinishedTransferListener
 {
     Q_OBJECT
 
 public:
-    explicit QFinishedTransfersModel(QList<mega::MegaTransfer *>finishedTransfers, QObject *parent = 0);
-    void setupModelTransfers();
+    explicit QFinishedTransfersModel(FinishedTransferStore *finishedTransfers, QObject *parent = 0);
+    virtual ~QFinishedTransfersModel();
+
+    virtual QModelIndex index(int row, int column, const QModelIndex &parent) const;
+    virtual int rowCount(const QModelIndex &parent) const;
+
     void removeTransferByTag(int transferTag);
     void removeAllTransfers();
+    const FinishedTransfer *getFinishedTransferByTag(int tag);
+    virtual bool getRowData(int tag, TransferRowData *row);
 
-    virtual mega::MegaTransfer *getTransferByTag(int tag);
-
-    virtual void onTransferFinish(mega::MegaApi* api, mega::MegaTransfer *transfer, mega::MegaError* e);
+    virtual void onFinishedTransferAboutToBeAdded();
+    virtual void onFinishedTransferAdded();
+    virtual void onFinishedTransfersAboutToBeRemoved(int firstRow, int lastRow);
+    virtual void onFinishedTransfersRemoved(int tag);
 
 protected:
-    void insertTransfer(mega::MegaTransfer *transfer);
+    FinishedTransferStore *finishedTransfers;
 
 private slots:
     void refreshTransferItem(int tag);
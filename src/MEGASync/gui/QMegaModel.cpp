@@ -5,6 +5,8 @@
 
 using namespace mega;
 
+const int QMegaModel::CHILDREN_PAGE_SIZE = 500;
+
 QMegaModel::QMegaModel(mega::MegaApi *megaApi, QObject *parent) :
     QAbstractItemModel(parent)
 {
@@ -13,21 +15,21 @@ QMegaModel::QMegaModel(mega::MegaApi *megaApi, QObject *parent) :
     this->rootItem = new MegaItem(root);
     this->folderIcon =  QIcon(QString::fromAscii("://images/small_folder.png"));
 
-    MegaUserList *contacts = megaApi->getContacts();
-    for (int i = 0; i < contacts->size(); i++)
+    MegaShareList *inShares = megaApi->getInSharesList();
+    for (int i = 0; i < inShares->size(); i++)
     {
-        MegaUser *contact = contacts->get(i);
-        MegaNodeList *folders = megaApi->getInShares(contact);
-        for (int j = 0; j < folders->size(); j++)
+        MegaShare *share = inShares->get(i);
+        MegaNode *folder = megaApi->getNodeByHandle(share->getNodeHandle());
+        if (!folder)
         {
-            MegaNode *folder = folders->get(j)->copy();
-            ownNodes.append(folder);
-            inshareItems.append(new MegaItem(folder));
-            inshareOwners.append(QString::fromUtf8(contact->getEmail()));
+            continue;
         }
-        delete folders;
+
+        ownNodes.append(folder);
+        inshareItems.append(new MegaItem(folder));
+        inshareOwners.append(QString::fromUtf8(share->getUser()));
     }
-    delete contacts;
+    delete inShares;
 
     this->requiredRights = MegaShare::ACCESS_READ;
     this->displayFiles = false;
@@ -62,7 +64,16 @@ QVariant QMegaModel::data(const QModelIndex &index, int role) const
                 return folderIcon;
             }
 
-            return QIcon(Utilities::getExtensionPixmapSmall(QString::fromUtf8(node->getName())));
+            QString resource = Utilities::getExtensionPixmapSmall(QString::fromUtf8(node->getName()));
+            QHash<QString, QIcon>::const_iterator it = fileIcons.constFind(resource);
+            if (it != fileIcons.constEnd())
+            {
+                return it.value();
+            }
+
+            QIcon icon(resource);
+            fileIcons.insert(resource, icon);
+            return icon;
         }
         case Qt::ForegroundRole:
         {
@@ -108,7 +119,7 @@ QModelIndex QMegaModel::index(int row, int column, const QModelIndex &parent) co
 
         if (!item->areChildrenSet())
         {
-            item->setChildren(megaApi->getChildren(item->getNode()));
+            setChildren(item);
         }
 
         return createIndex(row, column, item->getChild(row));
@@ -157,7 +168,7 @@ int QMegaModel::rowCount(const QModelIndex &parent) const
         MegaItem *item = (MegaItem *)parent.internalPointer();
         if (!item->areChildrenSet())
         {
-            item->setChildren(megaApi->getChildren(item->getNode()));
+            setChildren(item);
         }
 
         return item->getNumChildren();
@@ -166,6 +177,43 @@ int QMegaModel::rowCount(const QModelIndex &parent) const
     return inshareItems.size() + 1;
 }
 
+bool QMegaModel::hasChildren(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+    {
+        return true;
+    }
+
+    // Ask the SDK instead of getting the children of every folder that is shown
+    MegaItem *item = (MegaItem *)parent.internalPointer();
+    if (item->areChildrenSet())
+    {
+        return item->getNumChildren() || item->getNumUnloadedChildren();
+    }
+
+    if (displayFiles)
+    {
+        return megaApi->getNumChildren(item->getNode()) > 0;
+    }
+    return megaApi->getNumChildFolders(item->getNode()) > 0;
+}
+
+bool QMegaModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+    {
+        return false;
+    }
+
+    MegaItem *item = (MegaItem *)parent.internalPointer();
+    return item->areChildrenSet() && item->getNumUnloadedChildren() > 0;
+}
+
+void QMegaModel::fetchMore(const QModelIndex &parent)
+{
+    loadChildren(parent, CHILDREN_PAGE_SIZE);
+}
+
 void QMegaModel::setRequiredRights(int requiredRights)
 {
     this->requiredRights = requiredRights;
@@ -189,7 +237,23 @@ void QMegaModel::showFiles(bool show)
 QModelIndex QMegaModel::insertNode(MegaNode *node, const QModelIndex &parent)
 {
     MegaItem *item = (MegaItem *)parent.internalPointer();
+    if (!item->areChildrenSet())
+    {
+        setChildren(item);
+    }
+
+    // The SDK could already include it in the children
+    if (item->indexOf(node) >= 0)
+    {
+        ownNodes.append(node);
+        return findIndex(node, parent);
+    }
+
     int index = item->insertPosition(node);
+    if (index > item->getNumChildren())
+    {
+        loadChildren(parent, index - item->getNumChildren());
+    }
 
     beginInsertRows(parent, index, index);
     item->insertNode(node, index);
@@ -207,12 +271,86 @@ void QMegaModel::removeNode(QModelIndex &item)
         return;
     }
     int index = parent->indexOf((MegaItem *)item.internalPointer());
+    if (index < 0)
+    {
+        return;
+    }
 
     beginRemoveRows(item.parent(), index, index);
     parent->removeNode(node);
     endRemoveRows();
 }
 
+QModelIndex QMegaModel::findIndex(MegaNode *node, const QModelIndex &parent)
+{
+    if (!node)
+    {
+        return QModelIndex();
+    }
+
+    if (!parent.isValid())
+    {
+        if (rootItem->getNode() && rootItem->getNode()->getHandle() == node->getHandle())
+        {
+            return index(0, 0);
+        }
+
+        for (int i = 0; i < inshareItems.size(); i++)
+        {
+            if (inshareItems.at(i)->getNode()->getHandle() == node->getHandle())
+            {
+                return index(i + 1, 0);
+            }
+        }
+        return QModelIndex();
+    }
+
+    MegaItem *item = (MegaItem *)parent.internalPointer();
+    if (!item->areChildrenSet())
+    {
+        setChildren(item);
+    }
+
+    int row = item->indexOf(node);
+    if (row < 0)
+    {
+        return QModelIndex();
+    }
+
+    if (row >= item->getNumChildren())
+    {
+        loadChildren(parent, qMax(CHILDREN_PAGE_SIZE, row + 1 - item->getNumChildren()));
+    }
+    return index(row, 0, parent);
+}
+
+void QMegaModel::setChildren(MegaItem *item) const
+{
+    // Only the first page is shown, the rest is loaded by fetchMore()
+    item->setChildren(megaApi->getChildren(item->getNode(), MegaApi::ORDER_NONE));
+    item->loadChildren(CHILDREN_PAGE_SIZE);
+}
+
+void QMegaModel::loadChildren(const QModelIndex &parent, int count)
+{
+    MegaItem *item = (MegaItem *)parent.internalPointer();
+    if (!item)
+    {
+        return;
+    }
+
+    count = qMin(count, item->getNumUnloadedChildren());
+    if (count <= 0)
+    {
+        return;
+    }
+
+    int first = item->getNumChildren();
+    beginInsertRows(parent, first, first + count - 1);
+    item->loadChildren(count);
+    endInsertRows();
+}
+
 MegaNode *QMegaModel::getNode(const QModelIndex &index)
 {
     MegaItem *item = (MegaItem *)index.internalPointer();
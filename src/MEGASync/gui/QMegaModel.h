@@ -3,6 +3,7 @@
 
 #include <QAbstractItemModel>
 #include <QList>
+#include <QHash>
 #include <QIcon>
 #include "MegaItem.h"
 #include <megaapi.h>
@@ -18,6 +19,9 @@ public:
     virtual QModelIndex index(int row, int column, const QModelIndex & parent = QModelIndex()) const;
     virtual QModelIndex parent(const QModelIndex & index) const;
     virtual int rowCount(const QModelIndex & parent = QModelIndex()) const;
+    virtual bool hasChildren(const QModelIndex & parent = QModelIndex()) const;
+    virtual bool canFetchMore(const QModelIndex & parent) const;
+    virtual void fetchMore(const QModelIndex & parent);
 
     void setRequiredRights(int requiredRights);
     void setDisableFolders(bool option);
@@ -25,11 +29,19 @@ public:
     QModelIndex insertNode(mega::MegaNode *node, const QModelIndex &parent);
     void removeNode(QModelIndex &item);
 
+    // Index of a child of parent, loading it if it isn't loaded yet
+    QModelIndex findIndex(mega::MegaNode *node, const QModelIndex &parent);
+
     mega::MegaNode *getNode(const QModelIndex &index);
 
     virtual ~QMegaModel();
 
+    static const int CHILDREN_PAGE_SIZE;
+
 protected:
+    void setChildren(MegaItem *item) const;
+    void loadChildren(const QModelIndex &parent, int count);
+
     mega::MegaApi *megaApi;
     mega::MegaNode *root;
     MegaItem *rootItem;
@@ -37,6 +49,7 @@ protected:
     QStringList inshareOwners;
     QList<mega::MegaNode *> ownNodes;
     QIcon folderIcon;
+    mutable QHash<QString, QIcon> fileIcons;    ///< By resource of the extension
     int requiredRights;
     bool displayFiles;
     bool disableFolders;
@@ -3,12 +3,54 @@
 
 using namespace mega;
 
+TransferRowData::TransferRowData()
+{
+    type = 0;
+    state = 0;
+    syncTransfer = false;
+    totalBytes = 0;
+    transferredBytes = 0;
+    speed = 0;
+    meanSpeed = 0;
+    finishedTime = 0;
+}
+
+TransferRowData::TransferRowData(MegaTransfer *transfer)
+{
+    type = transfer->getType();
+    syncTransfer = transfer->isSyncTransfer();
+    fileName = QString::fromUtf8(transfer->getFileName());
+    finishedTime = 0;
+    update(transfer);
+}
+
+void TransferRowData::update(MegaTransfer *transfer)
+{
+    state = transfer->getState();
+    totalBytes = qMax(transfer->getTotalBytes(), 0LL);
+    transferredBytes = qBound(0LL, transfer->getTransferredBytes(), totalBytes);
+    speed = qMax(transfer->getSpeed(), 0LL);
+    meanSpeed = transfer->getMeanSpeed();
+}
+
+TransferItemData::TransferItemData()
+{
+    tag = 0;
+    priority = 0;
+    row = NULL;
+}
+
+TransferItemData::~TransferItemData()
+{
+    delete row;
+}
+
 QTransfersModel::QTransfersModel(int type, QObject *parent) :
     QAbstractItemModel(parent)
 {
     this->type = type;
     this->megaApi = ((MegaApplication *)qApp)->getMegaApi();
-    this->transferItems.setMaxCost(16);
+    this->hoveredTag = 0;
 }
 
 int QTransfersModel::columnCount(const QModelIndex &parent) const
@@ -18,7 +60,7 @@ int QTransfersModel::columnCount(const QModelIndex &parent) const
 
 QVariant QTransfersModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid() || (index.row() < 0 || transfers.count() <= index.row()))
+    if (!index.isValid() || (index.row() < 0 || rowCount(QModelIndex()) <= index.row()))
     {
         return QVariant();
     }
@@ -43,14 +85,15 @@ QModelIndex QTransfersModel::index(int row, int column, const QModelIndex &paren
         return QModelIndex();
     }
 
-    return createIndex(row, column, transferOrder[row]->tag);
+    return createIndex(row, column, transferOrder.at(row)->tag);
 }
 
 void QTransfersModel::refreshTransfers()
 {
-    if (transferOrder.size())
+    int rows = rowCount(QModelIndex());
+    if (rows)
     {
-        emit dataChanged(index(0, 0, QModelIndex()), index(transferOrder.size() - 1, 0, QModelIndex()));
+        emit dataChanged(index(0, 0, QModelIndex()), index(rows - 1, 0, QModelIndex()));
     }
 }
 
@@ -63,6 +106,30 @@ int QTransfersModel::rowCount(const QModelIndex &parent) const
     return transferOrder.size();
 }
 
+void QTransfersModel::setHoveredTransfer(int tag)
+{
+    if (tag == hoveredTag)
+    {
+        return;
+    }
+
+    int previousTag = hoveredTag;
+    hoveredTag = tag;
+    if (previousTag)
+    {
+        refreshTransferItem(previousTag);
+    }
+    if (tag)
+    {
+        refreshTransferItem(tag);
+    }
+}
+
+int QTransfersModel::getHoveredTransfer()
+{
+    return hoveredTag;
+}
+
 int QTransfersModel::getModelType()
 {
     return type;
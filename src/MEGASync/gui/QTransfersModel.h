@@ -2,21 +2,42 @@
 #define QTRANSFERSMODEL_H
 
 #include <QAbstractItemModel>
-#include <QCache>
-#include "TransferItem.h"
 #include <megaapi.h>
 #include "QTMegaTransferListener.h"
-#include <deque>
+#include "TransferOrder.h"
+
+// What is painted in the row of a transfer
+class TransferRowData
+{
+public:
+    TransferRowData();
+    explicit TransferRowData(mega::MegaTransfer *transfer);
+
+    // Updates the progress and the state
+    void update(mega::MegaTransfer *transfer);
+
+    int type;
+    int state;
+    bool syncTransfer;
+    QString fileName;
+    long long totalBytes;
+    long long transferredBytes;
+    long long speed;
+    long long meanSpeed;
+    long long finishedTime;     ///< Deciseconds, in SDK time. Only for finished transfers
+};
 
 class TransferItemData
 {
 public:
+    TransferItemData();
+    ~TransferItemData();
+
     int tag;
     unsigned long long priority;
+    TransferRowData *row;       ///< Loaded the first time the row is painted or updated
 };
 
-typedef std::deque<TransferItemData*>::iterator transfer_it;
-
 class QTransfersModel : public QAbstractItemModel, public mega::MegaTransferListener
 {
     Q_OBJECT
@@ -41,9 +62,14 @@ public:
 
     virtual void removeTransferByTag(int transferTag) = 0;
     virtual void removeAllTransfers() = 0;
-    virtual mega::MegaTransfer *getTransferByTag(int tag) = 0;
 
-    QCache<int, TransferItem> transferItems;
+    // Copies the row of a transfer, returns false if the transfer isn't in the model
+    virtual bool getRowData(int tag, TransferRowData *row) = 0;
+
+    // Transfer under the mouse (0 for none), its row shows the cancel button
+    void setHoveredTransfer(int tag);
+    int getHoveredTransfer();
+
     mega::MegaApi *megaApi;
 
 signals:
@@ -55,8 +81,9 @@ private slots:
 
 protected:
     QMap<int, TransferItemData*> transfers;
-    std::deque<TransferItemData*> transferOrder;
+    TransferOrder transferOrder;
     int type;
+    int hoveredTag;
 };
 
 #endif // QTRANSFERSMODEL_H
@@ -1497,6 +1497,9 @@ int SettingsDialog::saveSettings()
             preferences->disableOverlayIcons(ui->cOverlayIcons->isChecked());
             #ifdef Q_OS_MACX
             Platform::notifyRestartSyncFolders();
+            #elif defined(Q_OS_LINUX)
+            // The extensions drop their cached states and ask for them again
+            Platform::notifyRestartSyncFolders();
             #else
             for (int i = 0; i < preferences->getNumSyncedFolders(); i++)
             {
@@ -1,543 +1,390 @@
 #include "TransferItem.h"
-#include "ui_TransferItem.h"
-#include <QMouseEvent>
+#include <QIcon>
+#include <QDateTime>
+#include <QFontMetrics>
 #include "megaapi.h"
 #include "control/Utilities.h"
 #include "Preferences.h"
 
 using namespace mega;
 
-TransferItem::TransferItem(QWidget *parent) :
-    QWidget(parent),
-    ui(new Ui::TransferItem)
+TransferItem::TransferItem(QObject *parent) :
+    QObject(parent)
 {
-    ui->setupUi(this);
-
-    type = -1;
-    totalSize = 0;
-    totalTransferredBytes = 0;
-    transferSpeed = 0;
-    meanTransferSpeed = 0;
-    regular = false;
-    cancelButtonEnabled = false;
-    isSyncTransfer = false;
-    animation = NULL;
-    priority = 0;
-    transferState = 0;
-    transferTag = 0;
-    dsFinishedTime = 0;
-
-    // Choose the right icon for initial load (hdpi/normal displays)
-    qreal ratio = 1.0;
-#if QT_VERSION >= 0x050000
-    ratio = qApp->testAttribute(Qt::AA_UseHighDpiPixmaps) ? devicePixelRatio() : 1.0;
+    nameFont.setFamily(QString::fromUtf8("Source Sans Pro"));
+    totalFont.setFamily(QString::fromUtf8("Source Sans Pro"));
+    timeFont.setFamily(QString::fromUtf8("Source Sans Pro"));
+#if defined(WIN32) || defined(__APPLE__)
+    nameFont.setPixelSize(16);
+    totalFont.setPixelSize(13);
+#else
+    nameFont.setPixelSize(14);
+    totalFont.setPixelSize(11);
 #endif
-    loadIconResource = QPixmap(ratio < 2 ? QString::fromUtf8(":/images/cloud_item_ico.png")
-                                         : QString::fromUtf8(":/images/cloud_item_ico@2x.png"));
-    ui->lActionType->setPixmap(loadIconResource);
-
-    ui->lCancelTransfer->installEventFilter(this);
-    ui->lCancelTransferCompleted->installEventFilter(this);
-    update();
-}
-
-void TransferItem::setFileName(QString fileName)
-{
-    this->fileName = fileName;
-    QFont f = ui->lTransferName->font();
-    QFontMetrics fm = QFontMetrics(f);
-    ui->lTransferNameCompleted->setText(fm.elidedText(fileName, Qt::ElideMiddle, ui->lTransferNameCompleted->width()));
-    ui->lTransferNameCompleted->setToolTip(fileName);
-    ui->lTransferName->setText(fm.elidedText(fileName, Qt::ElideMiddle, ui->lTransferName->width()));
-    ui->lTransferName->setToolTip(fileName);
-
-    QIcon icon;
-    icon.addFile(Utilities::getExtensionPixmapSmall(fileName), QSize(), QIcon::Normal, QIcon::Off);
-    ui->lFileType->setIcon(icon);
-    ui->lFileType->setIconSize(QSize(20, 22));
-    ui->lFileTypeCompleted->setIcon(icon);
-    ui->lFileTypeCompleted->setIconSize(QSize(20, 22));
+    timeFont.setPixelSize(10);
+
+    uploadPixmap = QIcon(QString::fromUtf8(":/images/upload_item_ico.png")).pixmap(QSize(12, 12));
+    downloadPixmap = QIcon(QString::fromUtf8(":/images/download_item_ico.png")).pixmap(QSize(12, 12));
+    completedPixmap = QIcon(QString::fromUtf8(":/images/completed_item_ico.png")).pixmap(QSize(12, 12));
+    failedPixmap = QIcon(QString::fromUtf8(":/images/import_error_ico.png")).pixmap(QSize(12, 12));
+    cancelPixmap = QIcon(QString::fromUtf8(":/images/clear_item_ico.png")).pixmap(QSize(12, 12));
+    cloudPixmap = loadPixmap(QString::fromUtf8("cloud_item_ico"));
+    syncPixmap = loadPixmap(QString::fromUtf8("sync_item_ico"));
+
+    bool hdpi = Utilities::getDevicePixelRatio() >= 2;
+    uploading = new QMovie(hdpi ? QString::fromUtf8(":/images/uploading@2x.gif")
+                                : QString::fromUtf8(":/images/uploading.gif"), QByteArray(), this);
+    downloading = new QMovie(hdpi ? QString::fromUtf8(":/images/downloading@2x.gif")
+                                  : QString::fromUtf8(":/images/downloading.gif"), QByteArray(), this);
+    synching = new QMovie(hdpi ? QString::fromUtf8(":/images/synching@2x.gif")
+                               : QString::fromUtf8(":/images/synching.gif"), QByteArray(), this);
+    connect(uploading, SIGNAL(frameChanged(int)), this, SLOT(frameChanged(int)));
+    connect(downloading, SIGNAL(frameChanged(int)), this, SLOT(frameChanged(int)));
+    connect(synching, SIGNAL(frameChanged(int)), this, SLOT(frameChanged(int)));
 }
 
-QString TransferItem::getFileName()
+void TransferItem::paint(QPainter *painter, const QRect &rect, const TransferRowData &row, bool hovered, bool paused)
 {
-    return fileName;
-}
-
-QString TransferItem::getTransferName()
-{
-    if (ui->sTransferState->currentWidget() == ui->stateCompleted)
+    painter->save();
+    painter->translate(rect.topLeft());
+    painter->setClipRect(QRect(0, 0, rect.width(), rect.height()));
+    if (isFinished(row))
     {
-        return ui->lTransferNameCompleted->text();
+        paintFinished(painter, row, hovered);
     }
     else
     {
-        return ui->lTransferName->text();
+        paintActive(painter, row, hovered, paused);
     }
+    painter->restore();
 }
 
-void TransferItem::setTransferredBytes(long long totalTransferredBytes, bool cancellable)
+bool TransferItem::cancelButtonClicked(const TransferRowData &row, bool hovered, QPoint pos)
 {
-    this->totalTransferredBytes = totalTransferredBytes;
-    if (this->totalTransferredBytes < 0)
+    if (!isCancellable(row, hovered) || row.state == MegaTransfer::STATE_CANCELLED)
     {
-        this->totalTransferredBytes = 0;
-    }
-    if (this->totalTransferredBytes > this->totalSize)
-    {
-        this->totalTransferredBytes = this->totalSize;
+        return false;
     }
-    regular = cancellable;
+
+    QRect cancelRect = isFinished(row) ? QRect(725, 18, 12, 12) : QRect(740, 18, 12, 12);
+    return cancelRect.contains(pos);
 }
 
-void TransferItem::setSpeed(long long transferSpeed, long long meanSpeed)
+QString TransferItem::getTransferName(const TransferRowData &row)
 {
-    if (transferSpeed < 0)
-    {
-        this->transferSpeed = 0;
-    }
-    else
-    {
-        this->transferSpeed = transferSpeed;
-    }
-    meanTransferSpeed = meanSpeed;
+    QFontMetrics fm(nameFont);
+    return fm.elidedText(row.fileName, Qt::ElideMiddle, isFinished(row) ? 380 : 320);
 }
 
-void TransferItem::setTotalSize(long long size)
+QSize TransferItem::sizeHint() const
 {
-    this->totalSize = size;
-    if (this->totalSize < 0)
-    {
-        this->totalSize = 0;
-    }
-    if (this->totalTransferredBytes > this->totalSize)
+    return QSize(800, 48);
+}
+
+void TransferItem::frameChanged(int)
+{
+    // Animations stop when no row has shown them since the previous frame
+    QMovie *animation = (QMovie *)sender();
+    if (!paintedAnimations.remove(animation))
     {
-        this->totalTransferredBytes = this->totalSize;
+        animation->stop();
+        return;
     }
+
+    emit animationFrameChanged();
 }
 
-void TransferItem::setFinishedTime(long long time)
+bool TransferItem::isFinished(const TransferRowData &row)
 {
-    dsFinishedTime = time;
+    return row.state == MegaTransfer::STATE_COMPLETED || row.state == MegaTransfer::STATE_FAILED;
 }
 
-void TransferItem::setStateLabel(QString labelState)
+bool TransferItem::isCancellable(const TransferRowData &row, bool hovered)
 {
-    ui->lSpeed->setText(QString::fromUtf8("(%1)").arg(labelState));
-    ui->lRemainingTime->setText(QString::fromUtf8(""));
+    // Active sync transfers can't be cancelled
+    return hovered && (!row.syncTransfer || isFinished(row));
 }
 
-void TransferItem::setType(int type, bool isSyncTransfer)
+void TransferItem::paintActive(QPainter *painter, const TransferRowData &row, bool hovered, bool paused)
 {
-    this->type = type;
-    this->isSyncTransfer = isSyncTransfer;
-    QIcon icon;
+    drawIcon(painter, QRect(27, 12, 12, 12), row.type == MegaTransfer::TYPE_UPLOAD ? uploadPixmap : downloadPixmap);
+    drawIcon(painter, QRect(45, 7, 20, 22), getFileTypePixmap(row.fileName));
 
-    qreal ratio = 1.0;
-#if QT_VERSION >= 0x050000
-    ratio = qApp->testAttribute(Qt::AA_UseHighDpiPixmaps) ? devicePixelRatio() : 1.0;
-#endif
+    painter->setFont(nameFont);
+    painter->setPen(QColor(0x33, 0x33, 0x33));
+    painter->drawText(QRect(69, 0, 320, 36), Qt::AlignLeft | Qt::AlignVCenter, getTransferName(row));
 
-    if (isSyncTransfer)
-    {
-        this->loadIconResource = QPixmap(ratio < 2 ? QString::fromUtf8(":/images/sync_item_ico.png")
-                                                   : QString::fromUtf8(":/images/sync_item_ico@2x.png"));
-        delete animation;
-        animation = new QMovie(ratio < 2 ? QString::fromUtf8(":/images/synching.gif")
-                                         : QString::fromUtf8(":/images/synching@2x.gif"));
-        connect(animation, SIGNAL(frameChanged(int)), this, SLOT(frameChanged(int)));
-    }
-    else
+    QString total = Utilities::getSizeString(row.totalBytes);
+    if (row.transferredBytes)
     {
-        this->loadIconResource = QPixmap(ratio < 2 ? QString::fromUtf8(":/images/cloud_item_ico.png")
-                                                   : QString::fromUtf8(":/images/cloud_item_ico@2x.png"));
+        total = QString::fromUtf8("%1<span style=\"color:#777777; text-decoration:none;\">&nbsp;&nbsp;of&nbsp;&nbsp;</span>%2")
+                .arg(Utilities::getSizeString(row.transferredBytes)).arg(total);
     }
-    ui->lActionTypeCompleted->setPixmap(loadIconResource);
-    ui->lActionType->setPixmap(loadIconResource);
+    painter->setFont(totalFont);
+    drawRichText(painter, QRect(397, 0, 150, 36), total, QColor(0x33, 0x33, 0x33), Qt::AlignRight | Qt::AlignVCenter);
 
-    switch (type)
-    {
-        case MegaTransfer::TYPE_UPLOAD:
+    painter->setPen(QColor(0xaa, 0xaa, 0xaa));
+    painter->drawText(QRect(549, 0, 84, 36), Qt::AlignRight | Qt::AlignVCenter, getSpeedString(row, paused));
 
-            if (!isSyncTransfer)
-            {
-                delete animation;
-                animation = new QMovie(ratio < 2 ? QString::fromUtf8(":/images/uploading.gif")
-                                                 : QString::fromUtf8(":/images/uploading@2x.gif"));
-                connect(animation, SIGNAL(frameChanged(int)), this, SLOT(frameChanged(int)));
-            }
-
-            icon.addFile(QString::fromUtf8(":/images/upload_item_ico.png"), QSize(), QIcon::Normal, QIcon::Off);
-            ui->pbTransfer->setStyleSheet(QString::fromUtf8("QProgressBar#pbTransfer{background-color: #ececec;}"
-                                                            "QProgressBar#pbTransfer::chunk {background-color: #2ba6de;}"));
-            break;
-        case MegaTransfer::TYPE_DOWNLOAD:
+    // Progress bar
+    int permil = (row.totalBytes > 0) ? ((1000 * row.transferredBytes) / row.totalBytes) : 0;
+    QRect progressRect(25, 36, 608, 2);
+    painter->fillRect(progressRect, QColor(0xec, 0xec, 0xec));
+    progressRect.setWidth(progressRect.width() * permil / 1000);
+    painter->fillRect(progressRect, row.type == MegaTransfer::TYPE_UPLOAD ? QColor(0x2b, 0xa6, 0xde) : QColor(0x31, 0xb5, 0x00));
 
-            if (!isSyncTransfer)
-            {
-                delete animation;
-                animation = new QMovie(ratio < 2 ? QString::fromUtf8(":/images/downloading.gif")
-                                                 : QString::fromUtf8(":/images/downloading@2x.gif"));
-                connect(animation, SIGNAL(frameChanged(int)), this, SLOT(frameChanged(int)));
-            }
+    drawIcon(painter, QRect(638, 8, 32, 32), getActionPixmap(row, paused));
+    drawRichText(painter, QRect(674, 0, 66, 48), getRemainingTimeString(row, paused), QColor(0x33, 0x33, 0x33), Qt::AlignLeft | Qt::AlignVCenter);
 
-            icon.addFile(QString::fromUtf8(":/images/download_item_ico.png"), QSize(), QIcon::Normal, QIcon::Off);
-            ui->pbTransfer->setStyleSheet(QString::fromUtf8("QProgressBar#pbTransfer{background-color: #ececec;}"
-                                                            "QProgressBar#pbTransfer::chunk {background-color: #31b500;}"));
-            break;
-        default:
-            break;
+    if (isCancellable(row, hovered))
+    {
+        drawIcon(painter, QRect(740, 18, 12, 12), cancelPixmap);
     }
-
-    ui->lTransferType->setIcon(icon);
-    ui->lTransferType->setIconSize(QSize(12, 12));
-    ui->lTransferTypeCompleted->setIcon(icon);
-    ui->lTransferTypeCompleted->setIconSize(QSize(12, 12));
 }
 
-int TransferItem::getType()
+void TransferItem::paintFinished(QPainter *painter, const TransferRowData &row, bool hovered)
 {
-    return type;
-}
+    drawIcon(painter, QRect(24, 18, 12, 12), row.type == MegaTransfer::TYPE_UPLOAD ? uploadPixmap : downloadPixmap);
+    drawIcon(painter, QRect(40, 13, 20, 22), getFileTypePixmap(row.fileName));
 
-void TransferItem::setPriority(unsigned long long priority)
-{
-    this->priority = priority;
-}
+    painter->setFont(nameFont);
+    painter->setPen(QColor(0x33, 0x33, 0x33));
+    painter->drawText(QRect(64, 5, 380, 38), Qt::AlignLeft | Qt::AlignVCenter, getTransferName(row));
 
-unsigned long long TransferItem::getPriority()
-{
-    return this->priority;
-}
+    drawIcon(painter, QRect(479, 18, 12, 12), row.state == MegaTransfer::STATE_COMPLETED ? completedPixmap : failedPixmap);
+    painter->setFont(totalFont);
+    painter->drawText(QRect(500, 5, 72, 38), Qt::AlignRight | Qt::AlignVCenter, Utilities::getSizeString(row.totalBytes));
 
-TransferItem::~TransferItem()
-{
-    delete ui;
-    delete animation;
-}
+    drawIcon(painter, QRect(585, 8, 32, 32), row.syncTransfer ? syncPixmap : cloudPixmap);
+    painter->setFont(timeFont);
+    painter->drawText(QRect(626, 0, 90, 48), Qt::AlignRight | Qt::AlignVCenter, getFinishedTimeString(row));
 
-int TransferItem::getTransferState()
-{
-    return transferState;
-}
-
-void TransferItem::setTransferState(int value)
-{
-    transferState = value;
-    switch (transferState)
+    if (isCancellable(row, hovered))
     {
-    case MegaTransfer::STATE_COMPLETED:
-    case MegaTransfer::STATE_FAILED:
-        finishTransfer();
-        break;
-    case MegaTransfer::STATE_CANCELLED:
-        break;
-    default:
-        updateTransfer();
-        break;
+        drawIcon(painter, QRect(725, 18, 12, 12), cancelPixmap);
     }
 }
-int TransferItem::getTransferTag()
-{
-    return transferTag;
-}
 
-void TransferItem::setTransferTag(int value)
-{
-    transferTag = value;
-}
-bool TransferItem::getRegular()
+void TransferItem::drawIcon(QPainter *painter, const QRect &rect, const QPixmap &pixmap)
 {
-    return regular;
-}
+    if (pixmap.isNull())
+    {
+        return;
+    }
 
-void TransferItem::setRegular(bool value)
-{
-    regular = value;
+    // Keep the size of the icon, centered in rect
+    QSize size = pixmap.size();
+#if QT_VERSION >= 0x050000
+    size /= pixmap.devicePixelRatio();
+#endif
+    size.scale(rect.size().boundedTo(size), Qt::KeepAspectRatio);
+    QRect target(QPoint(0, 0), size);
+    target.moveCenter(rect.center());
+    painter->drawPixmap(target, pixmap);
 }
 
-void TransferItem::finishTransfer()
+// Draws the text of a label with <span> parts in a lighter color, as built by Utilities::getTimeString
+void TransferItem::drawRichText(QPainter *painter, const QRect &rect, const QString &text, const QColor &color, int alignment)
 {
-    ui->sTransferState->setCurrentWidget(ui->stateCompleted);
-    if (transferState == MegaTransfer::STATE_COMPLETED)
+    QString spanEndTag = QString::fromUtf8("</span>");
+    QList<QPair<QString, bool> > parts;
+    int position = 0;
+    while (position < text.size())
     {
-        ui->lCompleted->setIcon(QIcon(QString::fromUtf8(":/images/completed_item_ico.png")));
+        int spanStart = text.indexOf(QString::fromUtf8("<span"), position);
+        if (spanStart < 0)
+        {
+            parts.append(qMakePair(text.mid(position), false));
+            break;
+        }
+
+        int contentStart = text.indexOf(QChar::fromAscii('>'), spanStart) + 1;
+        int spanEnd = text.indexOf(spanEndTag, contentStart);
+        if (!contentStart || spanEnd < 0)
+        {
+            parts.append(qMakePair(text.mid(position), false));
+            break;
+        }
+
+        parts.append(qMakePair(text.mid(position, spanStart - position), false));
+        parts.append(qMakePair(text.mid(contentStart, spanEnd - contentStart), true));
+        position = spanEnd + spanEndTag.size();
     }
-    else
+
+    QFontMetrics fm(painter->font());
+    int width = 0;
+    for (int i = 0; i < parts.size(); i++)
     {
-        ui->lCompleted->setIcon(QIcon(QString::fromUtf8(":/images/import_error_ico.png")));
+        parts[i].first.replace(QString::fromUtf8("&nbsp;"), QString::fromUtf8(" "));
+        parts[i].first.replace(QString::fromUtf8("&lt;"), QString::fromUtf8("<"));
+        width += fm.width(parts[i].first);
     }
-    ui->lCompleted->setIconSize(QSize(12, 12));
-    ui->lTotalCompleted->setText(QString::fromUtf8("%1").arg(Utilities::getSizeString(totalSize)));
 
+    int x = (alignment & Qt::AlignRight) ? (rect.right() + 1 - width) : rect.left();
+    for (int i = 0; i < parts.size(); i++)
+    {
+        const QString &part = parts.at(i).first;
+        int partWidth = fm.width(part);
+        painter->setPen(parts.at(i).second ? QColor(0x77, 0x77, 0x77) : color);
+        painter->drawText(QRect(x, rect.top(), partWidth, rect.height()), Qt::AlignLeft | Qt::AlignVCenter, part);
+        x += partWidth;
+    }
 }
 
-void TransferItem::updateTransfer()
+QString TransferItem::getSpeedString(const TransferRowData &row, bool paused)
 {
-    ui->sTransferState->setCurrentWidget(ui->stateActive);
-    switch (transferState)
+    if (paused)
     {
-        case MegaTransfer::STATE_ACTIVE:
-        {
-            // Update remaining time
-            long long remainingBytes = totalSize - totalTransferredBytes;
-            int totalRemainingSeconds = meanTransferSpeed ? remainingBytes / meanTransferSpeed : 0;
-
-            QString remainingTime;
-            if (totalRemainingSeconds)
-            {
-                if (totalRemainingSeconds < 60)
-                {
-                    remainingTime = QString::fromUtf8("%1 <span style=\"color:#777777; text-decoration:none;\">m</span>").arg(QString::fromUtf8("&lt; 1"));
-                }
-                else
-                {
-                    remainingTime = Utilities::getTimeString(totalRemainingSeconds, false);
-                }
-            }
-            else
-            {
-                remainingTime = QString::fromAscii("");
-            }
-            ui->lRemainingTime->setText(remainingTime);
-
-            // Update current transfer speed
-            QString downloadString;
+        return QString::fromUtf8("(%1)").arg(tr("paused"));
+    }
 
-            if (!totalTransferredBytes)
-            {
-                downloadString = QString::fromUtf8("(%1)").arg(tr("starting"));
-            }
-            else
+    switch (row.state)
+    {
+        case MegaTransfer::STATE_ACTIVE:
+            if (!row.transferredBytes)
             {
-                QString pattern(QString::fromUtf8("(%1/s)"));
-                downloadString = pattern.arg(Utilities::getSizeString(transferSpeed));
+                return QString::fromUtf8("(%1)").arg(tr("starting"));
             }
-
-            ui->lSpeed->setText(downloadString);
-            break;
-        }
+            return QString::fromUtf8("(%1/s)").arg(Utilities::getSizeString(row.speed));
         case MegaTransfer::STATE_PAUSED:
-            ui->lSpeed->setText(QString::fromUtf8("(%1)").arg(tr("paused")));
-            ui->lRemainingTime->setText(QString::fromUtf8(""));
-            break;
+            return QString::fromUtf8("(%1)").arg(tr("paused"));
         case MegaTransfer::STATE_QUEUED:
-            ui->lSpeed->setText(QString::fromUtf8("(%1)").arg(tr("queued")));
-            ui->lRemainingTime->setText(QString::fromUtf8(""));
-            break;
+            return QString::fromUtf8("(%1)").arg(tr("queued"));
         case MegaTransfer::STATE_RETRYING:
-            ui->lSpeed->setText(QString::fromUtf8("(%1)").arg(tr("retrying")));
-            ui->lRemainingTime->setText(QString::fromUtf8(""));
-            break;
+            return QString::fromUtf8("(%1)").arg(tr("retrying"));
         case MegaTransfer::STATE_COMPLETING:
-            ui->lSpeed->setText(QString::fromUtf8("(%1)").arg(tr("completing")));
-            ui->lRemainingTime->setText(QString::fromUtf8(""));
-            break;
+            return QString::fromUtf8("(%1)").arg(tr("completing"));
         default:
-            ui->lSpeed->setText(QString::fromUtf8(""));
-            ui->lRemainingTime->setText(QString::fromUtf8(""));
-            break;
+            return QString();
+    }
+}
+
+QString TransferItem::getRemainingTimeString(const TransferRowData &row, bool paused)
+{
+    if (paused || row.state != MegaTransfer::STATE_ACTIVE || !row.meanSpeed)
+    {
+        return QString();
     }
 
-    // Update progress bar
-    unsigned int permil = (totalSize > 0) ? ((1000 * totalTransferredBytes) / totalSize) : 0;
-    ui->pbTransfer->setValue(permil);
+    long long remainingBytes = row.totalBytes - row.transferredBytes;
+    int totalRemainingSeconds = remainingBytes / row.meanSpeed;
+    if (!totalRemainingSeconds)
+    {
+        return QString();
+    }
 
-    // Update transferred bytes
-    ui->lTotal->setText(QString::fromUtf8("%1%2").arg(!totalTransferredBytes ? QString::fromUtf8(""): QString::fromUtf8("%1<span style=\"color:#777777; text-decoration:none;\">&nbsp;&nbsp;of&nbsp;&nbsp;</span>").arg(Utilities::getSizeString(totalTransferredBytes)))
-                        .arg(Utilities::getSizeString(totalSize)));
+    if (totalRemainingSeconds < 60)
+    {
+        return QString::fromUtf8("%1 <span style=\"color:#777777; text-decoration:none;\">m</span>").arg(QString::fromUtf8("&lt; 1"));
+    }
+    return Utilities::getTimeString(totalRemainingSeconds, false);
 }
 
-void TransferItem::updateFinishedTime()
+QString TransferItem::getFinishedTimeString(const TransferRowData &row)
 {
-    if (!dsFinishedTime)
+    if (!row.finishedTime)
     {
-        return;
+        return QString();
     }
 
     Preferences *preferences = Preferences::instance();
     QDateTime now = QDateTime::currentDateTime();
-    qint64 secs = ( now.toMSecsSinceEpoch() / 100 - (preferences->getMsDiffTimeWithSDK() + dsFinishedTime) ) / 10;
+    qint64 secs = ( now.toMSecsSinceEpoch() / 100 - (preferences->getMsDiffTimeWithSDK() + row.finishedTime) ) / 10;
     if (secs < 2)
     {
-        ui->lRemainingTimeCompleted->setText(tr("just now"));
+        return tr("just now");
     }
     else if (secs < 60)
     {
-        ui->lRemainingTimeCompleted->setText(tr("%1 seconds ago").arg(secs));
+        return tr("%1 seconds ago").arg(secs);
     }
     else if (secs < 3600)
     {
         int minutes = secs/60;
         if (minutes == 1)
         {
-            ui->lRemainingTimeCompleted->setText(tr("1 minute ago"));
-        }
-        else
-        {
-            ui->lRemainingTimeCompleted->setText(tr("%1 minutes ago").arg(minutes));
+            return tr("1 minute ago");
         }
+        return tr("%1 minutes ago").arg(minutes);
     }
     else if (secs < 86400)
     {
         int hours = secs/3600;
         if (hours == 1)
         {
-            ui->lRemainingTimeCompleted->setText(tr("1 hour ago"));
-        }
-        else
-        {
-            ui->lRemainingTimeCompleted->setText(tr("%1 hours ago").arg(hours));
+            return tr("1 hour ago");
         }
+        return tr("%1 hours ago").arg(hours);
     }
     else if (secs < 2592000)
     {
         int days = secs/86400;
         if (days == 1)
         {
-            ui->lRemainingTimeCompleted->setText(tr("1 day ago"));
-        }
-        else
-        {
-            ui->lRemainingTimeCompleted->setText(tr("%1 days ago").arg(days));
+            return tr("1 day ago");
         }
+        return tr("%1 days ago").arg(days);
     }
     else if (secs < 31536000)
     {
         int months = secs/2592000;
         if (months == 1)
         {
-            ui->lRemainingTimeCompleted->setText(tr("1 month ago"));
-        }
-        else
-        {
-            ui->lRemainingTimeCompleted->setText(tr("%1 months ago").arg(months));
+            return tr("1 month ago");
         }
+        return tr("%1 months ago").arg(months);
     }
-    else
+
+    int years = secs/31536000;
+    if (years == 1)
     {
-        int years = secs/31536000;
-        if (years == 1)
-        {
-            ui->lRemainingTimeCompleted->setText(tr("1 year ago"));
-        }
-        else
-        {
-            ui->lRemainingTimeCompleted->setText(tr("%1 years ago").arg(years));
-        }
+        return tr("1 year ago");
     }
+    return tr("%1 years ago").arg(years);
 }
 
-bool TransferItem::cancelButtonClicked(QPoint pos)
+const QPixmap &TransferItem::getFileTypePixmap(const QString &fileName)
 {
-    if (!cancelButtonEnabled)
-    {
-        return false;
-    }
-
-    switch (transferState)
+    QString resource = Utilities::getExtensionPixmapSmall(fileName);
+    QHash<QString, QPixmap>::iterator it = fileTypePixmaps.find(resource);
+    if (it == fileTypePixmaps.end())
     {
-    case MegaTransfer::STATE_COMPLETED:
-    case MegaTransfer::STATE_FAILED:
-        if (ui->lCancelTransferCompleted->rect().contains(ui->lCancelTransferCompleted->mapFrom(this, pos)))
-        {
-            return true;
-        }
-        break;
-    case MegaTransfer::STATE_CANCELLED:
-        break;
-    default:
-        if (ui->lCancelTransfer->rect().contains(ui->lCancelTransfer->mapFrom(this, pos)))
-        {
-            return true;
-        }
-        break;
+        it = fileTypePixmaps.insert(resource, QIcon(resource).pixmap(QSize(20, 22)));
     }
-
-    return false;
+    return it.value();
 }
 
-void TransferItem::mouseHoverTransfer(bool isHover)
+QPixmap TransferItem::getActionPixmap(const TransferRowData &row, bool paused)
 {
-    if (isHover)
+    if (!paused && row.state == MegaTransfer::STATE_ACTIVE)
     {
-        if (isSyncTransfer && !(transferState == MegaTransfer::STATE_COMPLETED || transferSpeed == MegaTransfer::STATE_FAILED))
+        QMovie *animation = getAnimation(row);
+        paintedAnimations.insert(animation);
+        if (animation->state() != QMovie::Running)
         {
-            ui->lCancelTransfer->installEventFilter(this);
-            ui->lCancelTransfer->update();
-            return;
+            animation->start();
         }
 
-        cancelButtonEnabled = true;
-        ui->lCancelTransfer->removeEventFilter(this);
-        ui->lCancelTransfer->update();
-        ui->lCancelTransferCompleted->removeEventFilter(this);
-        ui->lCancelTransferCompleted->update();
-    }
-    else
-    {
-        cancelButtonEnabled = false;
-        ui->lCancelTransfer->installEventFilter(this);
-        ui->lCancelTransfer->update();
-        ui->lCancelTransferCompleted->installEventFilter(this);
-        ui->lCancelTransferCompleted->update();
-    }
-
-    emit refreshTransfer(this->getTransferTag());
-}
-
-void TransferItem::loadDefaultTransferIcon()
-{
-    if (animation && animation->state() != QMovie::NotRunning)
-    {
-        animation->stop();
-        ui->lActionType->setMovie(NULL);
-        ui->lActionType->setPixmap(loadIconResource);
+        QPixmap frame = animation->currentPixmap();
+        if (!frame.isNull())
+        {
+            return frame;
+        }
     }
+    return row.syncTransfer ? syncPixmap : cloudPixmap;
 }
 
-bool TransferItem::eventFilter(QObject *, QEvent *ev)
-{
-    return ev->type() == QEvent::Paint || ev->type() == QEvent::ToolTip;
-}
-
-void TransferItem::frameChanged(int)
-{
-    emit refreshTransfer(this->getTransferTag());
-}
-
-void TransferItem::updateAnimation()
+QMovie *TransferItem::getAnimation(const TransferRowData &row)
 {
-    if (!animation)
+    if (row.syncTransfer)
     {
-        return;
-    }
-
-    switch (transferState)
-    {
-        case MegaTransfer::STATE_ACTIVE:
-            if (animation->state() != QMovie::Running)
-            {
-                ui->lActionType->setMovie(animation);
-                animation->start();
-            }
-            break;
-        default:
-            if (animation->state() != QMovie::NotRunning)
-            {
-                animation->stop();
-                ui->lActionType->setMovie(NULL);
-                ui->lActionType->setPixmap(loadIconResource);
-            }
-            break;
+        return synching;
     }
+    return (row.type == MegaTransfer::TYPE_UPLOAD) ? uploading : downloading;
 }
 
-QSize TransferItem::minimumSizeHint() const
+QPixmap TransferItem::loadPixmap(const QString &name)
 {
-    return QSize(800, 48);
-}
-QSize TransferItem::sizeHint() const
-{
-    return QSize(800, 48);
+    return QPixmap(Utilities::getDevicePixelRatio() < 2 ? QString::fromUtf8(":/images/%1.png").arg(name)
+                                                        : QString::fromUtf8(":/images/%1@2x.png").arg(name));
 }
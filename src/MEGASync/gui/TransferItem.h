@@ -1,86 +1,76 @@
 #ifndef TRANSFERITEM_H
 #define TRANSFERITEM_H
 
-#include <QWidget>
-#include <QDateTime>
+#include <QObject>
+#include <QPainter>
+#include <QPixmap>
 #include <QMovie>
-
-namespace Ui {
-class TransferItem;
-}
-
-class TransferItem : public QWidget
+#include <QFont>
+#include <QHash>
+#include <QSet>
+#include "QTransfersModel.h"
+
+// Paints the rows of the transfer lists from their TransferRowData.
+// There isn't a widget per row: icons are loaded once and the
+// animations are shared by all the rows that show them.
+class TransferItem : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit TransferItem(QWidget *parent = 0);
-
-    void setFileName(QString fileName);
-    QString getFileName();
-    QString getTransferName();
-    void setTransferredBytes(long long totalTransferredBytes, bool cancellable);
-    void setTransferType(int type);
-    void setSpeed(long long transferSpeed, long long meanSpeed);
-    void setTotalSize(long long size);
-    void setFinishedTime(long long time);
-    void setStateLabel(QString labelState);
-
-    void setType(int type, bool isSyncTransfer = false);
-    int getType();
-    void setPriority(unsigned long long priority);
-    unsigned long long getPriority();
-
-    void finishTransfer();
-    void updateTransfer();
-    void updateAnimation();
-    void updateFinishedTime();
-    void mouseHoverTransfer(bool isHover);
-    void loadDefaultTransferIcon();
-
-    QSize minimumSizeHint() const;
-    QSize sizeHint() const;
-    bool cancelButtonClicked(QPoint pos);
-
-    ~TransferItem();
+    explicit TransferItem(QObject *parent = 0);
 
-    int getTransferState();
-    void setTransferState(int value);
+    // rect is the rect of the row. paused is true if all the transfers of its type are paused
+    void paint(QPainter *painter, const QRect &rect, const TransferRowData &row, bool hovered, bool paused);
 
-    int getTransferTag();
-    void setTransferTag(int value);
+    // pos is relative to the row
+    bool cancelButtonClicked(const TransferRowData &row, bool hovered, QPoint pos);
 
-    bool getRegular();
-    void setRegular(bool value);
+    // Name shown in the row, elided if it doesn't fit
+    QString getTransferName(const TransferRowData &row);
 
-    bool eventFilter(QObject *, QEvent * ev);
+    QSize sizeHint() const;
 
 signals:
-    void refreshTransfer(int tag);
-
-private:
-    Ui::TransferItem *ui;
+    void animationFrameChanged();
 
 private slots:
     void frameChanged(int);
 
 protected:
-    QString fileName;
-    int type;
-    int transferState;
-    int transferTag;
-    QMovie *animation;
-    QPixmap loadIconResource;
-    long long transferSpeed;
-    long long meanTransferSpeed;
-    long long totalSize;
-    long long totalTransferredBytes;
-    bool regular;
-    unsigned long long priority;
-    bool cancelButtonEnabled;
-    bool isSyncTransfer;
-    long long dsFinishedTime;
-
+    bool isFinished(const TransferRowData &row);
+    bool isCancellable(const TransferRowData &row, bool hovered);
+    void paintActive(QPainter *painter, const TransferRowData &row, bool hovered, bool paused);
+    void paintFinished(QPainter *painter, const TransferRowData &row, bool hovered);
+    void drawIcon(QPainter *painter, const QRect &rect, const QPixmap &pixmap);
+    void drawRichText(QPainter *painter, const QRect &rect, const QString &text, const QColor &color, int alignment);
+
+    QString getSpeedString(const TransferRowData &row, bool paused);
+    QString getRemainingTimeString(const TransferRowData &row, bool paused);
+    QString getFinishedTimeString(const TransferRowData &row);
+
+    const QPixmap &getFileTypePixmap(const QString &fileName);
+    QPixmap getActionPixmap(const TransferRowData &row, bool paused);
+    QMovie *getAnimation(const TransferRowData &row);
+    QPixmap loadPixmap(const QString &name);
+
+    QFont nameFont;
+    QFont totalFont;
+    QFont timeFont;
+
+    QHash<QString, QPixmap> fileTypePixmaps;    ///< By resource of the extension
+    QPixmap uploadPixmap;
+    QPixmap downloadPixmap;
+    QPixmap completedPixmap;
+    QPixmap failedPixmap;
+    QPixmap cancelPixmap;
+    QPixmap cloudPixmap;
+    QPixmap syncPixmap;
+
+    QMovie *uploading;
+    QMovie *downloading;
+    QMovie *synching;
+    QSet<QMovie *> paintedAnimations;           ///< Shown since their last frame
 };
 
 #endif // TRANSFERITEM_H
@@ -50,7 +50,7 @@ TransferManager::TransferManager(MegaApi *megaApi, QWidget *parent) :
     delete firstUpload;
     delete firstDownload;
 
-    if (((MegaApplication *)qApp)->getFinishedTransfers().size() > 0)
+    if (((MegaApplication *)qApp)->getFinishedTransfers()->size() > 0)
     {
         ui->wCompletedTab->setVisible(true);
     }
@@ -123,7 +123,7 @@ void TransferManager::onTransferFinish(MegaApi *api, MegaTransfer *transfer, Meg
         return;
     }
 
-    ui->wCompleted->getModel()->onTransferFinish(api, transfer, e);
+    // the completed list is updated by MegaApplication's FinishedTransferStore
     ui->wCompletedTab->setVisible(true);
 
     if (notificationNumber >= transfer->getNotificationNumber())
@@ -487,15 +487,19 @@ void TransferManager::on_bClearAll_clicked()
 
     if (w == ui->wActiveTransfers)
     {
+        ((MegaApplication *)qApp)->cancelPendingUploads();
+        ((MegaApplication *)qApp)->cancelPendingDownloads();
         megaApi->cancelTransfers(MegaTransfer::TYPE_UPLOAD);
         megaApi->cancelTransfers(MegaTransfer::TYPE_DOWNLOAD);
     }
     else if(w == ui->wDownloads)
     {
+        ((MegaApplication *)qApp)->cancelPendingDownloads();
         megaApi->cancelTransfers(MegaTransfer::TYPE_DOWNLOAD);
     }
     else if(w == ui->wUploads)
     {
+        ((MegaApplication *)qApp)->cancelPendingUploads();
         megaApi->cancelTransfers(MegaTransfer::TYPE_UPLOAD);
     }
     else if(w == ui->wCompleted)
@@ -518,6 +522,28 @@ void TransferManager::onTransfersActive(bool exists)
     ui->bClearAll->setEnabled(exists);
 }
 
+void TransferManager::updateDownloadPlanning(int folders, int files, bool finished)
+{
+    if (finished)
+    {
+        ui->tDownloads->setToolTip(QString());
+        return;
+    }
+
+    ui->tDownloads->setToolTip(tr("Preparing downloads: %1 folders, %2 files").arg(folders).arg(files));
+}
+
+void TransferManager::updateUploadPlanning(int folders, int files, int uploads, bool finished)
+{
+    if (finished)
+    {
+        ui->tUploads->setToolTip(QString());
+        return;
+    }
+
+    ui->tUploads->setToolTip(tr("Preparing uploads: %1 folders, %2 files (%3 started)").arg(folders).arg(files).arg(uploads));
+}
+
 void TransferManager::updateNumberOfCompletedTransfers(int num)
 {
     if (!num)
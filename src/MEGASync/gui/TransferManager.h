@@ -33,6 +33,8 @@ public:
     void updatePauseState();
     void disableGetLink(bool disable);
     void updateNumberOfCompletedTransfers(int num);
+    void updateDownloadPlanning(int folders, int files, bool finished);
+    void updateUploadPlanning(int folders, int files, int uploads, bool finished);
     ~TransferManager();
 
     virtual void onTransferStart(mega::MegaApi *api, mega::MegaTransfer *transfer);
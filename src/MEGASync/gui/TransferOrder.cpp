@@ -0,0 +1,301 @@
+#include "TransferOrder.h"
+#include "QTransfersModel.h"
+
+TransferOrder::TransferOrder()
+{
+    root = NULL;
+    seed = 0x2545f491;
+}
+
+TransferOrder::~TransferOrder()
+{
+    deleteNodes(root);
+}
+
+int TransferOrder::size() const
+{
+    return size(root);
+}
+
+TransferItemData *TransferOrder::at(int row) const
+{
+    Node *node = root;
+    while (node)
+    {
+        int leftSize = size(node->left);
+        if (row < leftSize)
+        {
+            node = node->left;
+        }
+        else if (row > leftSize)
+        {
+            row -= leftSize + 1;
+            node = node->right;
+        }
+        else
+        {
+            return node->item;
+        }
+    }
+    return NULL;
+}
+
+int TransferOrder::rowOf(const TransferItemData *item) const
+{
+    int row = 0;
+    Node *node = root;
+    while (node)
+    {
+        int result = compare(item->priority, item->tag, node->item);
+        if (result < 0)
+        {
+            node = node->left;
+        }
+        else if (result > 0)
+        {
+            row += size(node->left) + 1;
+            node = node->right;
+        }
+        else
+        {
+            return row + size(node->left);
+        }
+    }
+    return -1;
+}
+
+int TransferOrder::lowerBound(unsigned long long priority, int tag) const
+{
+    int row = 0;
+    Node *node = root;
+    while (node)
+    {
+        if (compare(priority, tag, node->item) <= 0)
+        {
+            node = node->left;
+        }
+        else
+        {
+            row += size(node->left) + 1;
+            node = node->right;
+        }
+    }
+    return row;
+}
+
+int TransferOrder::insert(TransferItemData *item)
+{
+    int row = lowerBound(item->priority, item->tag);
+
+    Node *before = NULL;
+    Node *after = NULL;
+    split(root, item->priority, item->tag, &before, &after);
+    root = merge(merge(before, createNode(item)), after);
+    return row;
+}
+
+int TransferOrder::remove(const TransferItemData *item)
+{
+    int row = -1;
+    root = remove(root, item, &row);
+    return row;
+}
+
+void TransferOrder::assign(const QVector<TransferItemData *> &items)
+{
+    clear();
+
+    QVector<Node *> nodes(items.size());
+    for (int i = 0; i < items.size(); i++)
+    {
+        nodes[i] = createNode(items.at(i));
+    }
+
+    // A balanced tree, then the weights are moved around to satisfy the heap order
+    root = build(nodes, 0, nodes.size() - 1);
+    heapify(root);
+}
+
+void TransferOrder::clear()
+{
+    deleteNodes(root);
+    root = NULL;
+}
+
+int TransferOrder::compare(unsigned long long priority, int tag, const TransferItemData *item)
+{
+    if (priority != item->priority)
+    {
+        return (priority < item->priority) ? -1 : 1;
+    }
+    if (tag != item->tag)
+    {
+        return (tag < item->tag) ? -1 : 1;
+    }
+    return 0;
+}
+
+int TransferOrder::size(Node *node)
+{
+    return node ? node->size : 0;
+}
+
+void TransferOrder::updateSize(Node *node)
+{
+    node->size = size(node->left) + size(node->right) + 1;
+}
+
+// before gets the nodes lower than (priority, tag), after the rest
+void TransferOrder::split(Node *node, unsigned long long priority, int tag, Node **before, Node **after)
+{
+    if (!node)
+    {
+        *before = NULL;
+        *after = NULL;
+        return;
+    }
+
+    if (compare(priority, tag, node->item) <= 0)
+    {
+        split(node->left, priority, tag, before, &node->left);
+        *after = node;
+    }
+    else
+    {
+        split(node->right, priority, tag, &node->right, after);
+        *before = node;
+    }
+    updateSize(node);
+}
+
+// All the nodes of before must be lower than the ones of after
+TransferOrder::Node *TransferOrder::merge(Node *before, Node *after)
+{
+    if (!before)
+    {
+        return after;
+    }
+    if (!after)
+    {
+        return before;
+    }
+
+    if (before->weight > after->weight)
+    {
+        before->right = merge(before->right, after);
+        updateSize(before);
+        return before;
+    }
+
+    after->left = merge(before, after->left);
+    updateSize(after);
+    return after;
+}
+
+TransferOrder::Node *TransferOrder::remove(Node *node, const TransferItemData *item, int *row)
+{
+    if (!node)
+    {
+        return NULL;
+    }
+
+    int result = compare(item->priority, item->tag, node->item);
+    if (result < 0)
+    {
+        node->left = remove(node->left, item, row);
+    }
+    else if (result > 0)
+    {
+        node->right = remove(node->right, item, row);
+        if (*row >= 0)
+        {
+            *row += size(node->left) + 1;
+        }
+    }
+    else
+    {
+        *row = size(node->left);
+        Node *merged = merge(node->left, node->right);
+        delete node;
+        return merged;
+    }
+
+    updateSize(node);
+    return node;
+}
+
+TransferOrder::Node *TransferOrder::build(const QVector<Node *> &nodes, int first, int last)
+{
+    if (first > last)
+    {
+        return NULL;
+    }
+
+    int middle = first + (last - first) / 2;
+    Node *node = nodes.at(middle);
+    node->left = build(nodes, first, middle - 1);
+    node->right = build(nodes, middle + 1, last);
+    updateSize(node);
+    return node;
+}
+
+// Swaps weights (not nodes, so the order is kept) until parents weigh more than their children
+void TransferOrder::heapify(Node *node)
+{
+    if (!node)
+    {
+        return;
+    }
+
+    heapify(node->left);
+    heapify(node->right);
+    while (node)
+    {
+        Node *heaviest = node;
+        if (node->left && node->left->weight > heaviest->weight)
+        {
+            heaviest = node->left;
+        }
+        if (node->right && node->right->weight > heaviest->weight)
+        {
+            heaviest = node->right;
+        }
+        if (heaviest == node)
+        {
+            break;
+        }
+
+        unsigned int weight = node->weight;
+        node->weight = heaviest->weight;
+        heaviest->weight = weight;
+        node = heaviest;
+    }
+}
+
+void TransferOrder::deleteNodes(Node *node)
+{
+    if (!node)
+    {
+        return;
+    }
+
+    deleteNodes(node->left);
+    deleteNodes(node->right);
+    delete node;
+}
+
+TransferOrder::Node *TransferOrder::createNode(TransferItemData *item)
+{
+    // xorshift, enough to keep the tree balanced
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    Node *node = new Node();
+    node->item = item;
+    node->left = NULL;
+    node->right = NULL;
+    node->size = 1;
+    node->weight = seed;
+    return node;
+}
@@ -0,0 +1,65 @@
+#ifndef TRANSFERORDER_H
+#define TRANSFERORDER_H
+
+#include <QVector>
+
+class TransferItemData;
+
+// Transfers sorted by (priority, tag), with their rows.
+// It's a treap where each node knows the size of its subtree, so finding the
+// row of a transfer, the transfer of a row, inserting and removing are O(log n).
+// The key of a transfer must not change while it is in the tree.
+class TransferOrder
+{
+public:
+    TransferOrder();
+    ~TransferOrder();
+
+    int size() const;
+    TransferItemData *at(int row) const;
+
+    // Row of the transfer, or -1 if it isn't in the tree
+    int rowOf(const TransferItemData *item) const;
+
+    // Number of transfers before (priority, tag), that is the row it would have
+    int lowerBound(unsigned long long priority, int tag) const;
+
+    // Return the row of the transfer (-1 if it isn't removed)
+    int insert(TransferItemData *item);
+    int remove(const TransferItemData *item);
+
+    // Replaces the content in O(n). Items must be sorted
+    void assign(const QVector<TransferItemData *> &items);
+    void clear();
+
+protected:
+    class Node
+    {
+    public:
+        TransferItemData *item;
+        Node *left;
+        Node *right;
+        int size;
+        unsigned int weight;    ///< Random, parents weigh more than their children
+    };
+
+    static int compare(unsigned long long priority, int tag, const TransferItemData *item);
+    static int size(Node *node);
+    static void updateSize(Node *node);
+    static void split(Node *node, unsigned long long priority, int tag, Node **before, Node **after);
+    static Node *merge(Node *before, Node *after);
+    static Node *remove(Node *node, const TransferItemData *item, int *row);
+    static Node *build(const QVector<Node *> &nodes, int first, int last);
+    static void heapify(Node *node);
+    static void deleteNodes(Node *node);
+
+    Node *createNode(TransferItemData *item);
+
+    Node *root;
+    unsigned int seed;
+
+private:
+    Q_DISABLE_COPY(TransferOrder)
+};
+
+#endif // TRANSFERORDER_H
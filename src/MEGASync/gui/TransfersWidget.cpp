@@ -30,17 +30,17 @@ void TransfersWidget::setupTransfers(MegaTransferData *transferData, int type)
     }
 }
 
-void TransfersWidget::setupFinishedTransfers(QList<MegaTransfer* > transferData)
+void TransfersWidget::setupFinishedTransfers(FinishedTransferStore *finishedTransfers)
 {
     this->type = QTransfersModel::TYPE_FINISHED ;
-    model = new QFinishedTransfersModel(transferData);
+    model = new QFinishedTransfersModel(finishedTransfers);
     connect(model, SIGNAL(noTransfers()), this, SLOT(noTransfers()));
     connect(model, SIGNAL(onTransferAdded()), this, SLOT(onTransferAdded()));
 
     noTransfers();
     configureTransferView();
 
-    if (transferData.size())
+    if (finishedTransfers->size())
     {
         onTransferAdded();
     }
@@ -78,6 +78,7 @@ void TransfersWidget::configureTransferView()
     tDelegate = new MegaTransferDelegate(model, this);
     ui->tvTransfers->setup(type);
     ui->tvTransfers->setItemDelegate((QAbstractItemDelegate *)tDelegate);
+    connect(tDelegate, SIGNAL(animationFrameChanged()), ui->tvTransfers->viewport(), SLOT(update()));
     ui->tvTransfers->header()->close();
     ui->tvTransfers->setSelectionMode(QAbstractItemView::ContiguousSelection);
     ui->tvTransfers->setDragEnabled(true);
@@ -2,7 +2,6 @@
 #define TRANSFERSWIDGET_H
 
 #include <QWidget>
-#include "TransferItem.h"
 #include "QTransfersModel.h"
 #include "QActiveTransfersModel.h"
 #include "QFinishedTransfersModel.h"
@@ -20,7 +19,7 @@ class TransfersWidget : public QWidget
 
 public:
     explicit TransfersWidget(QWidget *parent = 0);
-    void setupFinishedTransfers(QList<mega::MegaTransfer* > transferData);
+    void setupFinishedTransfers(FinishedTransferStore *finishedTransfers);
     void setupTransfers(mega::MegaTransferData *transferData, int type);
     void refreshTransferItems();
     void clearTransfers();
@@ -33,7 +32,6 @@ public:
 
 private:
     Ui::TransfersWidget *ui;
-    QList<TransferItem *> activeTransfers;
     QTransfersModel *model;
     MegaTransferDelegate *tDelegate;
     int type;
@@ -33,6 +33,7 @@ SOURCES += $$PWD/SettingsDialog.cpp \
     $$PWD/PlanWidget.cpp \
     $$PWD/InfoWizard.cpp \
     $$PWD/TransferItem.cpp \
+    $$PWD/TransferOrder.cpp \
     $$PWD/TransferManager.cpp \
     $$PWD/TransfersWidget.cpp \
     $$PWD/QTransfersModel.cpp \
@@ -85,6 +86,7 @@ HEADERS  += $$PWD/SettingsDialog.h \
     $$PWD/PlanWidget.h \
     $$PWD/InfoWizard.h \
     $$PWD/TransferItem.h \
+    $$PWD/TransferOrder.h \
     $$PWD/TransferManager.h \
     $$PWD/TransfersWidget.h \
     $$PWD/QTransfersModel.h \
@@ -140,7 +142,6 @@ win32 {
                 $$PWD/win/PlanWidget.ui \
                 $$PWD/win/UpgradeDialog.ui \
                 $$PWD/win/InfoWizard.ui \
-                $$PWD/win/TransferItem.ui \
                 $$PWD/win/TransferManager.ui \
                 $$PWD/win/TransfersWidget.ui \
                 $$PWD/win/TransfersStateInfoWidget.ui \
@@ -184,7 +185,6 @@ macx {
                 $$PWD/macx/PlanWidget.ui \
                 $$PWD/macx/UpgradeDialog.ui \
                 $$PWD/macx/InfoWizard.ui \
-                $$PWD/macx/TransferItem.ui \
                 $$PWD/macx/TransferManager.ui \
                 $$PWD/macx/TransfersWidget.ui \
                 $$PWD/macx/TransfersStateInfoWidget.ui \
@@ -237,7 +237,6 @@ unix:!macx {
                 $$PWD/linux/PlanWidget.ui \
                 $$PWD/linux/UpgradeDialog.ui \
                 $$PWD/linux/InfoWizard.ui \
-                $$PWD/linux/TransferItem.ui \
                 $$PWD/linux/TransferManager.ui \
                 $$PWD/linux/TransfersWidget.ui \
                 $$PWD/linux/TransfersStateInfoWidget.ui \
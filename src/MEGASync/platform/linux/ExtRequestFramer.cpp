@@ -0,0 +1,46 @@
+#include "ExtRequestFramer.h"
+
+const char ExtRequestFramer::OP_PATH_STATE_BATCH = 'Q'; //Path state of several objects
+
+ExtRequestFramer::ExtRequestFramer()
+{
+    framed = false;
+}
+
+QList<QByteArray> ExtRequestFramer::append(const QByteArray &data)
+{
+    pendingData.append(data);
+    if (!framed && pendingData.contains('\n'))
+    {
+        framed = true;
+    }
+
+    QList<QByteArray> requests;
+    int start = 0;
+    while (start < pendingData.size())
+    {
+        int end = pendingData.indexOf('\n', start);
+        if (end < 0)
+        {
+            if (framed || pendingData.at(start) == OP_PATH_STATE_BATCH)
+            {
+                break;
+            }
+            end = pendingData.size();
+        }
+
+        QByteArray request = pendingData.mid(start, end - start);
+        start = end + 1;
+        if (request.size())
+        {
+            requests.append(request);
+        }
+    }
+    pendingData.remove(0, qMin(start, pendingData.size()));
+    return requests;
+}
+
+bool ExtRequestFramer::isFramed() const
+{
+    return framed;
+}
@@ -0,0 +1,30 @@
+#ifndef EXTREQUESTFRAMER_H
+#define EXTREQUESTFRAMER_H
+
+#include <QByteArray>
+#include <QList>
+
+// Splits the data sent by a shell extension client into requests.
+// Requests are '\n'-terminated so that clients can pipeline them.
+// Legacy clients send a single unterminated request and wait for the answer,
+// so until a client sends a terminator, whatever it sent is a complete request,
+// except for batch requests, that are always terminated
+class ExtRequestFramer
+{
+public:
+    static const char OP_PATH_STATE_BATCH;
+
+    ExtRequestFramer();
+
+    // Returns the requests completed by data, without terminator
+    QList<QByteArray> append(const QByteArray &data);
+
+    // True once the client has sent a terminator
+    bool isFramed() const;
+
+protected:
+    QByteArray pendingData;
+    bool framed;
+};
+
+#endif // EXTREQUESTFRAMER_H
@@ -7,6 +7,7 @@
 using namespace mega;
 using namespace std;
 
+
 ExtServer::ExtServer(MegaApplication *app): QObject(),
     m_localServer(0)
 {
@@ -14,10 +15,24 @@ ExtServer::ExtServer(MegaApplication *app): QObject(),
     connect(this, SIGNAL(newExportQueue(QQueue<QString>)), app, SLOT(shellExport(QQueue<QString>)),Qt::QueuedConnection);
     connect(this, SIGNAL(viewOnMega(QByteArray, bool)), app, SLOT(shellViewOnMega(QByteArray, bool)), Qt::QueuedConnection);
 
-
     // construct local socket path
     sockPath = MegaApplication::applicationDataPath() + QDir::separator() + QString::fromAscii("mega.socket");
+}
 
+ExtServer::~ExtServer()
+{
+    qDeleteAll(m_clients);
+    QLocalServer::removeServer(sockPath);
+    if (m_localServer)
+    {
+        m_localServer->close();
+        delete m_localServer;
+    }
+}
+
+// start listening in the thread that serves the clients
+void ExtServer::start()
+{
     //LOG_info << "Starting Ext server";
 
     // make sure previous socket file is removed
@@ -35,14 +50,6 @@ ExtServer::ExtServer(MegaApplication *app): QObject(),
     connect(m_localServer, SIGNAL(newConnection()), this, SLOT(acceptConnection()),Qt::QueuedConnection);
 }
 
-ExtServer::~ExtServer()
-{
-    qDeleteAll(m_clients);
-    QLocalServer::removeServer(sockPath);
-    m_localServer->close();
-    delete m_localServer;
-}
-
 // a new connection is available
 void ExtServer::acceptConnection()
 {
@@ -67,6 +74,7 @@ void ExtServer::onClientDisconnected()
     if (!client)
         return;
     m_clients.removeAll(client);
+    m_framers.remove(client);
     client->deleteLater();
 
     //LOG_debug << "Client disconnected";
@@ -84,14 +92,27 @@ void ExtServer::onClientData()
         return;
     }
 
-    qint64 len;
-    char buf[1024];
-    while ((len = client->readLine(buf, sizeof(buf))) > 0) {
-        const char *out = GetAnswerToRequest(buf);
-        if (out) {
-            qint64 len = client->write(out);
-            client->write("\n");
+    QList<QByteArray> requests = m_framers[client].append(client->readAll());
+    QByteArray answer;
+    for (int i = 0; i < requests.size(); i++)
+    {
+        // make sure the "<op>:" prefix is always addressable
+        QByteArray request = requests.at(i).leftJustified(2, '\0');
+
+        if (request.at(0) == ExtRequestFramer::OP_PATH_STATE_BATCH)
+        {
+            answer.append(GetAnswerToBatchRequest(request.mid(2)));
+        }
+        else
+        {
+            answer.append(GetAnswerToRequest(request.constData()));
         }
+        answer.append('\n');
+    }
+
+    if (answer.size())
+    {
+        client->write(answer);
     }
 }
 
@@ -101,6 +122,24 @@ void ExtServer::onClientData()
 #define RESPONSE_SYNCED     "1"
 #define RESPONSE_PENDING    "2"
 #define RESPONSE_SYNCING    "3"
+
+const char *ExtServer::stateToResponse(int state)
+{
+    switch(state)
+    {
+        case MegaApi::STATE_SYNCED:
+            return RESPONSE_SYNCED;
+        case MegaApi::STATE_SYNCING:
+            return RESPONSE_SYNCING;
+        case MegaApi::STATE_PENDING:
+            return RESPONSE_PENDING;
+        case MegaApi::STATE_NONE:
+        case MegaApi::STATE_IGNORED:
+        default:
+            return RESPONSE_DEFAULT;
+    }
+}
+
 // parse incoming request and send response back to client
 const char *ExtServer::GetAnswerToRequest(const char *buf)
 {
@@ -245,25 +284,13 @@ const char *ExtServer::GetAnswerToRequest(const char *buf)
             if (forceGetState || !Preferences::instance()->overlayIconsDisabled() )
             {
                 string tmpPath = scontent.substr(0,possep);
-                state = ((MegaApplication *)qApp)->getMegaApi()->syncPathState(&tmpPath);
+                if (Preferences::instance()->getSyncIndexByLocalPath(QString::fromUtf8(tmpPath.data(), tmpPath.size())) >= 0)
+                {
+                    state = ((MegaApplication *)qApp)->getMegaApi()->syncPathState(&tmpPath);
+                }
             }
 
-            switch(state)
-            {
-                case MegaApi::STATE_SYNCED:
-                    strncpy(out, RESPONSE_SYNCED, BUFSIZE);
-                    break;
-                case MegaApi::STATE_SYNCING:
-                    strncpy(out, RESPONSE_SYNCING, BUFSIZE);
-                    break;
-                case MegaApi::STATE_PENDING:
-                    strncpy(out, RESPONSE_PENDING, BUFSIZE);
-                    break;
-                case MegaApi::STATE_NONE:
-                case MegaApi::STATE_IGNORED:
-                default:
-                    strncpy(out, RESPONSE_DEFAULT, BUFSIZE);
-            }
+            strncpy(out, stateToResponse(state), BUFSIZE);
             break;
         }
         case 'E':
@@ -314,3 +341,37 @@ const char *ExtServer::GetAnswerToRequest(const char *buf)
 
     return out;
 }
+
+// get the state of several objects in a single request
+// content: path1 0x1E path2 0x1E ... pathN 0x1C forceGetState
+// answer: one state character per path, in the same order
+QByteArray ExtServer::GetAnswerToBatchRequest(const QByteArray &content)
+{
+    int possep = content.lastIndexOf((char)0x1C);
+    bool forceGetState = (possep >= 0) && ((possep + 1) < content.size()) && content.at(possep + 1) == '1';
+    QList<QByteArray> paths = content.left(possep >= 0 ? possep : content.size()).split((char)0x1E);
+
+    QByteArray answer;
+    answer.reserve(paths.size());
+    if (!forceGetState && Preferences::instance()->overlayIconsDisabled())
+    {
+        answer.fill(RESPONSE_DEFAULT[0], paths.size());
+        return answer;
+    }
+
+    // paths outside the syncs are answered without locking the SDK
+    MegaApi *megaApi = ((MegaApplication *)qApp)->getMegaApi();
+    Preferences *preferences = Preferences::instance();
+    for (int i = 0; i < paths.size(); i++)
+    {
+        if (preferences->getSyncIndexByLocalPath(QString::fromUtf8(paths.at(i))) < 0)
+        {
+            answer.append(stateToResponse(MegaApi::STATE_NONE));
+            continue;
+        }
+
+        string tmpPath(paths.at(i).constData(), paths.at(i).size());
+        answer.append(stateToResponse(megaApi->syncPathState(&tmpPath)));
+    }
+    return answer;
+}
@@ -4,6 +4,7 @@
 #include "MegaApplication.h"
 #include "megaapi.h"
 #include "control/Preferences.h"
+#include "ExtRequestFramer.h"
 
 typedef enum {
    STRING_UPLOAD = 0,
@@ -21,6 +22,7 @@ class ExtServer: public QObject
  public:
     ExtServer(MegaApplication *app);
     virtual ~ExtServer();
+    static const char *stateToResponse(int state);
 
  protected:
     QLocalServer *m_localServer;
@@ -28,13 +30,16 @@ class ExtServer: public QObject
     QQueue<QString> exportQueue;
 
  public Q_SLOTS:
+    void start();
     void acceptConnection();
     void onClientData();
     void onClientDisconnected();
  private:
     QString sockPath;
     QList<QLocalSocket *> m_clients;
+    QHash<QLocalSocket *, ExtRequestFramer> m_framers;
     const char *GetAnswerToRequest(const char *buf);
+    QByteArray GetAnswerToBatchRequest(const QByteArray &content);
 
  signals:
     void newUploadQueue(QQueue<QString> uploadQueue);
@@ -6,6 +6,8 @@ using namespace mega;
 
 ExtServer *LinuxPlatform::ext_server = NULL;
 NotifyServer *LinuxPlatform::notify_server = NULL;
+QThread *LinuxPlatform::shell_thread = NULL;
+ProcessScanner *LinuxPlatform::process_scanner = NULL;
 
 static QString autostart_dir = QDir::homePath() + QString::fromAscii("/.config/autostart/");
 QString LinuxPlatform::desktop_file = autostart_dir + QString::fromAscii("megasync.desktop");
@@ -27,12 +29,12 @@ bool LinuxPlatform::enableTrayIcon(QString executable)
     return false;
 }
 
-void LinuxPlatform::notifyItemChange(string *localPath, int)
+void LinuxPlatform::notifyItemChange(string *localPath, int newState)
 {
     if (notify_server && localPath && localPath->size()
             && !Preferences::instance()->overlayIconsDisabled())
     {
-        notify_server->notifyItemChange(localPath);
+        notify_server->notifyItemChange(localPath, newState);
     }
 }
 
@@ -91,32 +93,44 @@ void LinuxPlatform::showInFolder(QString pathIn)
     QProcess::startDetached(QString::fromAscii("nautilus \"") + pathIn + QString::fromUtf8("\""));
 }
 
+// Shell extension servers run in their own thread so that path state requests
+// don't block the GUI. Requests that affect the GUI reach MegaApplication
+// through queued connections
 void LinuxPlatform::startShellDispatcher(MegaApplication *receiver)
 {
-    if (!ext_server)
+    if (shell_thread)
     {
-        ext_server = new ExtServer(receiver);
+        return;
     }
 
-    if (!notify_server)
-    {
-        notify_server = new NotifyServer();
-    }
+    shell_thread = new QThread();
+    ext_server = new ExtServer(receiver);
+    notify_server = new NotifyServer();
+    ext_server->moveToThread(shell_thread);
+    notify_server->moveToThread(shell_thread);
+
+    QObject::connect(shell_thread, SIGNAL(started()), ext_server, SLOT(start()));
+    QObject::connect(shell_thread, SIGNAL(started()), notify_server, SLOT(start()));
+    QObject::connect(shell_thread, SIGNAL(finished()), ext_server, SLOT(deleteLater()));
+    QObject::connect(shell_thread, SIGNAL(finished()), notify_server, SLOT(deleteLater()));
+
+    shell_thread->start();
 }
 
 void LinuxPlatform::stopShellDispatcher()
 {
-    if (ext_server)
+    if (!shell_thread)
     {
-        delete ext_server;
-        ext_server = NULL;
+        return;
     }
 
-    if (notify_server)
-    {
-        delete notify_server;
-        notify_server = NULL;
-    }
+    // servers are deleted in their thread when it finishes
+    ext_server = NULL;
+    notify_server = NULL;
+    shell_thread->quit();
+    shell_thread->wait();
+    delete shell_thread;
+    shell_thread = NULL;
 }
 
 void LinuxPlatform::syncFolderAdded(QString syncPath, QString syncName, QString syncID)
@@ -155,7 +169,10 @@ void LinuxPlatform::syncFolderRemoved(QString syncPath, QString syncName, QStrin
 
 void LinuxPlatform::notifyRestartSyncFolders()
 {
-
+    if (notify_server)
+    {
+        notify_server->notifyStatesReset();
+    }
 }
 
 void LinuxPlatform::notifyAllSyncFoldersAdded()
@@ -271,88 +288,43 @@ void LinuxPlatform::uninstall()
 
 }
 
-QStringList LinuxPlatform::getListRunningProcesses()
+ProcessScanner *LinuxPlatform::getProcessScanner()
 {
-    QProcess p;
-    p.start(QString::fromUtf8("ps ax -o comm"));
-    p.waitForFinished(2000);
-    QString output = QString::fromUtf8(p.readAllStandardOutput().constData());
-    QString e = QString::fromUtf8(p.readAllStandardError().constData());
-    if (e.size())
+    if (!process_scanner)
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Error for \"ps ax -o comm\" command:");
-        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, e.toUtf8().constData());
+        process_scanner = new ProcessScanner();
+        process_scanner->start();
     }
+    return process_scanner;
+}
 
-    p.start(QString::fromUtf8("/bin/bash -c \"readlink /proc/*/exe\""));
-    p.waitForFinished(2000);
-    QString output2 = QString::fromUtf8(p.readAllStandardOutput().constData());
-    e = QString::fromUtf8(p.readAllStandardError().constData());
-    if (e.size())
+void LinuxPlatform::stopProcessScanner()
+{
+    if (!process_scanner)
     {
-        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Error for \"readlink /proc/*/exe\" command:");
-        MegaApi::log(MegaApi::LOG_LEVEL_ERROR, e.toUtf8().constData());
+        return;
     }
-    QStringList data = output.split(QString::fromUtf8("\n"));
-
-    data.append(output2.split(QString::fromUtf8("\n")));
 
-    return data;
+    process_scanner->stop();
+    process_scanner->wait();
+    delete process_scanner;
+    process_scanner = NULL;
 }
 
 // Check if it's needed to start the local HTTP server
 // for communications with the webclient
 bool LinuxPlatform::shouldRunHttpServer()
 {
-    QStringList data = getListRunningProcesses();
-    if (data.size() > 1)
-    {
-        for (int i = 1; i < data.size(); i++)
-        {
-            // The MEGA webclient sends request to MEGAsync to improve the
-            // user experience. We check if web browsers are running because
-            // otherwise it isn't needed to run the local web server for this purpose.
-            // Here is the list or web browsers that allow HTTP communications
-            // with 127.0.0.1 inside HTTPS webs.
-            QString command = data.at(i).trimmed();
-            if (command.contains(QString::fromUtf8("firefox"), Qt::CaseInsensitive)
-                    || command.contains(QString::fromUtf8("chrome"), Qt::CaseInsensitive)
-                    || command.contains(QString::fromUtf8("chromium"), Qt::CaseInsensitive)
-                    )
-            {
-                return true;
-            }
-        }
-    }
-    return false;
+    // The MEGA webclient sends request to MEGAsync to improve the
+    // user experience. We check if web browsers are running because
+    // otherwise it isn't needed to run the local web server for this purpose.
+    // The list of processes is kept up to date in a background thread (see ProcessScanner::classify)
+    return getProcessScanner()->isHttpBrowserRunning();
 }
 
 // Check if it's needed to start the local HTTPS server
 // for communications with the webclient
 bool LinuxPlatform::shouldRunHttpsServer()
 {
-    QStringList data = getListRunningProcesses();
-
-    if (data.size() > 1)
-    {
-        for (int i = 1; i < data.size(); i++)
-        {
-            // The MEGA webclient sends request to MEGAsync to improve the
-            // user experience. We check if web browsers are running because
-            // otherwise it isn't needed to run the local web server for this purpose.
-            // Here is the list or web browsers that don't allow HTTP communications
-            // with 127.0.0.1 inside HTTPS webs and therefore require a HTTPS server.
-            QString command = data.at(i).trimmed();
-            if (command.contains(QString::fromUtf8("safari"), Qt::CaseInsensitive)
-                    || command.contains(QString::fromUtf8("iexplore"), Qt::CaseInsensitive)
-                    || command.contains(QString::fromUtf8("opera"), Qt::CaseInsensitive)
-                    || command.contains(QString::fromUtf8("iceweasel"), Qt::CaseInsensitive)
-                    || command.contains(QString::fromUtf8("konqueror"), Qt::CaseInsensitive)
-                    )
-            {
-                return true;
-            }
-        }
-    }
-    return false;
+    return getProcessScanner()->isHttpsBrowserRunning();
 }
@@ -13,6 +13,7 @@
 #include "MegaApplication.h"
 #include "ExtServer.h"
 #include "NotifyServer.h"
+#include "ProcessScanner.h"
 
 class LinuxPlatform
 {
@@ -20,12 +21,14 @@ class LinuxPlatform
 private:
     static ExtServer *ext_server;
     static NotifyServer *notify_server;
+    static QThread *shell_thread;
+    static ProcessScanner *process_scanner;
     static QString set_icon;
     static QString custom_icon;
     static QString remove_icon;
 
     LinuxPlatform() {}
-    static QStringList getListRunningProcesses();
+    static ProcessScanner *getProcessScanner();
 
 public:
     static void initialize(int argc, char *argv[]);
@@ -54,6 +57,7 @@ public:
     static void uninstall();
     static bool shouldRunHttpServer();
     static bool shouldRunHttpsServer();
+    static void stopProcessScanner();
 };
 
 #endif // LINUXPLATFORM_H
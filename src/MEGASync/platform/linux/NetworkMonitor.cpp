@@ -0,0 +1,156 @@
+#include "NetworkMonitor.h"
+#include "megaapi.h"
+
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+using namespace mega;
+
+NetworkMonitor::NetworkMonitor() : QThread()
+{
+    if (pipe(wakeupPipe))
+    {
+        wakeupPipe[0] = wakeupPipe[1] = -1;
+    }
+}
+
+NetworkMonitor::~NetworkMonitor()
+{
+    if (wakeupPipe[0] >= 0)
+    {
+        close(wakeupPipe[0]);
+        close(wakeupPipe[1]);
+    }
+}
+
+bool NetworkMonitor::isActive()
+{
+    return active.fetchAndAddOrdered(0);
+}
+
+void NetworkMonitor::stop()
+{
+    if (wakeupPipe[1] >= 0)
+    {
+        char c = 0;
+        if (write(wakeupPipe[1], &c, 1) < 0)
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Unable to stop the network monitor");
+        }
+    }
+}
+
+void NetworkMonitor::run()
+{
+    if (wakeupPipe[0] < 0)
+    {
+        return;
+    }
+
+    int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+    if (fd < 0)
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_WARNING, QString::fromUtf8("Unable to open a netlink socket: %1")
+                     .arg(errno).toUtf8().constData());
+        return;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        MegaApi::log(MegaApi::LOG_LEVEL_WARNING, QString::fromUtf8("Unable to listen to netlink: %1")
+                     .arg(errno).toUtf8().constData());
+        close(fd);
+        return;
+    }
+
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Network monitor started");
+    active.fetchAndStoreOrdered(1);
+
+    long buffer[2048];  // aligned for the netlink headers
+    while (true)
+    {
+        struct pollfd fds[2];
+        fds[0].fd = fd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = wakeupPipe[0];
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[1].revents)
+        {
+            // stopped
+            break;
+        }
+
+        // read everything available so that a burst of notifications is reported once
+        bool changed = false;
+        while (true)
+        {
+            ssize_t length = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (length < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == ENOBUFS)
+                {
+                    // notifications were lost
+                    changed = true;
+                    continue;
+                }
+                break;
+            }
+
+            if (!length)
+            {
+                break;
+            }
+
+            int remaining = length;
+            for (struct nlmsghdr *header = (struct nlmsghdr *)buffer; NLMSG_OK(header, remaining);
+                 header = NLMSG_NEXT(header, remaining))
+            {
+                switch (header->nlmsg_type)
+                {
+                    case RTM_NEWLINK:
+                    case RTM_DELLINK:
+                    case RTM_NEWADDR:
+                    case RTM_DELADDR:
+                        changed = true;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        if (changed)
+        {
+            emit networkChanged();
+        }
+    }
+
+    active.fetchAndStoreOrdered(0);
+    close(fd);
+}
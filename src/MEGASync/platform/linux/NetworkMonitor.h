@@ -0,0 +1,32 @@
+#ifndef NETWORKMONITOR_H
+#define NETWORKMONITOR_H
+
+#include <QThread>
+#include <QAtomicInt>
+
+// Listens to netlink notifications about network interfaces and addresses,
+// so that changes are detected without enumerating the interfaces periodically
+class NetworkMonitor : public QThread
+{
+    Q_OBJECT
+
+ public:
+    NetworkMonitor();
+    virtual ~NetworkMonitor();
+
+    // false if netlink isn't available (the interfaces have to be polled)
+    bool isActive();
+    void stop();
+
+ signals:
+    // Emitted once per burst of notifications
+    void networkChanged();
+
+ protected:
+    virtual void run();
+
+    QAtomicInt active;
+    int wakeupPipe[2];
+};
+
+#endif
@@ -3,6 +3,7 @@
 #include <pwd.h>
 #include <unistd.h>
 #include "control/Utilities.h"
+#include "ExtServer.h"
 
 using namespace mega;
 using namespace std;
@@ -10,9 +11,28 @@ using namespace std;
 NotifyServer::NotifyServer(): QObject(),
     m_localServer(0)
 {
+    connect(this, SIGNAL(sendToAll(char, QByteArray)), this, SLOT(doSendToAll(char, QByteArray)));
+    connect(this, SIGNAL(sendItemChange(QByteArray, int)), this, SLOT(doSendItemChange(QByteArray, int)));
+    connect(this, SIGNAL(sendStatesReset()), this, SLOT(doSendStatesReset()));
+
     // construct local socket path
     sockPath = MegaApplication::applicationDataPath() + QDir::separator() + QString::fromAscii("notify.socket");
+}
 
+NotifyServer::~NotifyServer()
+{
+    qDeleteAll(m_clients);
+    QLocalServer::removeServer(sockPath);
+    if (m_localServer)
+    {
+        m_localServer->close();
+        delete m_localServer;
+    }
+}
+
+// start listening in the thread that serves the clients
+void NotifyServer::start()
+{
     //LOG_info << "Starting Notify server";
 
     // make sure previous socket file is removed
@@ -27,18 +47,9 @@ NotifyServer::NotifyServer(): QObject(),
         return;
     }
 
-    connect(this, SIGNAL(sendToAll(const char *, QByteArray)), this, SLOT(doSendToAll(const char *, QByteArray)));
     connect(m_localServer, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
 }
 
-NotifyServer::~NotifyServer()
-{
-    qDeleteAll(m_clients);
-    QLocalServer::removeServer(sockPath);
-    m_localServer->close();
-    delete m_localServer;
-}
-
 // a new connection is available
 void NotifyServer::acceptConnection()
 {
@@ -52,25 +63,18 @@ void NotifyServer::acceptConnection()
         }
 
         connect(client, SIGNAL(disconnected()), this, SLOT(onClientDisconnected()));
+        connect(client, SIGNAL(readyRead()), this, SLOT(onClientData()));
 
         // send the list of current synced folders to the new client
-        int localFolders = 0;
-        Preferences *preferences = Preferences::instance();
-        for (int i = 0; i < preferences->getNumSyncedFolders(); i++)
+        QStringList localFolders = Preferences::instance()->getActiveSyncRoots();
+        for (int i = 0; i < localFolders.size(); i++)
         {
-            QString c = QDir::toNativeSeparators(QDir(preferences->getLocalFolder(i)).canonicalPath());
-            if (!c.size() || !preferences->isFolderActive(i))
-            {
-                continue;
-            }
-
-            localFolders++;
             client->write("A");
-            client->write(c.toUtf8().constData());
+            client->write(localFolders.at(i).toUtf8().constData());
             client->write("\n");
         }
 
-        if (!localFolders)
+        if (localFolders.isEmpty())
         {
             // send an empty sync
             client->write("A");
@@ -89,35 +93,105 @@ void NotifyServer::onClientDisconnected()
     if (!client)
         return;
     m_clients.removeAll(client);
+    m_stateClients.removeAll(client);
     client->deleteLater();
 
     //LOG_debug << "Client disconnected";
 }
 
+// client sends some data
+// 'S': the client keeps a cache of item states, so send it the new state
+// of changed items instead of just their paths
+void NotifyServer::onClientData()
+{
+    QLocalSocket *client = qobject_cast<QLocalSocket *>(sender());
+    if (!client || m_clients.indexOf(client) == -1)
+    {
+        return;
+    }
+
+    char buf[64];
+    while (client->readLine(buf, sizeof(buf)) > 0)
+    {
+        if (buf[0] == 'S' && m_stateClients.indexOf(client) == -1)
+        {
+            m_stateClients.append(client);
+            writeStatesReset(client);
+        }
+    }
+}
+
 // send string to all connected clients
-void NotifyServer::doSendToAll(const char *type, QByteArray str)
+void NotifyServer::doSendToAll(char type, QByteArray str)
 {
     foreach(QLocalSocket *socket, m_clients)
         if (socket && socket->state() == QLocalSocket::ConnectedState) {
-            socket->write(type);
+            socket->write(&type, 1);
             socket->write(str.constData(), str.size());
             socket->write("\n");
             socket->flush();
         }
 }
 
-void NotifyServer::notifyItemChange(string *localPath)
+// send the path of a changed item to all connected clients
+// and its new state to clients that cache states
+void NotifyServer::doSendItemChange(QByteArray path, int newState)
 {
-    emit sendToAll("P", QByteArray(localPath->data(), localPath->size()));
+    char state[2] = { 'S', ExtServer::stateToResponse(newState)[0] };
+    foreach(QLocalSocket *socket, m_clients)
+        if (socket && socket->state() == QLocalSocket::ConnectedState) {
+            if (m_stateClients.contains(socket)) {
+                socket->write(state, sizeof(state));
+            }
+            else {
+                socket->write("P");
+            }
+            socket->write(path.constData(), path.size());
+            socket->write("\n");
+            socket->flush();
+        }
+}
+
+// cached states are no longer valid
+// "C1": state changes are notified, "C0": they aren't (overlay icons disabled)
+void NotifyServer::writeStatesReset(QLocalSocket *client)
+{
+    client->write(Preferences::instance()->overlayIconsDisabled() ? "C0\n" : "C1\n");
+    client->flush();
+}
+
+// the sync roots are invalidated too, so file managers ask for their states again
+void NotifyServer::doSendStatesReset()
+{
+    foreach(QLocalSocket *socket, m_stateClients)
+        if (socket && socket->state() == QLocalSocket::ConnectedState) {
+            writeStatesReset(socket);
+        }
+
+    QStringList localFolders = Preferences::instance()->getActiveSyncRoots();
+    for (int i = 0; i < localFolders.size(); i++)
+    {
+        doSendToAll('P', localFolders.at(i).toUtf8());
+    }
+}
+
+void NotifyServer::notifyItemChange(string *localPath, int newState)
+{
+    emit sendItemChange(QByteArray(localPath->data(), localPath->size()), newState);
 }
 
 void NotifyServer::notifySyncAdd(QString path)
 {
-    emit sendToAll("A", path.toUtf8());
+    emit sendToAll('A', path.toUtf8());
 }
 
 void NotifyServer::notifySyncDel(QString path)
 {
-    emit sendToAll("D", path.toUtf8());
+    emit sendToAll('D', path.toUtf8());
+}
+
+void NotifyServer::notifyStatesReset()
+{
+    emit sendStatesReset();
 }
 
@@ -12,25 +12,34 @@ class NotifyServer: public QObject
  public:
     NotifyServer();
     virtual ~NotifyServer();
-    void notifyItemChange(std::string *localPath);
+    void notifyItemChange(std::string *localPath, int newState);
     void notifySyncAdd(QString path);
     void notifySyncDel(QString path);
+    void notifyStatesReset();
 
  protected:
     QLocalServer *m_localServer;
 
  public Q_SLOTS:
+    void start();
     void acceptConnection();
     void onClientDisconnected();
-    void doSendToAll(const char *type, QByteArray str);
+    void onClientData();
+    void doSendToAll(char type, QByteArray str);
+    void doSendItemChange(QByteArray path, int newState);
+    void doSendStatesReset();
 
  private:
     MegaApplication *app;
     QString sockPath;
     QList<QLocalSocket *> m_clients;
+    QList<QLocalSocket *> m_stateClients;
+    void writeStatesReset(QLocalSocket *client);
 
 signals:
-    void sendToAll(const char *type, QByteArray str);
+    void sendToAll(char type, QByteArray str);
+    void sendItemChange(QByteArray path, int newState);
+    void sendStatesReset();
 
 };
 
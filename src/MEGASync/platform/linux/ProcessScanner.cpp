@@ -0,0 +1,362 @@
+#include "ProcessScanner.h"
+#include "megaapi.h"
+
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+#include <linux/version.h>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+using namespace mega;
+
+// Since Linux 6.6 the event values aren't declared inside struct proc_event
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 6, 0)
+#define PROC_EVENT(name) proc_event::name
+#else
+#define PROC_EVENT(name) name
+#endif
+
+const int ProcessScanner::RESCAN_INTERVAL_MS = 10000;
+const int ProcessScanner::CONNECTOR_RESCAN_INTERVAL_MS = 300000;
+
+ProcessScanner::ProcessScanner() : QThread()
+{
+    numScans = 0;
+    if (pipe(wakeupPipe))
+    {
+        wakeupPipe[0] = wakeupPipe[1] = -1;
+    }
+}
+
+ProcessScanner::~ProcessScanner()
+{
+    if (wakeupPipe[0] >= 0)
+    {
+        close(wakeupPipe[0]);
+        close(wakeupPipe[1]);
+    }
+}
+
+bool ProcessScanner::isHttpBrowserRunning()
+{
+    return browsers.fetchAndAddOrdered(0) & HTTP_BROWSER;
+}
+
+bool ProcessScanner::isHttpsBrowserRunning()
+{
+    return browsers.fetchAndAddOrdered(0) & HTTPS_BROWSER;
+}
+
+void ProcessScanner::stop()
+{
+    if (wakeupPipe[1] >= 0)
+    {
+        char c = 0;
+        if (write(wakeupPipe[1], &c, 1) < 0)
+        {
+            MegaApi::log(MegaApi::LOG_LEVEL_ERROR, "Unable to stop the process scanner");
+        }
+    }
+}
+
+// Same criteria as the previous "ps ax -o comm" + "readlink /proc/*/exe" check
+int ProcessScanner::classify(int pid)
+{
+    char path[64];
+    char buffer[PATH_MAX + 64];
+    int length = 0;
+
+    snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0)
+    {
+        ssize_t bytes = read(fd, buffer, 63);
+        if (bytes > 0)
+        {
+            length = bytes;
+        }
+        close(fd);
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/exe", pid);
+    ssize_t bytes = readlink(path, buffer + length, sizeof(buffer) - length - 1);
+    if (bytes > 0)
+    {
+        length += bytes;
+    }
+
+    for (int i = 0; i < length; i++)
+    {
+        buffer[i] = tolower((unsigned char)buffer[i]);
+    }
+    buffer[length] = '\0';
+
+    int flags = 0;
+    if (strstr(buffer, "firefox") || strstr(buffer, "chrome") || strstr(buffer, "chromium"))
+    {
+        flags |= HTTP_BROWSER;
+    }
+
+    if (strstr(buffer, "safari") || strstr(buffer, "iexplore") || strstr(buffer, "opera")
+            || strstr(buffer, "iceweasel") || strstr(buffer, "konqueror"))
+    {
+        flags |= HTTPS_BROWSER;
+    }
+    return flags;
+}
+
+void ProcessScanner::scan()
+{
+    DIR *dir = opendir("/proc");
+    if (!dir)
+    {
+        return;
+    }
+
+    numScans++;
+    struct dirent *entry;
+    while ((entry = readdir(dir)))
+    {
+        char *end;
+        long pid = strtol(entry->d_name, &end, 10);
+        if (*end || pid <= 0)
+        {
+            continue;
+        }
+
+        QHash<int, ProcessInfo>::iterator it = processes.find(pid);
+        if (it == processes.end())
+        {
+            ProcessInfo info;
+            info.flags = classify(pid);
+            info.firstScan = numScans;
+            info.lastScan = numScans;
+            processes.insert(pid, info);
+        }
+        else
+        {
+            // processes started just before the previous scan could have called exec() since then
+            if (it->firstScan == numScans - 1)
+            {
+                it->flags = classify(pid);
+            }
+            it->lastScan = numScans;
+        }
+    }
+    closedir(dir);
+
+    QHash<int, ProcessInfo>::iterator it = processes.begin();
+    while (it != processes.end())
+    {
+        if (it->lastScan != numScans)
+        {
+            it = processes.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
+void ProcessScanner::publish()
+{
+    int flags = 0;
+    for (QHash<int, ProcessInfo>::const_iterator it = processes.constBegin(); it != processes.constEnd(); it++)
+    {
+        flags |= it->flags;
+    }
+    browsers.fetchAndStoreOrdered(flags);
+}
+
+// Subscribes to the proc connector, returns -1 if it isn't available
+int ProcessScanner::openConnector()
+{
+    int fd = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_CONNECTOR);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = CN_IDX_PROC;
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    long buffer[64];
+    memset(buffer, 0, sizeof(buffer));
+    struct nlmsghdr *header = (struct nlmsghdr *)buffer;
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = getpid();
+    struct cn_msg *message = (struct cn_msg *)NLMSG_DATA(header);
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(enum proc_cn_mcast_op);
+    *(enum proc_cn_mcast_op *)message->data = PROC_CN_MCAST_LISTEN;
+    if (send(fd, header, header->nlmsg_len, 0) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // the kernel acknowledges the subscription (with an error if it isn't allowed)
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 1000) <= 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+    if (length <= 0 || !NLMSG_OK(header, (unsigned int)length))
+    {
+        close(fd);
+        return -1;
+    }
+
+    struct proc_event *event = (struct proc_event *)((struct cn_msg *)NLMSG_DATA(header))->data;
+    if (event->what != PROC_EVENT(PROC_EVENT_NONE) || event->event_data.ack.err)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Returns false if events were lost
+bool ProcessScanner::readConnector(int fd)
+{
+    long buffer[1024];
+    while (true)
+    {
+        ssize_t length = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (length < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno != ENOBUFS;
+        }
+
+        if (!length)
+        {
+            return true;
+        }
+
+        int remaining = length;
+        for (struct nlmsghdr *header = (struct nlmsghdr *)buffer; NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining))
+        {
+            struct proc_event *event = (struct proc_event *)((struct cn_msg *)NLMSG_DATA(header))->data;
+            switch (event->what)
+            {
+                case PROC_EVENT(PROC_EVENT_FORK):
+                    // new processes run the same program as their parent until they call exec()
+                    if (event->event_data.fork.child_pid == event->event_data.fork.child_tgid)
+                    {
+                        ProcessInfo info = processes.value(event->event_data.fork.parent_tgid);
+                        info.firstScan = info.lastScan = numScans;
+                        processes.insert(event->event_data.fork.child_pid, info);
+                    }
+                    break;
+                case PROC_EVENT(PROC_EVENT_EXEC):
+                    if (event->event_data.exec.process_pid == event->event_data.exec.process_tgid)
+                    {
+                        ProcessInfo info;
+                        info.flags = classify(event->event_data.exec.process_pid);
+                        info.firstScan = info.lastScan = numScans;
+                        processes.insert(event->event_data.exec.process_pid, info);
+                    }
+                    break;
+                case PROC_EVENT(PROC_EVENT_EXIT):
+                    if (event->event_data.exit.process_pid == event->event_data.exit.process_tgid)
+                    {
+                        processes.remove(event->event_data.exit.process_pid);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+void ProcessScanner::run()
+{
+    if (wakeupPipe[0] < 0)
+    {
+        return;
+    }
+
+    // subscribe before the first scan, so that no process is missed
+    int fd = openConnector();
+    MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, (fd >= 0) ? "Process scanner started (proc connector)"
+                                                     : "Process scanner started (polling)");
+    scan();
+    publish();
+
+    while (true)
+    {
+        struct pollfd fds[2];
+        fds[0].fd = fd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = wakeupPipe[0];
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+
+        int result = poll(fds, 2, (fd >= 0) ? CONNECTOR_RESCAN_INTERVAL_MS : RESCAN_INTERVAL_MS);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[1].revents)
+        {
+            // stopped
+            break;
+        }
+
+        if (!result)
+        {
+            scan();
+        }
+        else if (fds[0].revents && !readConnector(fd))
+        {
+            // events lost, start again from a full scan
+            MegaApi::log(MegaApi::LOG_LEVEL_DEBUG, "Process events lost");
+            scan();
+        }
+        publish();
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
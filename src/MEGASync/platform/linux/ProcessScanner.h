@@ -0,0 +1,57 @@
+#ifndef PROCESSSCANNER_H
+#define PROCESSSCANNER_H
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QHash>
+
+// Keeps track of the running web browsers from a background thread.
+// Processes are read from /proc once and cached by PID. If the proc connector is available
+// (it requires CAP_NET_ADMIN), new and finished processes are notified by the kernel,
+// otherwise /proc is listed periodically and only new PIDs are read.
+class ProcessScanner : public QThread
+{
+    Q_OBJECT
+
+ public:
+    enum
+    {
+        HTTP_BROWSER  = 1,  ///< Browsers that allow HTTP requests to 127.0.0.1 from HTTPS webs
+        HTTPS_BROWSER = 2   ///< Browsers that require a HTTPS server
+    };
+
+    static const int RESCAN_INTERVAL_MS;
+    static const int CONNECTOR_RESCAN_INTERVAL_MS;
+
+    ProcessScanner();
+    virtual ~ProcessScanner();
+
+    // Thread-safe, they don't block
+    bool isHttpBrowserRunning();
+    bool isHttpsBrowserRunning();
+    void stop();
+
+ protected:
+    class ProcessInfo
+    {
+    public:
+        ProcessInfo() : flags(0), firstScan(0), lastScan(0) {}
+        int flags;
+        int firstScan;
+        int lastScan;
+    };
+
+    virtual void run();
+    void scan();
+    void publish();
+    int openConnector();
+    bool readConnector(int fd);
+    static int classify(int pid);
+
+    QHash<int, ProcessInfo> processes;
+    int numScans;
+    QAtomicInt browsers;
+    int wakeupPipe[2];
+};
+
+#endif
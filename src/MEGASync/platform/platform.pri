@@ -39,10 +39,16 @@ unix:!macx {
     QT += dbus
     SOURCES += $$PWD/linux/LinuxPlatform.cpp \
         $$PWD/linux/ExtServer.cpp \
-        $$PWD/linux/NotifyServer.cpp
+        $$PWD/linux/ExtRequestFramer.cpp \
+        $$PWD/linux/NotifyServer.cpp \
+        $$PWD/linux/NetworkMonitor.cpp \
+        $$PWD/linux/ProcessScanner.cpp
     HEADERS += $$PWD/linux/LinuxPlatform.h \
         $$PWD/linux/ExtServer.h \
-        $$PWD/linux/NotifyServer.h
+        $$PWD/linux/ExtRequestFramer.h \
+        $$PWD/linux/NotifyServer.h \
+        $$PWD/linux/NetworkMonitor.h \
+        $$PWD/linux/ProcessScanner.h
 
     LIBS += -lssl -lcrypto -ldl
     DEFINES += USE_DBUS
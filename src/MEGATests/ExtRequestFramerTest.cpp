@@ -0,0 +1,71 @@
+#include <QtTest>
+#include "ExtRequestFramer.h"
+
+class ExtRequestFramerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void unterminatedRequestIsAnsweredAtOnce();
+    void legacyClientSendsSeveralRequests();
+    void framedClientWaitsForTerminator();
+    void pipelinedRequests();
+    void unterminatedBatchWaits();
+};
+
+// Extensions built before requests were terminated must not wait for anything
+void ExtRequestFramerTest::unterminatedRequestIsAnsweredAtOnce()
+{
+    ExtRequestFramer framer;
+    QList<QByteArray> requests = framer.append("P:/home/user/MEGA/file.txt");
+    QCOMPARE(requests.size(), 1);
+    QCOMPARE(requests.at(0), QByteArray("P:/home/user/MEGA/file.txt"));
+    QVERIFY(!framer.isFramed());
+}
+
+void ExtRequestFramerTest::legacyClientSendsSeveralRequests()
+{
+    ExtRequestFramer framer;
+    QCOMPARE(framer.append("P:/a").size(), 1);
+    QList<QByteArray> requests = framer.append("P:/b");
+    QCOMPARE(requests.size(), 1);
+    QCOMPARE(requests.at(0), QByteArray("P:/b"));
+}
+
+void ExtRequestFramerTest::framedClientWaitsForTerminator()
+{
+    ExtRequestFramer framer;
+    QCOMPARE(framer.append("P:/a\n").size(), 1);
+    QVERIFY(framer.isFramed());
+
+    QCOMPARE(framer.append("P:/b").size(), 0);
+    QList<QByteArray> requests = framer.append("/c\n");
+    QCOMPARE(requests.size(), 1);
+    QCOMPARE(requests.at(0), QByteArray("P:/b/c"));
+}
+
+void ExtRequestFramerTest::pipelinedRequests()
+{
+    ExtRequestFramer framer;
+    QList<QByteArray> requests = framer.append("P:/a\n\nP:/b\nP:/");
+    QCOMPARE(requests.size(), 2);
+    QCOMPARE(requests.at(0), QByteArray("P:/a"));
+    QCOMPARE(requests.at(1), QByteArray("P:/b"));
+
+    requests = framer.append("c\n");
+    QCOMPARE(requests.size(), 1);
+    QCOMPARE(requests.at(0), QByteArray("P:/c"));
+}
+
+void ExtRequestFramerTest::unterminatedBatchWaits()
+{
+    ExtRequestFramer framer;
+    QCOMPARE(framer.append("Q:/a\x1E/b").size(), 0);
+    QList<QByteArray> requests = framer.append("\x1C" "0\n");
+    QCOMPARE(requests.size(), 1);
+    QCOMPARE(requests.at(0), QByteArray("Q:/a\x1E/b\x1C" "0"));
+}
+
+QTEST_APPLESS_MAIN(ExtRequestFramerTest)
+
+#include "ExtRequestFramerTest.moc"
@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Unit tests of the parts of MEGAsync that don't need the SDK
+# qmake "CONFIG+=with_tests" MEGA.pro && make && make check
+#
+#-------------------------------------------------
+
+QT       += core testlib
+QT       -= gui
+
+TARGET = MEGATests
+TEMPLATE = app
+CONFIG += console testcase
+
+INCLUDEPATH += ../MEGASync/platform/linux
+
+SOURCES += ExtRequestFramerTest.cpp \
+    ../MEGASync/platform/linux/ExtRequestFramer.cpp
+
+HEADERS += ../MEGASync/platform/linux/ExtRequestFramer.h